@@ -0,0 +1,33 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * SHA-1 block function using the ARMv8 Crypto Extensions
+ */
+
+#include <common.h>
+#include <linux/errno.h>
+#include <u-boot/sha1.h>
+
+/* SHA1 field of ID_AA64ISAR0_EL1 */
+#define ID_AA64ISAR0_SHA1_SHIFT	8
+
+void sha1_ce_transform(u32 state[5], const u8 *src, u32 blocks);
+
+int sha1_process_arch(unsigned long state[5], const unsigned char *data,
+		      unsigned int blocks)
+{
+	u64 isar0;
+	u32 s[5];
+	int i;
+
+	asm("mrs %0, id_aa64isar0_el1" : "=r" (isar0));
+	if (!((isar0 >> ID_AA64ISAR0_SHA1_SHIFT) & 0xf))
+		return -ENOSYS;
+
+	for (i = 0; i < 5; i++)
+		s[i] = state[i];
+	sha1_ce_transform(s, data, blocks);
+	for (i = 0; i < 5; i++)
+		state[i] = s[i];
+
+	return 0;
+}
@@ -0,0 +1,27 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * SHA-256 block function using the ARMv8 Crypto Extensions
+ */
+
+#include <common.h>
+#include <linux/errno.h>
+#include <u-boot/sha256.h>
+
+/* SHA2 field of ID_AA64ISAR0_EL1 */
+#define ID_AA64ISAR0_SHA2_SHIFT	12
+
+void sha256_ce_transform(u32 state[8], const u8 *src, u32 blocks);
+
+int sha256_process_arch(uint32_t state[8], const uint8_t *data,
+			uint32_t blocks)
+{
+	u64 isar0;
+
+	asm("mrs %0, id_aa64isar0_el1" : "=r" (isar0));
+	if (!((isar0 >> ID_AA64ISAR0_SHA2_SHIFT) & 0xf))
+		return -ENOSYS;
+
+	sha256_ce_transform(state, data, blocks);
+
+	return 0;
+}
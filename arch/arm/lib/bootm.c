@@ -12,6 +12,7 @@
  */
 
 #include <common.h>
+#include <blk.h>
 #include <command.h>
 #include <dm.h>
 #include <dm/root.h>
@@ -104,6 +105,10 @@ static void announce_and_cleanup(int fake)
 
 	printf("\nStarting kernel ...%s\n\n", fake ?
 		"(fake run for tracing)" : "");
+	/* blocks held by the write-back cache would be lost otherwise */
+	if (blkcache_flush_all())
+		printf("Warning: could not write back cached blocks\n");
+
 	/*
 	 * Call remove function of all devices with a removal flag set.
 	 * This may be useful for last-stage operations, like cancelling
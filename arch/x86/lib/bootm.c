@@ -8,6 +8,7 @@
  */
 
 #include <common.h>
+#include <blk.h>
 #include <command.h>
 #include <dm/device.h>
 #include <dm/root.h>
@@ -39,6 +40,10 @@ void bootm_announce_and_cleanup(void)
 	bootstage_report();
 #endif
 
+	/* blocks held by the write-back cache would be lost otherwise */
+	if (blkcache_flush_all())
+		printf("Warning: could not write back cached blocks\n");
+
 	/*
 	 * Call remove function of all devices with a removal flag set.
 	 * This may be useful for last-stage operations, like cancelling
@@ -10,6 +10,7 @@
 
 #include <common.h>
 #include <blk.h>
+#include <mapmem.h>
 
 #ifdef CONFIG_HAVE_BLOCK_DEVICE
 int blk_common_cmd(int argc, char * const argv[], enum if_type if_type,
@@ -65,13 +66,16 @@ int blk_common_cmd(int argc, char * const argv[], enum if_type if_type,
 			ulong addr = simple_strtoul(argv[2], NULL, 16);
 			lbaint_t blk = simple_strtoul(argv[3], NULL, 16);
 			ulong cnt = simple_strtoul(argv[4], NULL, 16);
+			void *buf;
 			ulong n;
 
 			printf("\n%s read: device %d block # "LBAFU", count %lu ... ",
 			       if_name, *cur_devnump, blk, cnt);
 
+			buf = map_sysmem(addr, 0);
 			n = blk_read_devnum(if_type, *cur_devnump, blk, cnt,
-					    (ulong *)addr);
+					    buf);
+			unmap_sysmem(buf);
 
 			printf("%ld blocks read: %s\n", n,
 			       n == cnt ? "OK" : "ERROR");
@@ -80,13 +84,16 @@ int blk_common_cmd(int argc, char * const argv[], enum if_type if_type,
 			ulong addr = simple_strtoul(argv[2], NULL, 16);
 			lbaint_t blk = simple_strtoul(argv[3], NULL, 16);
 			ulong cnt = simple_strtoul(argv[4], NULL, 16);
+			void *buf;
 			ulong n;
 
 			printf("\n%s write: device %d block # "LBAFU", count %lu ... ",
 			       if_name, *cur_devnump, blk, cnt);
 
+			buf = map_sysmem(addr, 0);
 			n = blk_write_devnum(if_type, *cur_devnump, blk, cnt,
-					     (ulong *)addr);
+					     buf);
+			unmap_sysmem(buf);
 
 			printf("%ld blocks written: %s\n", n,
 			       n == cnt ? "OK" : "ERROR");
@@ -6,6 +6,7 @@
  */
 #include <config.h>
 #include <common.h>
+#include <div64.h>
 #include <malloc.h>
 #include <part.h>
 
@@ -13,15 +14,28 @@ static int blkc_show(cmd_tbl_t *cmdtp, int flag,
 		     int argc, char * const argv[])
 {
 	struct block_cache_stats stats;
+	u64 ra_pct = 0;
+
 	blkcache_stats(&stats);
+	if (stats.readahead_blocks) {
+		ra_pct = (u64)stats.readahead_hits * 100;
+		do_div(ra_pct, stats.readahead_blocks);
+	}
 
 	printf("hits: %u\n"
 	       "misses: %u\n"
 	       "entries: %u\n"
+	       "dirty entries: %u\n"
+	       "read-ahead blocks: %u\n"
+	       "read-ahead blocks used: %u (%u%%)\n"
+	       "blocks written back: %u\n"
 	       "max blocks/entry: %u\n"
-	       "max cache entries: %u\n",
-	       stats.hits, stats.misses, stats.entries,
-	       stats.max_blocks_per_entry, stats.max_entries);
+	       "max cache entries: %u\n"
+	       "max read-ahead blocks: %u\n",
+	       stats.hits, stats.misses, stats.entries, stats.dirty,
+	       stats.readahead_blocks, stats.readahead_hits, (unsigned)ra_pct,
+	       stats.writebacks, stats.max_blocks_per_entry,
+	       stats.max_entries, stats.max_readahead);
 	return 0;
 }
 
@@ -29,7 +43,7 @@ static int blkc_configure(cmd_tbl_t *cmdtp, int flag,
 			  int argc, char * const argv[])
 {
 	unsigned blocks_per_entry, max_entries;
-	if (argc != 3)
+	if (argc != 3 && argc != 4)
 		return CMD_RET_USAGE;
 
 	blocks_per_entry = simple_strtoul(argv[1], 0, 0);
@@ -37,12 +51,34 @@ static int blkc_configure(cmd_tbl_t *cmdtp, int flag,
 	blkcache_configure(blocks_per_entry, max_entries);
 	printf("changed to max of %u entries of %u blocks each\n",
 	       max_entries, blocks_per_entry);
+	if (argc == 4) {
+		blkcache_set_readahead(simple_strtoul(argv[3], 0, 0));
+		printf("read-ahead up to %s blocks\n", argv[3]);
+	}
+	return 0;
+}
+
+static int blkc_flush(cmd_tbl_t *cmdtp, int flag,
+		      int argc, char * const argv[])
+{
+	struct blk_desc *desc;
+
+	if (argc != 3)
+		return CMD_RET_USAGE;
+
+	if (blk_get_device_by_str(argv[1], argv[2], &desc) < 0)
+		return CMD_RET_FAILURE;
+	if (blkcache_flush(desc->if_type, desc->devnum)) {
+		printf("write back failed\n");
+		return CMD_RET_FAILURE;
+	}
 	return 0;
 }
 
 static cmd_tbl_t cmd_blkc_sub[] = {
 	U_BOOT_CMD_MKENT(show, 0, 0, blkc_show, "", ""),
-	U_BOOT_CMD_MKENT(configure, 3, 0, blkc_configure, "", ""),
+	U_BOOT_CMD_MKENT(configure, 4, 0, blkc_configure, "", ""),
+	U_BOOT_CMD_MKENT(flush, 3, 0, blkc_flush, "", ""),
 };
 
 static __maybe_unused void blkc_reloc(void)
@@ -79,8 +115,9 @@ static int do_blkcache(cmd_tbl_t *cmdtp, int flag,
 }
 
 U_BOOT_CMD(
-	blkcache, 4, 0, do_blkcache,
+	blkcache, 5, 0, do_blkcache,
 	"block cache diagnostics and control",
 	"show - show and reset statistics\n"
-	"blkcache configure blocks entries\n"
+	"blkcache configure blocks entries [readahead]\n"
+	"blkcache flush <interface> <dev> - write back dirty blocks\n"
 );
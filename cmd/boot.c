@@ -8,6 +8,7 @@
  * Misc boot support
  */
 #include <common.h>
+#include <blk.h>
 #include <command.h>
 #include <net.h>
 
@@ -55,8 +56,18 @@ U_BOOT_CMD(
 
 #endif
 
+static int do_reset_flush(cmd_tbl_t *cmdtp, int flag, int argc,
+			  char * const argv[])
+{
+	/* blocks held by the write-back cache would be lost otherwise */
+	if (blkcache_flush_all())
+		printf("Warning: could not write back cached blocks\n");
+
+	return do_reset(cmdtp, flag, argc, argv);
+}
+
 U_BOOT_CMD(
-	reset, 1, 0,	do_reset,
+	reset, 1, 0,	do_reset_flush,
 	"Perform RESET of the CPU",
 	""
 );
@@ -172,6 +172,26 @@ static int do_part_size(int argc, char * const argv[])
 	return do_part_info(argc, argv, CMD_PART_INFO_SIZE);
 }
 
+#if CONFIG_IS_ENABLED(PARTITION_CACHE)
+static int do_part_stats(int argc, char * const argv[])
+{
+	struct blk_desc *desc;
+	int ret;
+
+	if (argc != 2)
+		return CMD_RET_USAGE;
+
+	ret = blk_get_device_by_str(argv[0], argv[1], &desc);
+	if (ret < 0)
+		return 1;
+
+	printf("Partition table read %u times, %s\n", desc->part_reads,
+	       part_cache_get(desc) ? "cached" : "not cached");
+
+	return 0;
+}
+#endif
+
 static int do_part(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[])
 {
 	if (argc < 2)
@@ -185,6 +205,10 @@ static int do_part(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[])
 		return do_part_start(argc - 2, argv + 2);
 	else if (!strcmp(argv[1], "size"))
 		return do_part_size(argc - 2, argv + 2);
+#if CONFIG_IS_ENABLED(PARTITION_CACHE)
+	else if (!strcmp(argv[1], "stats"))
+		return do_part_stats(argc - 2, argv + 2);
+#endif
 
 	return CMD_RET_USAGE;
 }
@@ -207,4 +231,8 @@ U_BOOT_CMD(
 	"part size <interface> <dev> <part> <varname>\n"
 	"    - set environment variable to the size of the partition (in blocks)\n"
 	"      part can be either partition number or partition name"
+#if CONFIG_IS_ENABLED(PARTITION_CACHE)
+	"\npart stats <interface> <dev>\n"
+	"    - print how often the partition table was read from the device"
+#endif
 );
@@ -11,8 +11,12 @@
 #include <common.h>
 #include <command.h>
 #include <console.h>
+#include <image.h>
+#include <malloc.h>
 #include <linux/ctype.h>
 
+DECLARE_GLOBAL_DATA_PTR;
+
 /*
  * Use puts() instead of printf() to avoid printf buffer overflow
  * for long help messages
@@ -116,10 +120,82 @@ cmd_tbl_t *find_cmd_tbl(const char *cmd, cmd_tbl_t *table, int table_len)
 	return NULL;	/* not found or ambiguous command */
 }
 
+#ifdef CONFIG_CMDLINE
+/*
+ * Pointers to the commands in the linker list, sorted by name. The linker
+ * sorts the list by the C identifier of each command, which is not always
+ * its name (e.g. "?"), so this is built on first use after relocation.
+ */
+static cmd_tbl_t **cmd_index;
+
+static int cmd_index_cmp(const void *a, const void *b)
+{
+	const cmd_tbl_t *cmd_a = *(const cmd_tbl_t **)a;
+	const cmd_tbl_t *cmd_b = *(const cmd_tbl_t **)b;
+
+	return strcmp(cmd_a->name, cmd_b->name);
+}
+
+static cmd_tbl_t **cmd_index_get(cmd_tbl_t *table, int table_len)
+{
+	int i;
+
+	if (cmd_index || !(gd->flags & GD_FLG_RELOC))
+		return cmd_index;
+
+	cmd_index = malloc(table_len * sizeof(*cmd_index));
+	if (!cmd_index)
+		return NULL;
+	for (i = 0; i < table_len; i++)
+		cmd_index[i] = table + i;
+	qsort(cmd_index, table_len, sizeof(*cmd_index), cmd_index_cmp);
+
+	return cmd_index;
+}
+
+/* find command in the sorted index, with the same rules as find_cmd_tbl() */
+static cmd_tbl_t *find_cmd_index(const char *cmd, cmd_tbl_t **index,
+				 int index_len)
+{
+	int lo = 0, hi = index_len;
+	const char *p;
+	int len;
+
+	if (!cmd)
+		return NULL;
+	len = ((p = strchr(cmd, '.')) == NULL) ? strlen(cmd) : (p - cmd);
+
+	/* The commands starting with cmd follow each other; find the first */
+	while (lo < hi) {
+		int mid = lo + (hi - lo) / 2;
+
+		if (strncmp(index[mid]->name, cmd, len) < 0)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	if (lo == index_len || strncmp(index[lo]->name, cmd, len))
+		return NULL;	/* not found */
+
+	/* A full match sorts before the commands it abbreviates */
+	if (strlen(index[lo]->name) == len || lo + 1 == index_len ||
+	    strncmp(index[lo + 1]->name, cmd, len))
+		return index[lo];
+
+	return NULL;	/* ambiguous command */
+}
+#endif /* CONFIG_CMDLINE */
+
 cmd_tbl_t *find_cmd(const char *cmd)
 {
 	cmd_tbl_t *start = ll_entry_start(cmd_tbl_t, cmd);
 	const int len = ll_entry_count(cmd_tbl_t, cmd);
+#ifdef CONFIG_CMDLINE
+	cmd_tbl_t **index = cmd_index_get(start, len);
+
+	if (index)
+		return find_cmd_index(cmd, index, len);
+#endif
 	return find_cmd_tbl(cmd, start, len);
 }
 
@@ -615,6 +691,8 @@ enum command_ret_t cmd_process(int flag, int argc, char * const argv[],
 	if (!rc) {
 		int newrep;
 
+		/* the command may change a FIT hashed while it was loaded */
+		fit_hash_load_command();
 		if (ticks)
 			*ticks = get_timer(0);
 		rc = cmd_call(cmdtp, flag, argc, argv, &newrep);
@@ -1371,6 +1371,7 @@ int fdt_set_phandle(void *fdt, int nodeoffset, uint32_t phandle)
 	 * don't break older kernels.
 	 */
 	ret = fdt_setprop_cell(fdt, nodeoffset, "linux,phandle", phandle);
+	fdtdec_phandle_cache_invalidate(fdt);
 
 	return ret;
 }
@@ -1753,6 +1754,7 @@ int fdt_overlay_apply_verbose(void *fdt, void *fdto)
 	has_symbols = err >= 0;
 
 	err = fdt_overlay_apply(fdt, fdto);
+	fdtdec_phandle_cache_invalidate(fdt);
 	if (err < 0) {
 		printf("failed on fdt_overlay_apply(): %s\n",
 				fdt_strerror(err));
@@ -0,0 +1,339 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Hashing of FIT images while they are being loaded
+ *
+ * A FIT with external data starts with a small FDT which tells where each
+ * image lies in the file and which hashes it carries. Once that FDT has
+ * arrived, the images are hashed piece by piece as the loader stores them,
+ * while the data is still in the cache, so that fit_image_verify() does not
+ * have to read them from memory a second time.
+ *
+ * Nothing notices data being changed by other means, such as the 'mw' command
+ * or a read from a block device, once the load is over. So the digests can only
+ * be claimed by a bootm run as the very next command, are dropped by any other
+ * command, and each is used for a single verification.
+ */
+
+#include <common.h>
+#include <errno.h>
+#include <hash.h>
+#include <image.h>
+
+/* Most image hashes that can be calculated during one load */
+#define FIT_HASH_LOAD_RANGES	16
+
+/* Most pieces of data which can arrive ahead of the contiguous part */
+#define FIT_HASH_LOAD_PENDING	64
+
+/**
+ * struct fit_hash_range - a hash calculated over part of the loaded file
+ *
+ * @algo:	Hash algorithm
+ * @ctx:	Progressive hash context, NULL once the digest is complete
+ * @start:	Start of the image data
+ * @size:	Size of the image data
+ * @done:	Number of bytes hashed so far
+ * @value:	Digest, valid once @done reaches @size
+ */
+struct fit_hash_range {
+	struct hash_algo *algo;
+	void *ctx;
+	const char *start;
+	ulong size;
+	ulong done;
+	uint8_t value[FIT_MAX_HASH_LEN];
+};
+
+/**
+ * enum fit_hash_load_state - how far the digests have got
+ *
+ * @FIT_HASH_LOADING:	The command which loads the file is running
+ * @FIT_HASH_LOADED:	The next command is running, it may claim the digests
+ * @FIT_HASH_CLAIMED:	The digests belong to the bootm that is running
+ */
+enum fit_hash_load_state {
+	FIT_HASH_LOADING,
+	FIT_HASH_LOADED,
+	FIT_HASH_CLAIMED,
+};
+
+/**
+ * struct fit_hash_load - state of the load in progress
+ *
+ * @base:	Start of the file, NULL if there is nothing to hash
+ * @state:	How far the digests have got
+ * @front:	Number of bytes from @base which have all been stored
+ * @ready:	true once the FIT header has been parsed
+ * @nranges:	Number of entries in @range
+ * @npending:	Number of entries in @pending
+ * @range:	Image hashes being calculated
+ * @pending:	Pieces stored beyond @front, as offsets from @base
+ */
+struct fit_hash_load {
+	const char *base;
+	enum fit_hash_load_state state;
+	ulong front;
+	bool ready;
+	int nranges;
+	int npending;
+	struct fit_hash_range range[FIT_HASH_LOAD_RANGES];
+	struct {
+		ulong start;
+		ulong end;
+	} pending[FIT_HASH_LOAD_PENDING];
+};
+
+static struct fit_hash_load fit_hash_load;
+
+/* Give up on hashing this load, the images are hashed when verified */
+static void fit_hash_load_stop(void)
+{
+	struct fit_hash_load *load = &fit_hash_load;
+	struct fit_hash_range *range;
+	int i;
+
+	for (i = 0; i < load->nranges; i++) {
+		range = &load->range[i];
+		if (range->ctx)
+			range->algo->hash_finish(range->algo, range->ctx,
+						 range->value,
+						 sizeof(range->value));
+	}
+	memset(load, '\0', sizeof(*load));
+}
+
+/* Hash the part of [@from, @to) which falls into an image's data */
+static int fit_hash_range_update(struct fit_hash_range *range,
+				 const char *from, const char *to)
+{
+	const char *next = range->start + range->done;
+	const char *end = range->start + range->size;
+	int ret;
+
+	if (!range->ctx || to <= next || from >= end)
+		return 0;
+	if (from > next)
+		return -EINVAL;
+	if (to > end)
+		to = end;
+
+	range->done += to - next;
+	ret = range->algo->hash_update(range->algo, range->ctx, next, to - next,
+				       range->done == range->size);
+	if (!ret && range->done == range->size) {
+		ret = range->algo->hash_finish(range->algo, range->ctx,
+					       range->value,
+					       sizeof(range->value));
+		range->ctx = NULL;
+	}
+
+	return ret;
+}
+
+/**
+ * fit_hash_load_setup() - Set up a hash for each image hash node of the FIT
+ *
+ * Only images with external data are hashed; embedded data is part of the
+ * FIT header and so has already arrived by the time it can be found.
+ *
+ * @load:	Load state
+ * @return 0 if OK, -EAGAIN if the FIT header is not complete yet, other -ve
+ *	if the file is not a FIT or has nothing to hash
+ */
+static int fit_hash_load_setup(struct fit_hash_load *load)
+{
+	const void *fit = load->base;
+	struct fit_hash_range *range;
+	int images, image, noffset;
+	const void *data;
+	size_t size;
+	char *algo;
+	int offset;
+
+	if (load->front < sizeof(struct fdt_header))
+		return -EAGAIN;
+	if (fdt_magic(fit) != FDT_MAGIC)
+		return -EINVAL;
+	if (load->front < fdt_totalsize(fit))
+		return -EAGAIN;
+	if (fdt_check_header(fit) || !fit_check_format(fit))
+		return -EINVAL;
+
+	images = fdt_path_offset(fit, FIT_IMAGES_PATH);
+	if (images < 0)
+		return images;
+
+	fdt_for_each_subnode(image, fit, images) {
+		if (fit_image_get_data_position(fit, image, &offset) &&
+		    fit_image_get_data_offset(fit, image, &offset))
+			continue;
+		if (fit_image_get_data_and_size(fit, image, &data, &size))
+			continue;
+
+		fdt_for_each_subnode(noffset, fit, image) {
+			if (strncmp(fit_get_name(fit, noffset, NULL),
+				    FIT_HASH_NODENAME,
+				    strlen(FIT_HASH_NODENAME)))
+				continue;
+			if (load->nranges == FIT_HASH_LOAD_RANGES)
+				break;
+			range = &load->range[load->nranges];
+			if (fit_image_hash_get_algo(fit, noffset, &algo) ||
+			    hash_progressive_lookup_algo(algo, &range->algo) ||
+			    range->algo->hash_init(range->algo, &range->ctx))
+				continue;
+			range->start = data;
+			range->size = size;
+			range->done = 0;
+			load->nranges++;
+			debug("%s: %s hash of %s, %#zx bytes\n", __func__,
+			      algo, fit_get_name(fit, image, NULL), size);
+		}
+	}
+	if (!load->nranges)
+		return -ENOENT;
+	load->ready = true;
+
+	return 0;
+}
+
+/* Hash what has been stored up to @end, now that there is no gap before it */
+static void fit_hash_load_advance(struct fit_hash_load *load, ulong end)
+{
+	const char *from = load->base + load->front;
+	int ret, i;
+
+	load->front = end;
+	if (!load->ready) {
+		ret = fit_hash_load_setup(load);
+		if (ret == -EAGAIN)
+			return;
+		if (ret) {
+			fit_hash_load_stop();
+			return;
+		}
+		/* The start of the first image may have come with the header */
+		from = load->base;
+	}
+
+	for (i = 0; i < load->nranges; i++) {
+		if (fit_hash_range_update(&load->range[i], from,
+					  load->base + end)) {
+			fit_hash_load_stop();
+			return;
+		}
+	}
+}
+
+void fit_hash_load_start(const void *buf)
+{
+	fit_hash_load_stop();
+	fit_hash_load.base = buf;
+}
+
+void fit_hash_load_data(const void *buf, ulong len)
+{
+	struct fit_hash_load *load = &fit_hash_load;
+	ulong start, end;
+	bool found;
+	int i;
+
+	if (!load->base || (const char *)buf < load->base || !len)
+		return;
+	/* Data stored by a later command may replace what was hashed */
+	if (load->state != FIT_HASH_LOADING) {
+		fit_hash_load_stop();
+		return;
+	}
+	start = (const char *)buf - load->base;
+	end = start + len;
+
+	/* Data which was already hashed is being replaced */
+	if (start < load->front) {
+		fit_hash_load_stop();
+		return;
+	}
+
+	if (start > load->front) {
+		if (load->npending == FIT_HASH_LOAD_PENDING) {
+			fit_hash_load_stop();
+			return;
+		}
+		load->pending[load->npending].start = start;
+		load->pending[load->npending].end = end;
+		load->npending++;
+		return;
+	}
+
+	fit_hash_load_advance(load, end);
+
+	/* Catch up with anything which arrived ahead of this piece */
+	do {
+		found = false;
+		for (i = 0; load->base && i < load->npending; i++) {
+			if (load->pending[i].start > load->front)
+				continue;
+			end = load->pending[i].end;
+			load->pending[i] = load->pending[--load->npending];
+			if (end > load->front)
+				fit_hash_load_advance(load, end);
+			found = true;
+			break;
+		}
+	} while (found);
+}
+
+bool fit_hash_load_active(void)
+{
+	return fit_hash_load.base != NULL;
+}
+
+void fit_hash_load_command(void)
+{
+	struct fit_hash_load *load = &fit_hash_load;
+
+	if (!load->base)
+		return;
+	if (load->state == FIT_HASH_LOADING)
+		load->state = FIT_HASH_LOADED;
+	else
+		fit_hash_load_stop();
+}
+
+void fit_hash_load_claim(void)
+{
+	struct fit_hash_load *load = &fit_hash_load;
+
+	if (load->base && load->state == FIT_HASH_LOADED)
+		load->state = FIT_HASH_CLAIMED;
+	else
+		fit_hash_load_stop();
+}
+
+int fit_hash_load_lookup(const char *algo, const void *data, ulong size,
+			 uint8_t *value, int *value_len)
+{
+	struct fit_hash_load *load = &fit_hash_load;
+	struct fit_hash_range *range;
+	int i;
+
+	if (!load->base || load->state != FIT_HASH_CLAIMED)
+		return -ENOENT;
+
+	for (i = 0; i < load->nranges; i++) {
+		range = &load->range[i];
+		if (!range->algo || range->ctx || range->done != range->size ||
+		    range->start != data || range->size != size ||
+		    strcmp(range->algo->name, algo))
+			continue;
+		memcpy(value, range->value, range->algo->digest_size);
+		*value_len = range->algo->digest_size;
+
+		/* Each digest is good for one verification only */
+		range->algo = NULL;
+
+		return 0;
+	}
+
+	return -ENOENT;
+}
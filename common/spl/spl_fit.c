@@ -8,7 +8,10 @@
 #include <errno.h>
 #include <fpga.h>
 #include <image.h>
+#include <malloc.h>
+#include <memalign.h>
 #include <linux/libfdt.h>
+#include <linux/sizes.h>
 #include <spl.h>
 
 #ifndef CONFIG_SYS_BOOTM_LEN
@@ -150,6 +153,145 @@ static int get_aligned_image_size(struct spl_load_info *info, int data_size,
 	return (data_size + info->bl_len - 1) / info->bl_len;
 }
 
+/* Bytes read at once for a filesystem, when they cannot go straight through */
+#define SPL_FIT_STREAM_FS_TAIL	ARCH_DMA_MINALIGN
+
+/**
+ * struct spl_fit_stream - compressed image data being read piece by piece
+ *
+ * Whole sectors are read straight into the decompressor's buffer. Only the
+ * partial first sector, or a sector which does not fit into what the
+ * decompressor asks for, is read into @tail and copied from there.
+ *
+ * @info:	device to read from
+ * @sector:	next sector to read
+ * @skip:	bytes before the image data in the first sector
+ * @left:	bytes of image data which have not been read yet
+ * @tail:	buffer for one sector
+ * @tail_len:	size of @tail in bytes
+ * @pos:	next byte of @tail to hand to the decompressor
+ * @avail:	bytes left at @pos
+ */
+struct spl_fit_stream {
+	struct spl_load_info *info;
+	ulong sector;
+	ulong skip;
+	ulong left;
+	char *tail;
+	ulong tail_len;
+	char *pos;
+	ulong avail;
+};
+
+/* Read callback for gunzip_stream() and zstd_decompress_stream() */
+static int spl_fit_stream_read(void *priv, void *buf, ulong len)
+{
+	struct spl_fit_stream *st = priv;
+	struct spl_load_info *info = st->info;
+	ulong unit = info->filename ? 1 : info->bl_len;
+	ulong count;
+
+	if (!st->avail && st->left &&
+	    (st->skip || len < st->tail_len ||
+	     !IS_ALIGNED((ulong)buf, ARCH_DMA_MINALIGN))) {
+		count = DIV_ROUND_UP(min(st->skip + st->left, st->tail_len),
+				     unit);
+		if (info->read(info, st->sector, count, st->tail) != count)
+			return -EIO;
+		st->sector += count;
+		st->pos = st->tail + st->skip;
+		st->avail = min(count * unit - st->skip, st->left);
+		st->left -= st->avail;
+		st->skip = 0;
+	}
+
+	if (st->avail) {
+		len = min(len, st->avail);
+		memcpy(buf, st->pos, len);
+		st->pos += len;
+		st->avail -= len;
+
+		return len;
+	}
+	if (!st->left)
+		return 0;
+
+	count = min(len / unit, DIV_ROUND_UP(st->left, unit));
+	if (info->read(info, st->sector, count, buf) != count)
+		return -EIO;
+	st->sector += count;
+	len = min(count * unit, st->left);
+	st->left -= len;
+
+	return len;
+}
+
+/*
+ * Compressed external data is decompressed while it is being read, unless
+ * the whole of it has to be checked or processed first
+ */
+static bool spl_fit_can_stream(uint8_t comp)
+{
+	if (IS_ENABLED(CONFIG_SPL_FIT_SIGNATURE) ||
+	    IS_ENABLED(CONFIG_SPL_FIT_IMAGE_POST_PROCESS))
+		return false;
+
+	return (IS_ENABLED(CONFIG_SPL_GZIP) && comp == IH_COMP_GZIP) ||
+		(IS_ENABLED(CONFIG_SPL_ZSTD) && comp == IH_COMP_ZSTD);
+}
+
+/**
+ * spl_fit_stream_image() - read and decompress external data in pieces
+ *
+ * Only a piece of the compressed data is in memory at any time, rather than
+ * all of it next to the uncompressed image.
+ *
+ * If there is not enough memory for that, nothing is reported and the
+ * caller can read the whole of the data instead.
+ *
+ * @info:	device to read from
+ * @sector:	the start sector of the FIT image on the device
+ * @offset:	offset of the image data from the start of the FIT
+ * @size:	size of the compressed image data
+ * @comp:	compression type, IH_COMP_...
+ * @dst:	where to put the uncompressed image
+ * @lenp:	returns the size of the uncompressed image
+ * Return:	0 on success, -ENOMEM if there is not enough memory, or another
+ *		negative error number
+ */
+static int spl_fit_stream_image(struct spl_load_info *info, ulong sector,
+				int offset, ulong size, uint8_t comp, void *dst,
+				size_t *lenp)
+{
+	struct spl_fit_stream st = {
+		.info = info,
+		.sector = sector + get_aligned_image_offset(info, offset),
+		.skip = get_aligned_image_overhead(info, offset),
+		.left = size,
+		.tail_len = info->filename ? SPL_FIT_STREAM_FS_TAIL :
+			info->bl_len,
+	};
+	ulong unc_len = CONFIG_SYS_BOOTM_LEN;
+	int ret = -ENOSYS;
+
+	st.tail = malloc_cache_aligned(st.tail_len);
+	if (!st.tail)
+		return -ENOMEM;
+
+	*lenp = CONFIG_SYS_BOOTM_LEN;
+	if (IS_ENABLED(CONFIG_SPL_GZIP) && comp == IH_COMP_GZIP) {
+		ret = gunzip_stream(dst, *lenp, &unc_len, spl_fit_stream_read,
+				    &st);
+		*lenp = unc_len;
+	} else if (IS_ENABLED(CONFIG_SPL_ZSTD) && comp == IH_COMP_ZSTD) {
+		ret = zstd_decompress_stream(dst, lenp, spl_fit_stream_read,
+					     &st);
+	}
+	free(st.tail);
+
+	return ret;
+}
+
 /**
  * spl_load_fit_image(): load the image described in a certain FIT node
  * @info:	points to information about the device to load data from
@@ -179,20 +321,22 @@ static int spl_load_fit_image(struct spl_load_info *info, ulong sector,
 	void *src;
 	ulong overhead;
 	int nr_sectors;
+	int ret;
 	int align_len = ARCH_DMA_MINALIGN - 1;
 	uint8_t image_comp = -1, type = -1;
 	const void *data;
 	bool external_data = false;
+	bool decomp = IS_ENABLED(CONFIG_SPL_OS_BOOT) &&
+		(IS_ENABLED(CONFIG_SPL_GZIP) || IS_ENABLED(CONFIG_SPL_ZSTD));
 
-	if (IS_ENABLED(CONFIG_SPL_FPGA_SUPPORT) ||
-	    (IS_ENABLED(CONFIG_SPL_OS_BOOT) && IS_ENABLED(CONFIG_SPL_GZIP))) {
+	if (IS_ENABLED(CONFIG_SPL_FPGA_SUPPORT) || decomp) {
 		if (fit_image_get_type(fit, node, &type))
 			puts("Cannot get image type.\n");
 		else
 			debug("%s ", genimg_get_type_name(type));
 	}
 
-	if (IS_ENABLED(CONFIG_SPL_OS_BOOT) && IS_ENABLED(CONFIG_SPL_GZIP)) {
+	if (decomp) {
 		if (fit_image_get_comp(fit, node, &image_comp))
 			puts("Cannot get image compression format.\n");
 		else
@@ -214,6 +358,21 @@ static int spl_load_fit_image(struct spl_load_info *info, ulong sector,
 		if (fit_image_get_data_size(fit, node, &len))
 			return -ENOENT;
 
+		if (spl_fit_can_stream(image_comp)) {
+			debug("Streamed data: dst=%lx, offset=%x, size=%x\n",
+			      load_addr, offset, len);
+			ret = spl_fit_stream_image(info, sector, offset, len,
+						   image_comp,
+						   (void *)load_addr, &length);
+			if (!ret)
+				goto done;
+			if (ret != -ENOMEM) {
+				puts("Uncompressing error\n");
+				return -EIO;
+			}
+			debug("Not enough memory to stream, reading it all\n");
+		}
+
 		load_ptr = (load_addr + align_len) & ~align_len;
 		length = len;
 
@@ -260,10 +419,19 @@ static int spl_load_fit_image(struct spl_load_info *info, ulong sector,
 			return -EIO;
 		}
 		length = size;
+	} else if (IS_ENABLED(CONFIG_SPL_ZSTD) && image_comp == IH_COMP_ZSTD) {
+		size_t unc_len = CONFIG_SYS_BOOTM_LEN;
+
+		if (zstd_decompress(src, length, (void *)load_addr, &unc_len)) {
+			puts("Uncompressing error\n");
+			return -EIO;
+		}
+		length = unc_len;
 	} else {
 		memcpy((void *)load_addr, src, length);
 	}
 
+done:
 	if (image_info) {
 		image_info->load_addr = load_addr;
 		image_info->size = length;
@@ -234,6 +234,7 @@ void part_init(struct blk_desc *dev_desc)
 	struct part_driver *entry;
 
 	blkcache_invalidate(dev_desc->if_type, dev_desc->devnum);
+	part_cache_invalidate(dev_desc);
 
 	dev_desc->part_type = PART_TYPE_UNKNOWN;
 	for (entry = drv; entry != drv + n_ents; entry++) {
@@ -248,6 +249,45 @@ void part_init(struct blk_desc *dev_desc)
 	}
 }
 
+#if CONFIG_IS_ENABLED(PARTITION_CACHE)
+struct part_cache *part_cache_get(struct blk_desc *desc)
+{
+	struct part_cache *cache = desc->part_cache;
+
+	if (cache && (cache->hwpart != desc->hwpart ||
+		      cache->lba != desc->lba || cache->blksz != desc->blksz)) {
+		part_cache_invalidate(desc);
+		cache = NULL;
+	}
+
+	return cache;
+}
+
+void part_cache_set(struct blk_desc *desc, struct part_cache *cache)
+{
+	part_cache_invalidate(desc);
+	cache->hwpart = desc->hwpart;
+	cache->lba = desc->lba;
+	cache->blksz = desc->blksz;
+	desc->part_cache = cache;
+}
+
+void part_cache_invalidate(struct blk_desc *desc)
+{
+	free(desc->part_cache);
+	desc->part_cache = NULL;
+}
+
+void part_cache_write(struct blk_desc *desc, lbaint_t start, lbaint_t blkcnt)
+{
+	struct part_cache *cache = desc->part_cache;
+
+	if (cache && (start < cache->first_lba ||
+		      start + blkcnt > cache->last_lba + 1))
+		part_cache_invalidate(desc);
+}
+#endif
+
 static void print_part_header(const char *type, struct blk_desc *dev_desc)
 {
 #if CONFIG_IS_ENABLED(MAC_PARTITION) || \
@@ -654,6 +694,14 @@ int part_get_info_by_name_type(struct blk_desc *dev_desc, const char *name,
 	part_drv = part_driver_lookup_type(dev_desc);
 	if (!part_drv)
 		return -1;
+	if (part_drv->find_name) {
+		i = part_drv->find_name(dev_desc, name);
+		if (i != -ENOSYS) {
+			if (i < 0 || part_drv->get_info(dev_desc, i, info))
+				return -1;
+			return i;
+		}
+	}
 	for (i = 1; i < part_drv->max_entries; i++) {
 		ret = part_drv->get_info(dev_desc, i, info);
 		if (ret != 0) {
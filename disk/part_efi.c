@@ -52,10 +52,10 @@ static gpt_entry *alloc_read_gpt_entries(struct blk_desc *dev_desc,
 					 gpt_header *pgpt_head);
 static int is_pte_valid(gpt_entry * pte);
 
-static char *print_efiname(gpt_entry *pte)
+static void efiname_to_str(gpt_entry *pte, char *name)
 {
-	static char name[PARTNAME_SZ + 1];
 	int i;
+
 	for (i = 0; i < PARTNAME_SZ; i++) {
 		u8 c;
 		c = pte->partition_name[i] & 0xff;
@@ -63,6 +63,13 @@ static char *print_efiname(gpt_entry *pte)
 		name[i] = c;
 	}
 	name[PARTNAME_SZ] = 0;
+}
+
+static char *print_efiname(gpt_entry *pte)
+{
+	static char name[PARTNAME_SZ + 1];
+
+	efiname_to_str(pte, name);
 	return name;
 }
 
@@ -177,6 +184,143 @@ static void prepare_backup_gpt_header(gpt_header *gpt_h)
 }
 
 #if CONFIG_IS_ENABLED(EFI_PARTITION)
+/**
+ * find_valid_gpt() - read the primary GPT, or the backup if it is not valid
+ *
+ * @dev_desc:	block device
+ * @gpt_head:	filled with the GPT header
+ * @pgpt_pte:	set to the partition entries, which must be freed
+ * Return:	0 if OK, -EINVAL if neither GPT is valid
+ */
+static int find_valid_gpt(struct blk_desc *dev_desc, gpt_header *gpt_head,
+			  gpt_entry **pgpt_pte)
+{
+#if CONFIG_IS_ENABLED(PARTITION_CACHE)
+	dev_desc->part_reads++;
+#endif
+	if (is_gpt_valid(dev_desc, GPT_PRIMARY_PARTITION_TABLE_LBA,
+			 gpt_head, pgpt_pte) != 1) {
+		printf("%s: *** ERROR: Invalid GPT ***\n", __func__);
+		if (is_gpt_valid(dev_desc, dev_desc->lba - 1,
+				 gpt_head, pgpt_pte) != 1) {
+			printf("%s: *** ERROR: Invalid Backup GPT ***\n",
+			       __func__);
+			return -EINVAL;
+		}
+		printf("%s: ***        Using Backup GPT ***\n", __func__);
+	}
+
+	return 0;
+}
+
+#if CONFIG_IS_ENABLED(PARTITION_CACHE)
+/**
+ * struct gpt_cache - GPT of a block device kept in memory
+ *
+ * @cache:	generic part, see struct part_cache
+ * @head:	GPT header
+ * @names:	name of each partition entry, as printed
+ * @pte:	partition entries
+ */
+struct gpt_cache {
+	struct part_cache cache;
+	gpt_header head;
+	char (*names)[PARTNAME_SZ + 1];
+	gpt_entry pte[];
+};
+
+/* Get the GPT which a partition entry array belongs to, if it is cached */
+static struct gpt_cache *gpt_cache_of(struct blk_desc *dev_desc,
+				      gpt_entry *gpt_pte)
+{
+	struct part_cache *cache = dev_desc->part_cache;
+	struct gpt_cache *gc;
+
+	if (!cache)
+		return NULL;
+	gc = container_of(cache, struct gpt_cache, cache);
+
+	return gpt_pte == gc->pte ? gc : NULL;
+}
+
+/* Keep a GPT which was just read, taking over its partition entries */
+static struct gpt_cache *gpt_cache_fill(struct blk_desc *dev_desc,
+					gpt_header *gpt_head,
+					gpt_entry *gpt_pte)
+{
+	u32 count = le32_to_cpu(gpt_head->num_partition_entries);
+	struct gpt_cache *gc;
+	u32 i;
+
+	gc = malloc(sizeof(*gc) + count * sizeof(gpt_entry) +
+		    count * sizeof(*gc->names));
+	if (!gc)
+		return NULL;
+	memcpy(&gc->head, gpt_head, sizeof(gc->head));
+	memcpy(gc->pte, gpt_pte, count * sizeof(gpt_entry));
+	gc->names = (void *)&gc->pte[count];
+	for (i = 0; i < count; i++)
+		efiname_to_str(&gc->pte[i], gc->names[i]);
+
+	/* Both copies of the table lie outside the usable blocks */
+	gc->cache.first_lba = le64_to_cpu(gpt_head->first_usable_lba);
+	gc->cache.last_lba = le64_to_cpu(gpt_head->last_usable_lba);
+	part_cache_set(dev_desc, &gc->cache);
+	free(gpt_pte);
+
+	return gc;
+}
+#else
+static inline struct gpt_cache *gpt_cache_of(struct blk_desc *dev_desc,
+					     gpt_entry *gpt_pte)
+{
+	return NULL;
+}
+#endif
+
+/**
+ * gpt_get() - get the GPT of a block device
+ *
+ * With CONFIG_PARTITION_CACHE the GPT is only read from the device the first
+ * time, after that the copy kept in memory is used.
+ *
+ * @dev_desc:	block device
+ * @gpt_head:	filled with the GPT header
+ * @pgpt_pte:	set to the partition entries, release with gpt_put()
+ * Return:	0 if OK, -EINVAL if neither GPT is valid
+ */
+static int gpt_get(struct blk_desc *dev_desc, gpt_header *gpt_head,
+		   gpt_entry **pgpt_pte)
+{
+#if CONFIG_IS_ENABLED(PARTITION_CACHE)
+	struct part_cache *cache = part_cache_get(dev_desc);
+	struct gpt_cache *gc;
+
+	if (cache) {
+		gc = container_of(cache, struct gpt_cache, cache);
+	} else {
+		if (find_valid_gpt(dev_desc, gpt_head, pgpt_pte))
+			return -EINVAL;
+		gc = gpt_cache_fill(dev_desc, gpt_head, *pgpt_pte);
+		if (!gc)
+			return 0;
+	}
+	memcpy(gpt_head, &gc->head, sizeof(gc->head));
+	*pgpt_pte = gc->pte;
+
+	return 0;
+#else
+	return find_valid_gpt(dev_desc, gpt_head, pgpt_pte);
+#endif
+}
+
+/* Release the partition entries returned by gpt_get() */
+static void gpt_put(struct blk_desc *dev_desc, gpt_entry *gpt_pte)
+{
+	if (!gpt_cache_of(dev_desc, gpt_pte))
+		free(gpt_pte);
+}
+
 /*
  * Public Functions (include/part.h)
  */
@@ -192,25 +336,14 @@ int get_disk_guid(struct blk_desc * dev_desc, char *guid)
 	unsigned char *guid_bin;
 
 	/* This function validates AND fills in the GPT header and PTE */
-	if (is_gpt_valid(dev_desc, GPT_PRIMARY_PARTITION_TABLE_LBA,
-			 gpt_head, &gpt_pte) != 1) {
-		printf("%s: *** ERROR: Invalid GPT ***\n", __func__);
-		if (is_gpt_valid(dev_desc, dev_desc->lba - 1,
-				 gpt_head, &gpt_pte) != 1) {
-			printf("%s: *** ERROR: Invalid Backup GPT ***\n",
-			       __func__);
-			return -EINVAL;
-		} else {
-			printf("%s: ***        Using Backup GPT ***\n",
-			       __func__);
-		}
-	}
+	if (gpt_get(dev_desc, gpt_head, &gpt_pte))
+		return -EINVAL;
 
 	guid_bin = gpt_head->disk_guid.b;
 	uuid_bin_to_str(guid_bin, guid, UUID_STR_FORMAT_GUID);
 
 	/* Remember to free pte */
-	free(gpt_pte);
+	gpt_put(dev_desc, gpt_pte);
 	return 0;
 }
 
@@ -223,19 +356,8 @@ void part_print_efi(struct blk_desc *dev_desc)
 	unsigned char *uuid_bin;
 
 	/* This function validates AND fills in the GPT header and PTE */
-	if (is_gpt_valid(dev_desc, GPT_PRIMARY_PARTITION_TABLE_LBA,
-			 gpt_head, &gpt_pte) != 1) {
-		printf("%s: *** ERROR: Invalid GPT ***\n", __func__);
-		if (is_gpt_valid(dev_desc, (dev_desc->lba - 1),
-				 gpt_head, &gpt_pte) != 1) {
-			printf("%s: *** ERROR: Invalid Backup GPT ***\n",
-			       __func__);
-			return;
-		} else {
-			printf("%s: ***        Using Backup GPT ***\n",
-			       __func__);
-		}
-	}
+	if (gpt_get(dev_desc, gpt_head, &gpt_pte))
+		return;
 
 	debug("%s: gpt-entry at %p\n", __func__, gpt_pte);
 
@@ -267,7 +389,7 @@ void part_print_efi(struct blk_desc *dev_desc)
 	}
 
 	/* Remember to free pte */
-	free(gpt_pte);
+	gpt_put(dev_desc, gpt_pte);
 	return;
 }
 
@@ -284,25 +406,14 @@ int part_get_info_efi(struct blk_desc *dev_desc, int part,
 	}
 
 	/* This function validates AND fills in the GPT header and PTE */
-	if (is_gpt_valid(dev_desc, GPT_PRIMARY_PARTITION_TABLE_LBA,
-			gpt_head, &gpt_pte) != 1) {
-		printf("%s: *** ERROR: Invalid GPT ***\n", __func__);
-		if (is_gpt_valid(dev_desc, (dev_desc->lba - 1),
-				 gpt_head, &gpt_pte) != 1) {
-			printf("%s: *** ERROR: Invalid Backup GPT ***\n",
-			       __func__);
-			return -1;
-		} else {
-			printf("%s: ***        Using Backup GPT ***\n",
-			       __func__);
-		}
-	}
+	if (gpt_get(dev_desc, gpt_head, &gpt_pte))
+		return -1;
 
 	if (part > le32_to_cpu(gpt_head->num_partition_entries) ||
 	    !is_pte_valid(&gpt_pte[part - 1])) {
 		debug("%s: *** ERROR: Invalid partition number %d ***\n",
 			__func__, part);
-		free(gpt_pte);
+		gpt_put(dev_desc, gpt_pte);
 		return -1;
 	}
 
@@ -330,10 +441,38 @@ int part_get_info_efi(struct blk_desc *dev_desc, int part,
 	      info->start, info->size, info->name);
 
 	/* Remember to free pte */
-	free(gpt_pte);
+	gpt_put(dev_desc, gpt_pte);
 	return 0;
 }
 
+#if CONFIG_IS_ENABLED(PARTITION_CACHE)
+static int part_find_name_efi(struct blk_desc *dev_desc, const char *name)
+{
+	ALLOC_CACHE_ALIGN_BUFFER_PAD(gpt_header, gpt_head, 1, dev_desc->blksz);
+	gpt_entry *gpt_pte = NULL;
+	struct gpt_cache *gc;
+	int count, i;
+
+	if (gpt_get(dev_desc, gpt_head, &gpt_pte))
+		return -EINVAL;
+	gc = gpt_cache_of(dev_desc, gpt_pte);
+	if (!gc) {
+		gpt_put(dev_desc, gpt_pte);
+		return -ENOSYS;
+	}
+
+	/* Search the same entries as part_get_info_by_name() would */
+	count = min_t(int, le32_to_cpu(gc->head.num_partition_entries),
+		      GPT_ENTRY_NUMBERS - 1);
+	for (i = 0; i < count && is_pte_valid(&gc->pte[i]); i++) {
+		if (!strcmp(gc->names[i], name))
+			return i + 1;
+	}
+
+	return -ENOENT;
+}
+#endif
+
 static int part_test_efi(struct blk_desc *dev_desc)
 {
 	ALLOC_CACHE_ALIGN_BUFFER_PAD(legacy_mbr, legacymbr, 1, dev_desc->blksz);
@@ -1081,6 +1220,9 @@ U_BOOT_PART_TYPE(a_efi) = {
 	.part_type	= PART_TYPE_EFI,
 	.max_entries	= GPT_ENTRY_NUMBERS,
 	.get_info	= part_get_info_ptr(part_get_info_efi),
+#if CONFIG_IS_ENABLED(PARTITION_CACHE)
+	.find_name	= part_find_name_efi,
+#endif
 	.print		= part_print_ptr(part_print_efi),
 	.test		= part_test_efi,
 };
@@ -50,6 +50,12 @@ struct ahci_uc_priv *probe_ent = NULL;
 #define WAIT_MS_FLUSH	5000
 #define WAIT_MS_LINKUP	200
 
+/*
+ * Most blocks in one queued (NCQ) command. The buffer is contiguous, so this
+ * takes a single scatter-gather entry.
+ */
+#define AHCI_NCQ_MAX_BLOCKS	0x800
+
 __weak void __iomem *ahci_port_base(void __iomem *base, u32 port)
 {
 	return base + 0x100 + (port * 0x80);
@@ -90,6 +96,18 @@ static void ahci_dcache_flush_sata_cmd(struct ahci_ioports *pp)
 				AHCI_PORT_PRIV_DMA_SZ);
 }
 
+/* Size of the DMA memory of a port, including the tables of all its slots */
+static unsigned long ahci_port_dma_size(struct ahci_ioports *pp)
+{
+	return AHCI_PORT_PRIV_DMA_SZ + (pp->nslots - 1) * AHCI_CMD_TBL_SZ;
+}
+
+/* Command table of a slot: command FIS followed by the scatter-gather list */
+static unsigned long ahci_cmd_tbl(struct ahci_ioports *pp, int slot)
+{
+	return pp->cmd_tbl + slot * AHCI_CMD_TBL_SZ;
+}
+
 static int waiting_for_cmd_completed(void __iomem *offset,
 				     int timeout_msec,
 				     u32 sign)
@@ -488,11 +506,11 @@ static int ahci_init_one(struct ahci_uc_priv *uc_priv, pci_dev_t dev)
 
 #define MAX_DATA_BYTE_COUNT  (4*1024*1024)
 
-static int ahci_fill_sg(struct ahci_uc_priv *uc_priv, u8 port,
+static int ahci_fill_sg(struct ahci_uc_priv *uc_priv, u8 port, int slot,
 			unsigned char *buf, int buf_len)
 {
 	struct ahci_ioports *pp = &(uc_priv->port[port]);
-	struct ahci_sg *ahci_sg = pp->cmd_tbl_sg;
+	struct ahci_sg *ahci_sg;
 	u32 sg_count;
 	int i;
 
@@ -502,6 +520,8 @@ static int ahci_fill_sg(struct ahci_uc_priv *uc_priv, u8 port,
 		return -1;
 	}
 
+	ahci_sg = (struct ahci_sg *)(ahci_cmd_tbl(pp, slot) + AHCI_CMD_TBL_HDR);
+
 	for (i = 0; i < sg_count; i++) {
 		ahci_sg->addr =
 		    cpu_to_le32((unsigned long) buf + i * MAX_DATA_BYTE_COUNT);
@@ -518,14 +538,16 @@ static int ahci_fill_sg(struct ahci_uc_priv *uc_priv, u8 port,
 }
 
 
-static void ahci_fill_cmd_slot(struct ahci_ioports *pp, u32 opts)
+static void ahci_fill_cmd_slot(struct ahci_ioports *pp, int slot, u32 opts)
 {
-	pp->cmd_slot->opts = cpu_to_le32(opts);
-	pp->cmd_slot->status = 0;
-	pp->cmd_slot->tbl_addr = cpu_to_le32((u32)pp->cmd_tbl & 0xffffffff);
+	struct ahci_cmd_hdr *cmd_slot = &pp->cmd_slot[slot];
+	unsigned long cmd_tbl = ahci_cmd_tbl(pp, slot);
+
+	cmd_slot->opts = cpu_to_le32(opts);
+	cmd_slot->status = 0;
+	cmd_slot->tbl_addr = cpu_to_le32((u32)cmd_tbl & 0xffffffff);
 #ifdef CONFIG_PHYS_64BIT
-	pp->cmd_slot->tbl_addr_hi =
-	    cpu_to_le32((u32)(((pp->cmd_tbl) >> 16) >> 16));
+	cmd_slot->tbl_addr_hi = cpu_to_le32((u32)((cmd_tbl >> 16) >> 16));
 #endif
 }
 
@@ -559,13 +581,19 @@ static int ahci_port_start(struct ahci_uc_priv *uc_priv, u8 port)
 		return -1;
 	}
 
-	mem = memalign(2048, AHCI_PORT_PRIV_DMA_SZ);
+	/* Queued commands need a command table for each slot */
+	pp->nslots = 1;
+	if (IS_ENABLED(CONFIG_SCSI_AHCI_NCQ) && (uc_priv->cap & HOST_CAP_NCQ))
+		pp->nslots = HOST_CAP_NCS(uc_priv->cap);
+	pp->ncq_depth = 0;
+
+	mem = memalign(2048, ahci_port_dma_size(pp));
 	if (!mem) {
 		free(pp);
 		printf("%s: No mem for table!\n", __func__);
 		return -ENOMEM;
 	}
-	memset(mem, 0, AHCI_PORT_PRIV_DMA_SZ);
+	memset(mem, 0, ahci_port_dma_size(pp));
 
 	/*
 	 * First item in chunk of DMA memory: 32-slot command table,
@@ -574,7 +602,7 @@ static int ahci_port_start(struct ahci_uc_priv *uc_priv, u8 port)
 	pp->cmd_slot =
 		(struct ahci_cmd_hdr *)(uintptr_t)virt_to_phys((void *)mem);
 	debug("cmd_slot = %p\n", pp->cmd_slot);
-	mem += (AHCI_CMD_SLOT_SZ + 224);
+	mem += AHCI_CMD_SLOT_SZ * AHCI_MAX_CMD_SLOT;
 
 	/*
 	 * Second item: Received-FIS area
@@ -583,8 +611,8 @@ static int ahci_port_start(struct ahci_uc_priv *uc_priv, u8 port)
 	mem += AHCI_RX_FIS_SZ;
 
 	/*
-	 * Third item: data area for storing a single command
-	 * and its scatter-gather table
+	 * Third item: data area for storing a command and its
+	 * scatter-gather table, for each slot in use
 	 */
 	pp->cmd_tbl = virt_to_phys((void *)mem);
 	debug("cmd_tbl_dma = %lx\n", pp->cmd_tbl);
@@ -641,9 +669,9 @@ static int ahci_device_data_io(struct ahci_uc_priv *uc_priv, u8 port, u8 *fis,
 
 	memcpy((unsigned char *)pp->cmd_tbl, fis, fis_len);
 
-	sg_count = ahci_fill_sg(uc_priv, port, buf, buf_len);
+	sg_count = ahci_fill_sg(uc_priv, port, 0, buf, buf_len);
 	opts = (fis_len >> 2) | (sg_count << 16) | (is_write << 6);
-	ahci_fill_cmd_slot(pp, opts);
+	ahci_fill_cmd_slot(pp, 0, opts);
 
 	ahci_dcache_flush_sata_cmd(pp);
 	ahci_dcache_flush_range((unsigned long)buf, (unsigned long)buf_len);
@@ -688,6 +716,7 @@ static int ata_scsiop_inquiry(struct ahci_uc_priv *uc_priv,
 	u8 fis[20];
 	u16 *idbuf;
 	ALLOC_CACHE_ALIGN_BUFFER(u16, tmpid, ATA_ID_WORDS);
+	struct ahci_ioports *pp;
 	u8 port;
 
 	/* Clean ccb data buffer */
@@ -726,6 +755,14 @@ static int ata_scsiop_inquiry(struct ahci_uc_priv *uc_priv,
 	memcpy(idbuf, tmpid, ATA_ID_WORDS * 2);
 	ata_swap_buf_le16(idbuf, ATA_ID_WORDS);
 
+	pp = &uc_priv->port[port];
+	if (pp->nslots > 1 && ata_id_has_ncq(idbuf)) {
+		pp->ncq_depth = min_t(u32, pp->nslots,
+				      ata_id_queue_depth(idbuf));
+		debug("scsi_ahci: port %d queues %d commands\n", port,
+		      pp->ncq_depth);
+	}
+
 	memcpy(&pccb->pdata[8], "ATA     ", 8);
 	ata_id_strcpy((u16 *)&pccb->pdata[16], &idbuf[ATA_ID_PROD], 16);
 	ata_id_strcpy((u16 *)&pccb->pdata[32], &idbuf[ATA_ID_FW_REV], 4);
@@ -737,6 +774,148 @@ static int ata_scsiop_inquiry(struct ahci_uc_priv *uc_priv,
 }
 
 
+/*
+ * Bring the port back into service after a queued command failed. The
+ * command list engine has to be stopped to clear the error, and the device
+ * leaves its NCQ error state once its error log has been read.
+ */
+static void ahci_ncq_recover(struct ahci_uc_priv *uc_priv, u8 port)
+{
+	ALLOC_CACHE_ALIGN_BUFFER(u8, log, ATA_SECT_SIZE);
+	void __iomem *port_mmio = uc_priv->port[port].port_mmio;
+	u8 fis[20];
+	u32 tmp;
+
+	tmp = readl(port_mmio + PORT_CMD);
+	writel_with_flush(tmp & ~PORT_CMD_START, port_mmio + PORT_CMD);
+	if (waiting_for_cmd_completed(port_mmio + PORT_CMD, 500,
+				      PORT_CMD_LIST_ON))
+		debug("scsi_ahci: port %d did not stop\n", port);
+
+	writel(readl(port_mmio + PORT_SCR_ERR), port_mmio + PORT_SCR_ERR);
+	writel(readl(port_mmio + PORT_IRQ_STAT), port_mmio + PORT_IRQ_STAT);
+	writel_with_flush(tmp | PORT_CMD_START, port_mmio + PORT_CMD);
+
+	memset(fis, 0, sizeof(fis));
+	fis[0] = 0x27;		/* Host to device FIS. */
+	fis[1] = 1 << 7;	/* Command FIS. */
+	fis[2] = ATA_CMD_READ_LOG_EXT;
+	fis[4] = ATA_LOG_SATA_NCQ;
+	fis[12] = 1;		/* One sector of the log */
+	if (ahci_device_data_io(uc_priv, port, fis, sizeof(fis), log,
+				ATA_SECT_SIZE, 0))
+		debug("scsi_ahci: cannot read NCQ error log\n");
+}
+
+/* Set up a READ/WRITE FPDMA QUEUED command in the slot given by @tag */
+static int ahci_ncq_fill(struct ahci_uc_priv *uc_priv, u8 port, int tag,
+			 lbaint_t lba, u16 blocks, u8 *buf, u8 is_write)
+{
+	struct ahci_ioports *pp = &uc_priv->port[port];
+	u8 *fis = (u8 *)ahci_cmd_tbl(pp, tag);
+	int sg_count;
+
+	memset(fis, 0, 20);
+	fis[0] = 0x27;		/* Host to device FIS. */
+	fis[1] = 1 << 7;	/* Command FIS. */
+	fis[2] = is_write ? ATA_CMD_FPDMA_WRITE : ATA_CMD_FPDMA_READ;
+	/* The block count is held in the features registers */
+	fis[3] = (blocks >> 0) & 0xff;
+	fis[11] = (blocks >> 8) & 0xff;
+	fis[4] = (lba >> 0) & 0xff;
+	fis[5] = (lba >> 8) & 0xff;
+	fis[6] = (lba >> 16) & 0xff;
+	fis[7] = 1 << 6;	/* device reg: set LBA mode */
+	fis[8] = (lba >> 24) & 0xff;
+#ifdef CONFIG_SYS_64BIT_LBA
+	fis[9] = (lba >> 32) & 0xff;
+	fis[10] = (lba >> 40) & 0xff;
+#endif
+	fis[12] = tag << 3;
+
+	sg_count = ahci_fill_sg(uc_priv, port, tag, buf,
+				blocks * ATA_SECT_SIZE);
+	if (sg_count < 0)
+		return sg_count;
+	ahci_fill_cmd_slot(pp, tag, (20 >> 2) | (sg_count << 16) |
+			   (is_write << 6));
+
+	return 0;
+}
+
+/*
+ * Read or write @blocks blocks with native command queuing. The transfer is
+ * split into commands which are each given a free slot, and all those
+ * filled at once are issued together. A slot can be used again once the
+ * device has reported its command complete by clearing its SActive bit.
+ */
+static int ahci_ncq_rw(struct ahci_uc_priv *uc_priv, u8 port, lbaint_t lba,
+		       u32 blocks, u8 *buf, u8 is_write)
+{
+	struct ahci_ioports *pp = &uc_priv->port[port];
+	void __iomem *port_mmio = pp->port_mmio;
+	unsigned long len = blocks * ATA_SECT_SIZE;
+	u32 busy = 0, issue, done;
+	u8 *next = buf;
+	u16 now_blocks;
+	ulong start;
+	int tag;
+
+	writel(readl(port_mmio + PORT_IRQ_STAT), port_mmio + PORT_IRQ_STAT);
+	ahci_dcache_flush_range((unsigned long)buf, len);
+
+	start = get_timer(0);
+	while (blocks || busy) {
+		issue = 0;
+		for (tag = 0; blocks && tag < pp->ncq_depth; tag++) {
+			if (busy & BIT(tag))
+				continue;
+			now_blocks = min_t(u32, AHCI_NCQ_MAX_BLOCKS, blocks);
+			if (ahci_ncq_fill(uc_priv, port, tag, lba, now_blocks,
+					  next, is_write))
+				break;
+			issue |= BIT(tag);
+			next += now_blocks * ATA_SECT_SIZE;
+			blocks -= now_blocks;
+			lba += now_blocks;
+		}
+		if (issue) {
+			ahci_dcache_flush_range((unsigned long)pp->cmd_slot,
+						ahci_port_dma_size(pp));
+			writel(issue, port_mmio + PORT_SCR_ACT);
+			writel_with_flush(issue, port_mmio + PORT_CMD_ISSUE);
+			busy |= issue;
+		}
+
+		if (readl(port_mmio + PORT_IRQ_STAT) & PORT_IRQ_FATAL) {
+			printf("scsi_ahci: queued %s failed, status %x\n",
+			       is_write ? "write" : "read",
+			       readl(port_mmio + PORT_TFDATA));
+			ahci_ncq_recover(uc_priv, port);
+			return -EIO;
+		}
+
+		done = busy & ~(readl(port_mmio + PORT_SCR_ACT) |
+				readl(port_mmio + PORT_CMD_ISSUE));
+		if (done) {
+			busy &= ~done;
+			start = get_timer(0);
+		} else if (!issue && !busy) {
+			/* A command could not be set up */
+			return -EIO;
+		} else if (get_timer(start) > WAIT_MS_DATAIO) {
+			printf("scsi_ahci: queued %s timed out\n",
+			       is_write ? "write" : "read");
+			ahci_ncq_recover(uc_priv, port);
+			return -ETIMEDOUT;
+		}
+	}
+
+	ahci_dcache_invalidate_range((unsigned long)buf, len);
+
+	return 0;
+}
+
 /*
  * SCSI READ10/WRITE10 command operation.
  */
@@ -778,6 +957,20 @@ static int ata_scsiop_read_write(struct ahci_uc_priv *uc_priv,
 	debug("scsi_ahci: %s %u blocks starting from lba 0x" LBAFU "\n",
 	      is_write ?  "write" : "read", blocks, lba);
 
+	if (uc_priv->port[pccb->target].ncq_depth > 1) {
+		if (ATA_SECT_SIZE * blocks > user_buffer_size) {
+			printf("scsi_ahci: Error: buffer too small.\n");
+			return -EIO;
+		}
+		if (ahci_ncq_rw(uc_priv, pccb->target, lba, blocks,
+				user_buffer, is_write))
+			return -EIO;
+		if (is_write && ata_io_flush(uc_priv, pccb->target) == -EIO)
+			return -EIO;
+
+		return 0;
+	}
+
 	/* Preset the FIS */
 	memset(fis, 0, sizeof(fis));
 	fis[0] = 0x27;		 /* Host to device FIS. */
@@ -1110,7 +1303,7 @@ static int ata_io_flush(struct ahci_uc_priv *uc_priv, u8 port)
 	fis[2] = ATA_CMD_FLUSH_EXT;
 
 	memcpy((unsigned char *)pp->cmd_tbl, fis, 20);
-	ahci_fill_cmd_slot(pp, cmd_fis_len);
+	ahci_fill_cmd_slot(pp, 0, cmd_fis_len);
 	ahci_dcache_flush_sata_cmd(pp);
 	writel_with_flush(1, port_mmio + PORT_CMD_ISSUE);
 
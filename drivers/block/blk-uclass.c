@@ -10,6 +10,7 @@
 #include <dm/device-internal.h>
 #include <dm/lists.h>
 #include <dm/uclass-internal.h>
+#include <watchdog.h>
 
 static const char *if_typename_str[IF_TYPE_COUNT] = {
 	[IF_TYPE_IDE]		= "ide",
@@ -337,12 +338,20 @@ ulong blk_write_devnum(enum if_type if_type, int devnum, lbaint_t start,
 int blk_select_hwpart(struct udevice *dev, int hwpart)
 {
 	const struct blk_ops *ops = blk_get_ops(dev);
+	struct blk_desc *desc;
+	int ret;
 
 	if (!ops)
 		return -ENOSYS;
 	if (!ops->select_hwpart)
 		return 0;
 
+	/* cached blocks belong to the hardware partition being left */
+	desc = dev_get_uclass_platdata(dev);
+	ret = blkcache_invalidate(desc->if_type, desc->devnum);
+	if (ret)
+		return ret;
+
 	return ops->select_hwpart(dev, hwpart);
 }
 
@@ -426,25 +435,43 @@ int blk_get_device(int if_type, int devnum, struct udevice **devp)
 	return device_probe(*devp);
 }
 
+static unsigned long blk_read_dev(struct blk_desc *block_dev, lbaint_t start,
+				  lbaint_t blkcnt, void *buffer)
+{
+	struct udevice *dev = block_dev->bdev;
+
+	return blk_get_ops(dev)->read(dev, start, blkcnt, buffer);
+}
+
+static unsigned long blk_write_dev(struct blk_desc *block_dev, lbaint_t start,
+				   lbaint_t blkcnt, const void *buffer)
+{
+	struct udevice *dev = block_dev->bdev;
+
+	return blk_get_ops(dev)->write(dev, start, blkcnt, buffer);
+}
+
+/*
+ * Let asynchronous requests finish, so that synchronous I/O does not overtake
+ * them
+ */
+static void blk_drain(struct udevice *dev)
+{
+	while (blk_poll(dev) > 0)
+		WATCHDOG_RESET();
+}
+
 unsigned long blk_dread(struct blk_desc *block_dev, lbaint_t start,
 			lbaint_t blkcnt, void *buffer)
 {
 	struct udevice *dev = block_dev->bdev;
 	const struct blk_ops *ops = blk_get_ops(dev);
-	ulong blks_read;
 
 	if (!ops->read)
 		return -ENOSYS;
 
-	if (blkcache_read(block_dev->if_type, block_dev->devnum,
-			  start, blkcnt, block_dev->blksz, buffer))
-		return blkcnt;
-	blks_read = ops->read(dev, start, blkcnt, buffer);
-	if (blks_read == blkcnt)
-		blkcache_fill(block_dev->if_type, block_dev->devnum,
-			      start, blkcnt, block_dev->blksz, buffer);
-
-	return blks_read;
+	blk_drain(dev);
+	return blkcache_read(block_dev, start, blkcnt, buffer, blk_read_dev);
 }
 
 unsigned long blk_dwrite(struct blk_desc *block_dev, lbaint_t start,
@@ -456,8 +483,9 @@ unsigned long blk_dwrite(struct blk_desc *block_dev, lbaint_t start,
 	if (!ops->write)
 		return -ENOSYS;
 
-	blkcache_invalidate(block_dev->if_type, block_dev->devnum);
-	return ops->write(dev, start, blkcnt, buffer);
+	blk_drain(dev);
+	part_cache_write(block_dev, start, blkcnt);
+	return blkcache_write(block_dev, start, blkcnt, buffer, blk_write_dev);
 }
 
 unsigned long blk_derase(struct blk_desc *block_dev, lbaint_t start,
@@ -469,10 +497,135 @@ unsigned long blk_derase(struct blk_desc *block_dev, lbaint_t start,
 	if (!ops->erase)
 		return -ENOSYS;
 
-	blkcache_invalidate(block_dev->if_type, block_dev->devnum);
+	blk_drain(dev);
+	if (blkcache_invalidate(block_dev->if_type, block_dev->devnum))
+		return -EIO;
+	part_cache_write(block_dev, start, blkcnt);
 	return ops->erase(dev, start, blkcnt);
 }
 
+/**
+ * struct blk_queue - asynchronous requests for a block device
+ *
+ * This is the uclass-private data of each block device.
+ *
+ * @queued:	Requests not yet accepted by the driver, oldest first
+ * @active:	Requests which the driver has started
+ */
+struct blk_queue {
+	struct list_head queued;
+	struct list_head active;
+};
+
+/* Perform a request with the device's synchronous read() or write() */
+static int blk_req_sync(struct udevice *dev, struct blk_req *req)
+{
+	const struct blk_ops *ops = blk_get_ops(dev);
+	ulong count;
+
+	if (req->op == BLK_REQ_READ)
+		count = ops->read(dev, req->start, req->blkcnt, req->buffer);
+	else
+		count = ops->write(dev, req->start, req->blkcnt, req->buffer);
+	if (IS_ERR_VALUE(count))
+		return count;
+
+	return count == req->blkcnt ? 0 : -EIO;
+}
+
+/* Hand queued requests to the driver for as long as it accepts them */
+static void blk_queue_run(struct udevice *dev)
+{
+	struct blk_queue *queue = dev_get_uclass_priv(dev);
+	const struct blk_ops *ops = blk_get_ops(dev);
+	struct blk_req *req;
+	int ret;
+
+	while (!list_empty(&queue->queued)) {
+		req = list_first_entry(&queue->queued, struct blk_req, sibling);
+		list_move_tail(&req->sibling, &queue->active);
+		ret = ops->submit ? ops->submit(dev, req) : -ENOSYS;
+		if (ret == -EBUSY) {
+			list_move(&req->sibling, &queue->queued);
+			break;
+		}
+		if (ret == -ENOSYS)
+			blk_req_done(req, blk_req_sync(dev, req));
+		else if (ret)
+			blk_req_done(req, ret);
+	}
+}
+
+int blk_submit(struct udevice *dev, struct blk_req *req)
+{
+	struct blk_desc *desc = dev_get_uclass_platdata(dev);
+	struct blk_queue *queue = dev_get_uclass_priv(dev);
+	const struct blk_ops *ops = blk_get_ops(dev);
+	int ret;
+
+	if (req->op == BLK_REQ_READ) {
+		if (!ops->read)
+			return -ENOSYS;
+		ret = blkcache_flush(desc->if_type, desc->devnum);
+		if (ret)
+			return ret;
+	} else {
+		if (!ops->write)
+			return -ENOSYS;
+		ret = blkcache_invalidate(desc->if_type, desc->devnum);
+		if (ret)
+			return ret;
+		part_cache_write(desc, req->start, req->blkcnt);
+	}
+
+	req->status = -EINPROGRESS;
+	list_add_tail(&req->sibling, &queue->queued);
+	blk_queue_run(dev);
+
+	return 0;
+}
+
+int blk_poll(struct udevice *dev)
+{
+	struct blk_queue *queue = dev_get_uclass_priv(dev);
+	const struct blk_ops *ops = blk_get_ops(dev);
+	struct blk_req *req, *next;
+	int ret, count = 0;
+
+	if (ops->poll && !list_empty(&queue->active)) {
+		ret = ops->poll(dev);
+		if (ret) {
+			list_for_each_entry_safe(req, next, &queue->active,
+						 sibling)
+				blk_req_done(req, ret);
+		}
+	}
+	blk_queue_run(dev);
+
+	list_for_each_entry(req, &queue->active, sibling)
+		count++;
+	list_for_each_entry(req, &queue->queued, sibling)
+		count++;
+
+	return count;
+}
+
+int blk_wait(struct udevice *dev, struct blk_req *req)
+{
+	while (req->status == -EINPROGRESS) {
+		blk_poll(dev);
+		WATCHDOG_RESET();
+	}
+
+	return req->status;
+}
+
+void blk_req_done(struct blk_req *req, int status)
+{
+	list_del_init(&req->sibling);
+	req->status = status;
+}
+
 int blk_get_from_parent(struct udevice *parent, struct udevice **devp)
 {
 	struct udevice *dev;
@@ -639,18 +792,41 @@ int blk_unbind_all(int if_type)
 
 static int blk_post_probe(struct udevice *dev)
 {
+	struct blk_queue *queue = dev_get_uclass_priv(dev);
 #if defined(CONFIG_PARTITIONS) && defined(CONFIG_HAVE_BLOCK_DEVICE)
 	struct blk_desc *desc = dev_get_uclass_platdata(dev);
+#endif
 
+	INIT_LIST_HEAD(&queue->queued);
+	INIT_LIST_HEAD(&queue->active);
+#if defined(CONFIG_PARTITIONS) && defined(CONFIG_HAVE_BLOCK_DEVICE)
 	part_init(desc);
 #endif
 
 	return 0;
 }
 
+static int blk_pre_remove(struct udevice *dev)
+{
+	struct blk_desc *desc = dev_get_uclass_platdata(dev);
+	int ret;
+
+	blk_drain(dev);
+
+	/* write back anything still held in the cache */
+	ret = blkcache_invalidate(desc->if_type, desc->devnum);
+	if (ret)
+		return ret;
+	part_cache_invalidate(desc);
+
+	return 0;
+}
+
 UCLASS_DRIVER(blk) = {
 	.id		= UCLASS_BLK,
 	.name		= "blk",
 	.post_probe	= blk_post_probe,
+	.pre_remove	= blk_pre_remove,
+	.per_device_auto_alloc_size = sizeof(struct blk_queue),
 	.per_device_platdata_auto_alloc_size = sizeof(struct blk_desc),
 };
@@ -3,6 +3,12 @@
  * Copyright (C) Nelson Integration, LLC 2016
  * Author: Eric Nelson<eric@nelint.com>
  *
+ * The cache is organised in pages of a power-of-two number of blocks. Pages
+ * are looked up through a hash of (device, page number) and kept on a single
+ * LRU list shared by all block devices. Sequential reads are detected per
+ * device and trigger read-ahead of following pages; with
+ * CONFIG_BLOCK_CACHE_WRITEBACK writes are absorbed into cached pages and
+ * written out when the device is flushed.
  */
 #include <config.h>
 #include <common.h>
@@ -10,158 +16,646 @@
 #include <part.h>
 #include <linux/ctype.h>
 #include <linux/list.h>
+#include <linux/log2.h>
 
+#ifdef CONFIG_SPL_BUILD
+#define BLKCACHE_ENTRIES	32
+#define BLKCACHE_READAHEAD	0
+#define BLKCACHE_HASH_BITS	5
+#else
+#define BLKCACHE_ENTRIES	CONFIG_BLOCK_CACHE_ENTRIES
+#define BLKCACHE_READAHEAD	CONFIG_BLOCK_CACHE_READAHEAD
+#define BLKCACHE_HASH_BITS	8
+#endif
+#define BLKCACHE_HASH_SIZE	(1 << BLKCACHE_HASH_BITS)
+
+/**
+ * struct block_cache_dev - per-device cache state
+ *
+ * @lh:		Entry in the list of devices known to the cache
+ * @desc:	Block device this state refers to
+ * @write:	Function used to write back dirty pages, NULL if none are dirty
+ * @next:	Block following the last read, used to detect sequential access
+ * @window:	Current read-ahead window in blocks, 0 if not sequential
+ * @dirty:	Number of dirty pages belonging to this device
+ */
+struct block_cache_dev {
+	struct list_head lh;
+	struct blk_desc *desc;
+	blkcache_write_t write;
+	lbaint_t next;
+	lbaint_t window;
+	unsigned dirty;
+};
+
+/**
+ * struct block_cache_node - a cached page of blocks
+ *
+ * @lh:		Entry in the LRU list, most recently used first
+ * @hn:		Entry in the hash chain
+ * @bdev:	Device the page belongs to
+ * @page:	Page number, i.e. the first block shifted right by the page shift
+ * @size:	Size of the @cache buffer in bytes
+ * @dirty:	Page holds data which has not been written to the device
+ * @readahead:	Page was read ahead and has not been used yet
+ * @cache:	Page data
+ */
 struct block_cache_node {
 	struct list_head lh;
-	int iftype;
-	int devnum;
-	lbaint_t start;
-	lbaint_t blkcnt;
-	unsigned long blksz;
+	struct hlist_node hn;
+	struct block_cache_dev *bdev;
+	lbaint_t page;
+	unsigned long size;
+	bool dirty;
+	bool readahead;
 	char *cache;
 };
 
 static LIST_HEAD(block_cache);
+static LIST_HEAD(block_cache_devs);
+static struct hlist_head block_cache_hash[BLKCACHE_HASH_SIZE];
+static int page_shift = 3;
+
+/* Bounce buffer for reading runs of missing pages */
+static char *scratch;
+static unsigned long scratch_size;
 
 static struct block_cache_stats _stats = {
 	.max_blocks_per_entry = 8,
-	.max_entries = 32
+	.max_entries = BLKCACHE_ENTRIES,
+	.max_readahead = BLKCACHE_READAHEAD,
 };
 
-static struct block_cache_node *cache_find(int iftype, int devnum,
-					   lbaint_t start, lbaint_t blkcnt,
-					   unsigned long blksz)
+static inline lbaint_t page_blocks(void)
+{
+	return (lbaint_t)1 << page_shift;
+}
+
+static inline struct hlist_head *cache_bucket(struct block_cache_dev *bdev,
+					      lbaint_t page)
+{
+	u32 key = (u32)page ^ (u32)((u64)page >> 32) ^
+		  ((u32)(uintptr_t)bdev >> 4);
+
+	return &block_cache_hash[(key * 0x9e3779b1) >>
+				 (32 - BLKCACHE_HASH_BITS)];
+}
+
+static struct block_cache_dev *cache_find_dev(int iftype, int devnum)
+{
+	struct block_cache_dev *bdev;
+
+	list_for_each_entry(bdev, &block_cache_devs, lh)
+		if (bdev->desc->if_type == iftype &&
+		    bdev->desc->devnum == devnum)
+			return bdev;
+
+	return NULL;
+}
+
+static struct block_cache_dev *cache_get_dev(struct blk_desc *desc)
+{
+	struct block_cache_dev *bdev;
+
+	bdev = cache_find_dev(desc->if_type, desc->devnum);
+	if (bdev) {
+		bdev->desc = desc;
+		return bdev;
+	}
+
+	bdev = calloc(1, sizeof(*bdev));
+	if (!bdev)
+		return NULL;
+	bdev->desc = desc;
+	list_add(&bdev->lh, &block_cache_devs);
+
+	return bdev;
+}
+
+static struct block_cache_node *cache_find(struct block_cache_dev *bdev,
+					   lbaint_t page)
 {
 	struct block_cache_node *node;
+	struct hlist_node *pos;
 
-	list_for_each_entry(node, &block_cache, lh)
-		if ((node->iftype == iftype) &&
-		    (node->devnum == devnum) &&
-		    (node->blksz == blksz) &&
-		    (node->start <= start) &&
-		    (node->start + node->blkcnt >= start + blkcnt)) {
-			if (block_cache.next != &node->lh) {
-				/* maintain MRU ordering */
-				list_del(&node->lh);
-				list_add(&node->lh, &block_cache);
-			}
+	hlist_for_each_entry(node, pos, cache_bucket(bdev, page), hn)
+		if (node->bdev == bdev && node->page == page)
 			return node;
-		}
+
+	return NULL;
+}
+
+static int cache_writeback(struct block_cache_node *node)
+{
+	struct block_cache_dev *bdev = node->bdev;
+	struct blk_desc *desc = bdev->desc;
+	lbaint_t start = node->page << page_shift;
+	ulong n;
+
+	if (!node->dirty)
+		return 0;
+
+	debug("writeback: start " LBAF ", count " LBAFU "\n",
+	      start, page_blocks());
+	n = bdev->write(desc, start, page_blocks(), node->cache);
+	if (n != page_blocks())
+		return -EIO;
+	node->dirty = false;
+	bdev->dirty--;
+	_stats.dirty--;
+	_stats.writebacks += page_blocks();
+
 	return 0;
 }
 
-int blkcache_read(int iftype, int devnum,
-		  lbaint_t start, lbaint_t blkcnt,
-		  unsigned long blksz, void *buffer)
+/* Remove a page from the cache, discarding any data not written back */
+static void cache_free(struct block_cache_node *node)
 {
-	struct block_cache_node *node = cache_find(iftype, devnum, start,
-						   blkcnt, blksz);
-	if (node) {
-		const char *src = node->cache + (start - node->start) * blksz;
-		memcpy(buffer, src, blksz * blkcnt);
-		debug("hit: start " LBAF ", count " LBAFU "\n",
-		      start, blkcnt);
-		++_stats.hits;
-		return 1;
+	if (node->dirty) {
+		node->bdev->dirty--;
+		_stats.dirty--;
 	}
+	list_del(&node->lh);
+	hlist_del(&node->hn);
+	free(node->cache);
+	free(node);
+	_stats.entries--;
+}
+
+/* Write back and remove a page; a page which cannot be written is kept */
+static int cache_drop(struct block_cache_node *node)
+{
+	int ret;
+
+	ret = cache_writeback(node);
+	if (ret)
+		return ret;
+	cache_free(node);
 
-	debug("miss: start " LBAF ", count " LBAFU "\n",
-	      start, blkcnt);
-	++_stats.misses;
 	return 0;
 }
 
-void blkcache_fill(int iftype, int devnum,
-		   lbaint_t start, lbaint_t blkcnt,
-		   unsigned long blksz, void const *buffer)
+/* Get a page for @bdev, evicting the least-recently-used page if needed */
+static struct block_cache_node *cache_alloc(struct block_cache_dev *bdev,
+					    lbaint_t page)
 {
-	lbaint_t bytes;
+	unsigned long bytes = bdev->desc->blksz << page_shift;
 	struct block_cache_node *node;
 
-	/* don't cache big stuff */
-	if (blkcnt > _stats.max_blocks_per_entry)
-		return;
-
-	if (_stats.max_entries == 0)
-		return;
-
-	bytes = blksz * blkcnt;
-	if (_stats.max_entries <= _stats.entries) {
-		/* pop LRU */
-		node = (struct block_cache_node *)block_cache.prev;
+	if (_stats.entries >= _stats.max_entries) {
+		node = list_entry(block_cache.prev, struct block_cache_node,
+				  lh);
+		debug("drop: start " LBAF ", count " LBAFU "\n",
+		      node->page << page_shift, page_blocks());
+		if (cache_writeback(node))
+			return NULL;
 		list_del(&node->lh);
+		hlist_del(&node->hn);
 		_stats.entries--;
-		debug("drop: start " LBAF ", count " LBAFU "\n",
-		      node->start, node->blkcnt);
-		if (node->blkcnt * node->blksz < bytes) {
+		if (node->size < bytes) {
 			free(node->cache);
-			node->cache = 0;
+			node->cache = NULL;
 		}
 	} else {
 		node = malloc(sizeof(*node));
 		if (!node)
-			return;
-		node->cache = 0;
+			return NULL;
+		node->cache = NULL;
 	}
 
 	if (!node->cache) {
 		node->cache = malloc(bytes);
 		if (!node->cache) {
 			free(node);
-			return;
+			return NULL;
 		}
+		node->size = bytes;
 	}
 
-	debug("fill: start " LBAF ", count " LBAFU "\n",
-	      start, blkcnt);
-
-	node->iftype = iftype;
-	node->devnum = devnum;
-	node->start = start;
-	node->blkcnt = blkcnt;
-	node->blksz = blksz;
-	memcpy(node->cache, buffer, bytes);
+	node->bdev = bdev;
+	node->page = page;
+	node->dirty = false;
+	node->readahead = false;
 	list_add(&node->lh, &block_cache);
+	hlist_add_head(&node->hn, cache_bucket(bdev, page));
 	_stats.entries++;
+
+	return node;
+}
+
+static void cache_touch(struct block_cache_node *node)
+{
+	if (block_cache.next != &node->lh) {
+		/* maintain MRU ordering */
+		list_del(&node->lh);
+		list_add(&node->lh, &block_cache);
+	}
+}
+
+static void cache_mark_dirty(struct block_cache_node *node,
+			     blkcache_write_t write)
+{
+	node->bdev->write = write;
+	if (node->dirty)
+		return;
+	node->dirty = true;
+	node->bdev->dirty++;
+	_stats.dirty++;
 }
 
-void blkcache_invalidate(int iftype, int devnum)
+static int cache_flush_dev(struct block_cache_dev *bdev)
 {
-	struct list_head *entry, *n;
 	struct block_cache_node *node;
+	int ret = 0;
 
-	list_for_each_safe(entry, n, &block_cache) {
-		node = (struct block_cache_node *)entry;
-		if ((node->iftype == iftype) &&
-		    (node->devnum == devnum)) {
-			list_del(entry);
-			free(node->cache);
-			free(node);
-			--_stats.entries;
+	if (!bdev->dirty)
+		return 0;
+
+	/* write back in LRU order so that older data reaches the device first */
+	list_for_each_entry_reverse(node, &block_cache, lh) {
+		if (node->bdev == bdev && node->dirty) {
+			if (cache_writeback(node))
+				ret = -EIO;
 		}
 	}
+
+	return ret;
 }
 
-void blkcache_configure(unsigned blocks, unsigned entries)
+/* Write back any dirty pages in the given range of blocks */
+static int cache_flush_range(struct block_cache_dev *bdev, lbaint_t start,
+			     lbaint_t blkcnt)
 {
+	lbaint_t page, last = (start + blkcnt - 1) >> page_shift;
 	struct block_cache_node *node;
+	int ret = 0;
+
+	if (!bdev->dirty)
+		return 0;
+
+	for (page = start >> page_shift; page <= last; page++) {
+		node = cache_find(bdev, page);
+		if (node && cache_writeback(node))
+			ret = -EIO;
+	}
+
+	return ret;
+}
+
+static int cache_invalidate_dev(struct block_cache_dev *bdev)
+{
+	struct block_cache_node *node, *n;
+	int ret = 0;
+
+	list_for_each_entry_safe(node, n, &block_cache, lh) {
+		if (node->bdev == bdev && cache_drop(node))
+			ret = -EIO;
+	}
+	bdev->next = 0;
+	bdev->window = 0;
+
+	return ret;
+}
+
+/*
+ * Work out which part of @page overlaps the range [start, start + blkcnt).
+ * Returns the number of bytes in the overlap and sets @pageoff and @bufoff to
+ * its offset within the page and within a buffer holding the range.
+ */
+static ulong page_overlap(lbaint_t page, unsigned long blksz, lbaint_t start,
+			  lbaint_t blkcnt, ulong *pageoff, ulong *bufoff)
+{
+	lbaint_t pstart = page << page_shift;
+	lbaint_t from = max(pstart, start);
+	lbaint_t to = min(pstart + page_blocks(), start + blkcnt);
+
+	*pageoff = (from - pstart) * blksz;
+	*bufoff = (from - start) * blksz;
+
+	return (to - from) * blksz;
+}
+
+static bool cache_usable(struct blk_desc *desc, lbaint_t start,
+			 lbaint_t blkcnt)
+{
+	lbaint_t end;
+
+	if (!_stats.max_entries || !blkcnt)
+		return false;
+
+	/* don't cache big stuff, it would only push out useful pages */
+	if ((blkcnt >> page_shift) > _stats.max_entries / 4)
+		return false;
+
+	/* only cache whole pages that lie within the device */
+	end = ((start + blkcnt - 1) | (page_blocks() - 1)) + 1;
+	if (desc->lba && end > desc->lba)
+		return false;
+
+	return true;
+}
+
+static void *cache_scratch(unsigned long bytes)
+{
+	if (scratch_size < bytes) {
+		free(scratch);
+		scratch = memalign(ARCH_DMA_MINALIGN, bytes);
+		scratch_size = scratch ? bytes : 0;
+	}
+
+	return scratch;
+}
+
+/* Work out how many pages to read ahead after a miss at @page */
+static lbaint_t cache_readahead(struct block_cache_dev *bdev, lbaint_t start,
+				lbaint_t page)
+{
+	struct blk_desc *desc = bdev->desc;
+	lbaint_t ra, limit;
+
+	if (start != bdev->next || !desc->lba || !_stats.max_readahead) {
+		bdev->window = 0;
+		return 0;
+	}
+
+	/* sequential access, grow the window up to the configured maximum */
+	bdev->window = bdev->window ? bdev->window * 2 : page_blocks();
+	if (bdev->window > _stats.max_readahead)
+		bdev->window = _stats.max_readahead;
+
+	ra = bdev->window >> page_shift;
+	limit = _stats.max_entries / 4;
+	if (ra > limit)
+		ra = limit;
+
+	/* stop at the end of the device or at the first cached page */
+	for (limit = 0; limit < ra; limit++) {
+		lbaint_t next = page + 1 + limit;
+
+		if ((next + 1) << page_shift > desc->lba ||
+		    cache_find(bdev, next))
+			break;
+	}
+
+	return limit;
+}
+
+ulong blkcache_read(struct blk_desc *desc, lbaint_t start, lbaint_t blkcnt,
+		    void *buffer, blkcache_read_t read)
+{
+	unsigned long blksz = desc->blksz;
+	struct block_cache_node *node;
+	struct block_cache_dev *bdev;
+	lbaint_t page, last;
+	ulong pageoff, bufoff, bytes;
+
+	if (!cache_usable(desc, start, blkcnt))
+		goto bypass;
+	bdev = cache_get_dev(desc);
+	if (!bdev)
+		goto bypass;
+
+	last = (start + blkcnt - 1) >> page_shift;
+	for (page = start >> page_shift; page <= last;) {
+		lbaint_t run, ra, i, cnt;
+		char *buf;
+		ulong n;
+
+		node = cache_find(bdev, page);
+		if (node) {
+			bytes = page_overlap(page, blksz, start, blkcnt,
+					     &pageoff, &bufoff);
+			memcpy(buffer + bufoff, node->cache + pageoff, bytes);
+			cache_touch(node);
+			if (node->readahead) {
+				node->readahead = false;
+				_stats.readahead_hits += page_blocks();
+			}
+			++_stats.hits;
+			page++;
+			continue;
+		}
+
+		/* read the whole run of missing pages in one go */
+		for (run = 1; page + run <= last; run++)
+			if (cache_find(bdev, page + run))
+				break;
+		ra = page + run > last ?
+			cache_readahead(bdev, start, page + run - 1) : 0;
+		cnt = (run + ra) << page_shift;
+		buf = cache_scratch(cnt * blksz);
+		if (!buf) {
+			if (cache_flush_range(bdev, start, blkcnt))
+				return -EIO;
+			goto bypass;
+		}
+
+		debug("miss: start " LBAF ", count " LBAFU ", readahead "
+		      LBAFU "\n", page << page_shift, run << page_shift,
+		      ra << page_shift);
+		n = read(desc, page << page_shift, cnt, buf);
+		if (n != cnt) {
+			if (cache_flush_range(bdev, start, blkcnt))
+				return -EIO;
+			goto bypass;
+		}
+		_stats.misses += run;
+		_stats.readahead_blocks += ra << page_shift;
+
+		for (i = 0; i < run + ra; i++) {
+			void *data = buf + ((i * blksz) << page_shift);
+
+			node = cache_alloc(bdev, page + i);
+			if (i < run) {
+				bytes = page_overlap(page + i, blksz, start,
+						     blkcnt, &pageoff, &bufoff);
+				memcpy(buffer + bufoff, data + pageoff, bytes);
+			}
+			if (!node)
+				continue;
+			memcpy(node->cache, data, blksz << page_shift);
+			node->readahead = i >= run;
+		}
+		page += run;
+	}
+	bdev->next = start + blkcnt;
+
+	return blkcnt;
+
+bypass:
+	bdev = cache_find_dev(desc->if_type, desc->devnum);
+	if (bdev && cache_flush_range(bdev, start, blkcnt))
+		return -EIO;
+
+	return read(desc, start, blkcnt, buffer);
+}
+
+ulong blkcache_write(struct blk_desc *desc, lbaint_t start, lbaint_t blkcnt,
+		     const void *buffer, blkcache_write_t write)
+{
+	struct block_cache_node *node;
+	struct block_cache_dev *bdev;
+	lbaint_t page, last;
+	ulong pageoff, bufoff, bytes, n;
+
+	if (!blkcnt)
+		return 0;
+	bdev = cache_find_dev(desc->if_type, desc->devnum);
+	last = (start + blkcnt - 1) >> page_shift;
+
+	if (CONFIG_IS_ENABLED(BLOCK_CACHE_WRITEBACK) &&
+	    cache_usable(desc, start, blkcnt)) {
+		bdev = cache_get_dev(desc);
+		if (!bdev)
+			goto writethrough;
+
+		for (page = start >> page_shift; page <= last; page++) {
+			lbaint_t pstart = page << page_shift;
+
+			node = cache_find(bdev, page);
+			if (!node && pstart >= start &&
+			    pstart + page_blocks() <= start + blkcnt)
+				node = cache_alloc(bdev, page);
+			if (node) {
+				bytes = page_overlap(page, desc->blksz, start,
+						     blkcnt, &pageoff, &bufoff);
+				memcpy(node->cache + pageoff, buffer + bufoff,
+				       bytes);
+				node->readahead = false;
+				cache_touch(node);
+				cache_mark_dirty(node, write);
+				continue;
+			}
+
+			/* partial write to an uncached page goes straight out */
+			pstart = max(pstart, start);
+			n = min(((page + 1) << page_shift), start + blkcnt) -
+				pstart;
+			if (write(desc, pstart, n,
+				  buffer + (pstart - start) * desc->blksz) != n)
+				return -EIO;
+		}
+
+		/* don't let too much unwritten data build up */
+		if (bdev->dirty > _stats.max_entries / 2 &&
+		    cache_flush_dev(bdev))
+			return -EIO;
+
+		return blkcnt;
+	}
+
+writethrough:
+	n = write(desc, start, blkcnt, buffer);
+	if (!bdev)
+		return n;
+
+	/* keep any cached copy of the written blocks up to date */
+	for (page = start >> page_shift; page <= last; page++) {
+		node = cache_find(bdev, page);
+		if (!node)
+			continue;
+		if (n != blkcnt) {
+			/* a dirty page which cannot be written stays cached */
+			cache_drop(node);
+			continue;
+		}
+		bytes = page_overlap(page, desc->blksz, start, blkcnt,
+				     &pageoff, &bufoff);
+		memcpy(node->cache + pageoff, buffer + bufoff, bytes);
+	}
+
+	return n;
+}
+
+int blkcache_flush(int iftype, int devnum)
+{
+	struct block_cache_dev *bdev;
+
+	bdev = cache_find_dev(iftype, devnum);
+	if (!bdev)
+		return 0;
+
+	return cache_flush_dev(bdev);
+}
+
+int blkcache_flush_all(void)
+{
+	struct block_cache_dev *bdev;
+	int ret = 0;
+
+	list_for_each_entry(bdev, &block_cache_devs, lh) {
+		if (cache_flush_dev(bdev))
+			ret = -EIO;
+	}
+
+	return ret;
+}
+
+int blkcache_invalidate(int iftype, int devnum)
+{
+	struct block_cache_dev *bdev;
+
+	bdev = cache_find_dev(iftype, devnum);
+	if (!bdev)
+		return 0;
+
+	/* keep the device while it still has pages we could not write */
+	if (cache_invalidate_dev(bdev))
+		return -EIO;
+	list_del(&bdev->lh);
+	free(bdev);
+
+	return 0;
+}
+
+void blkcache_configure(unsigned blocks, unsigned entries)
+{
+	struct block_cache_dev *bdev, *n;
+
+	if (blocks)
+		blocks = rounddown_pow_of_two(blocks);
+
 	if ((blocks != _stats.max_blocks_per_entry) ||
 	    (entries != _stats.max_entries)) {
 		/* invalidate cache */
-		while (!list_empty(&block_cache)) {
-			node = (struct block_cache_node *)block_cache.next;
-			list_del(&node->lh);
-			free(node->cache);
-			free(node);
+		list_for_each_entry_safe(bdev, n, &block_cache_devs, lh) {
+			struct block_cache_node *node, *next;
+
+			/* pages cannot be kept across a change of page size */
+			if (cache_invalidate_dev(bdev)) {
+				printf("blkcache: write-back failed, dropping "
+				       "%u dirty pages\n", bdev->dirty);
+				list_for_each_entry_safe(node, next,
+							 &block_cache, lh)
+					if (node->bdev == bdev)
+						cache_free(node);
+			}
+			list_del(&bdev->lh);
+			free(bdev);
 		}
-		_stats.entries = 0;
+		free(scratch);
+		scratch = NULL;
+		scratch_size = 0;
 	}
 
-	_stats.max_blocks_per_entry = blocks;
-	_stats.max_entries = entries;
+	if (blocks) {
+		_stats.max_blocks_per_entry = blocks;
+		page_shift = ilog2(blocks);
+		_stats.max_entries = entries;
+	} else {
+		_stats.max_entries = 0;
+	}
 
 	_stats.hits = 0;
 	_stats.misses = 0;
+	_stats.readahead_blocks = 0;
+	_stats.readahead_hits = 0;
+	_stats.writebacks = 0;
+}
+
+void blkcache_set_readahead(unsigned blocks)
+{
+	_stats.max_readahead = blocks;
 }
 
 void blkcache_stats(struct block_cache_stats *stats)
@@ -169,4 +663,7 @@ void blkcache_stats(struct block_cache_stats *stats)
 	memcpy(stats, &_stats, sizeof(*stats));
 	_stats.hits = 0;
 	_stats.misses = 0;
+	_stats.readahead_blocks = 0;
+	_stats.readahead_hits = 0;
+	_stats.writebacks = 0;
 }
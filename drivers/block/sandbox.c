@@ -218,9 +218,51 @@ int host_get_dev_err(int devnum, struct blk_desc **blk_devp)
 }
 
 #ifdef CONFIG_BLK
+/*
+ * Asynchronous requests are emulated: they are only queued when submitted
+ * and each poll performs the oldest one, so that callers see them complete
+ * some time later, as they would with real hardware.
+ */
+static int host_block_submit(struct udevice *dev, struct blk_req *req)
+{
+	struct host_block_dev *host_dev = dev_get_platdata(dev);
+
+	if (host_dev->nreqs == HOST_BLK_QUEUE_DEPTH)
+		return -EBUSY;
+	host_dev->req[host_dev->nreqs++] = req;
+
+	return 0;
+}
+
+static int host_block_poll(struct udevice *dev)
+{
+	struct host_block_dev *host_dev = dev_get_platdata(dev);
+	struct blk_req *req;
+	ulong count;
+
+	if (!host_dev->nreqs)
+		return 0;
+	req = host_dev->req[0];
+	host_dev->nreqs--;
+	memmove(host_dev->req, host_dev->req + 1,
+		host_dev->nreqs * sizeof(*host_dev->req));
+
+	if (req->op == BLK_REQ_READ)
+		count = host_block_read(dev, req->start, req->blkcnt,
+					req->buffer);
+	else
+		count = host_block_write(dev, req->start, req->blkcnt,
+					 req->buffer);
+	blk_req_done(req, count == req->blkcnt ? 0 : -EIO);
+
+	return 0;
+}
+
 static const struct blk_ops sandbox_host_blk_ops = {
 	.read	= host_block_read,
 	.write	= host_block_write,
+	.submit	= host_block_submit,
+	.poll	= host_block_poll,
 };
 
 U_BOOT_DRIVER(sandbox_host_blk) = {
@@ -15,8 +15,11 @@
 #include <dm/uclass.h>
 #include <dm/util.h>
 #include <fdtdec.h>
+#include <malloc.h>
 #include <linux/compiler.h>
 
+DECLARE_GLOBAL_DATA_PTR;
+
 struct driver *lists_driver_lookup_name(const char *name)
 {
 	struct driver *drv =
@@ -122,11 +125,140 @@ static int driver_check_compatible(const struct udevice_id *of_match,
 	return -ENOENT;
 }
 
-int lists_bind_fdt(struct udevice *parent, ofnode node, struct udevice **devp,
-		   bool pre_reloc_only)
+#if CONFIG_IS_ENABLED(DM_COMPAT_INDEX)
+/*
+ * The index is an open-addressed hash table of all compatible strings of
+ * all drivers. To keep it small, slots refer to the drivers by their
+ * position in the linker list rather than by pointer.
+ */
+struct dm_compat_index {
+	struct driver *drivers;
+	uint mask;
+	struct dm_compat_slot {
+		u16 drv;	/* driver number + 1, 0 if the slot is free */
+		u16 match;	/* entry in the driver's of_match table */
+	} slot[];
+};
+
+static uint compat_hash(const char *compat)
+{
+	uint hash = 5381;
+
+	while (*compat)
+		hash = hash * 33 + *compat++;
+
+	return hash;
+}
+
+static struct driver *compat_slot_driver(struct dm_compat_index *index,
+					 struct dm_compat_slot *slot)
+{
+	return index->drivers + slot->drv - 1;
+}
+
+static const struct udevice_id *compat_slot_id(struct dm_compat_index *index,
+					       struct dm_compat_slot *slot)
+{
+	return compat_slot_driver(index, slot)->of_match + slot->match;
+}
+
+int lists_build_compat_index(void)
+{
+	struct driver *driver = ll_entry_start(struct driver, driver);
+	const int n_ents = ll_entry_count(struct driver, driver);
+	const struct udevice_id *of_match;
+	struct dm_compat_index *index;
+	struct dm_compat_slot *slot;
+	struct driver *entry;
+	uint count = 0, size;
+	int match;
+
+	gd->dm_compat = NULL;
+	for (entry = driver; entry != driver + n_ents; entry++) {
+		for (of_match = entry->of_match;
+		     of_match && of_match->compatible; of_match++)
+			count++;
+	}
+	if (n_ents >= U16_MAX)
+		return -E2BIG;
+
+	/* Keep the table at most half full so that probe chains are short */
+	for (size = 16; size < count * 2; size <<= 1)
+		;
+	index = calloc(1, sizeof(*index) + size * sizeof(*slot));
+	if (!index)
+		return -ENOMEM;
+	index->drivers = driver;
+	index->mask = size - 1;
+
+	/*
+	 * Insert in linker list order and keep the first driver found for
+	 * each compatible string, just like a linear search would do.
+	 */
+	for (entry = driver; entry != driver + n_ents; entry++) {
+		for (of_match = entry->of_match, match = 0;
+		     of_match && of_match->compatible; of_match++, match++) {
+			slot = &index->slot[compat_hash(of_match->compatible) &
+					    index->mask];
+			while (slot->drv &&
+			       strcmp(compat_slot_id(index, slot)->compatible,
+				      of_match->compatible)) {
+				if (++slot == index->slot + size)
+					slot = index->slot;
+			}
+			if (slot->drv)
+				continue;
+			slot->drv = entry - driver + 1;
+			slot->match = match;
+		}
+	}
+	gd->dm_compat = index;
+	pr_debug("Indexed %u compatible strings in %u slots\n", count, size);
+
+	return 0;
+}
+
+static struct driver *compat_index_lookup(struct dm_compat_index *index,
+					  const char *compat,
+					  const struct udevice_id **of_idp)
+{
+	struct dm_compat_slot *slot;
+	uint idx = compat_hash(compat);
+
+	for (;; idx++) {
+		slot = &index->slot[idx & index->mask];
+		if (!slot->drv)
+			return NULL;
+		if (!strcmp(compat_slot_id(index, slot)->compatible, compat)) {
+			*of_idp = compat_slot_id(index, slot);
+			return compat_slot_driver(index, slot);
+		}
+	}
+}
+#endif
+
+struct driver *lists_driver_lookup_compatible(const char *compat,
+					      const struct udevice_id **of_idp)
 {
 	struct driver *driver = ll_entry_start(struct driver, driver);
 	const int n_ents = ll_entry_count(struct driver, driver);
+	struct driver *entry;
+
+#if CONFIG_IS_ENABLED(DM_COMPAT_INDEX)
+	if (gd->dm_compat)
+		return compat_index_lookup(gd->dm_compat, compat, of_idp);
+#endif
+	for (entry = driver; entry != driver + n_ents; entry++) {
+		if (!driver_check_compatible(entry->of_match, of_idp, compat))
+			return entry;
+	}
+
+	return NULL;
+}
+
+int lists_bind_fdt(struct udevice *parent, ofnode node, struct udevice **devp,
+		   bool pre_reloc_only)
+{
 	const struct udevice_id *id;
 	struct driver *entry;
 	struct udevice *dev;
@@ -163,13 +295,8 @@ int lists_bind_fdt(struct udevice *parent, ofnode node, struct udevice **devp,
 		pr_debug("   - attempt to match compatible string '%s'\n",
 			 compat);
 
-		for (entry = driver; entry != driver + n_ents; entry++) {
-			ret = driver_check_compatible(entry->of_match, &id,
-						      compat);
-			if (!ret)
-				break;
-		}
-		if (entry == driver + n_ents)
+		entry = lists_driver_lookup_compatible(compat, &id);
+		if (!entry)
 			continue;
 
 		if (pre_reloc_only) {
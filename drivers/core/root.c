@@ -145,6 +145,16 @@ int dm_init(bool of_live)
 	fix_devices();
 #endif
 
+#if CONFIG_IS_ENABLED(DM_COMPAT_INDEX)
+	if (!gd->dm_compat) {
+		bootstage_start(BOOTSTATE_ID_ACCUM_DM_INDEX, "dm_index");
+		ret = lists_build_compat_index();
+		bootstage_accum(BOOTSTATE_ID_ACCUM_DM_INDEX);
+		if (ret)
+			dm_warn("Cannot build compatible index: %d\n", ret);
+	}
+#endif
+
 	ret = device_bind_by_name(NULL, false, &root_info, &DM_ROOT_NON_CONST);
 	if (ret)
 		return ret;
@@ -168,6 +178,10 @@ int dm_uninit(void)
 	device_remove(dm_root(), DM_REMOVE_NORMAL);
 	device_unbind(dm_root());
 	gd->dm_root = NULL;
+#if CONFIG_IS_ENABLED(DM_COMPAT_INDEX)
+	free(gd->dm_compat);
+	gd->dm_compat = NULL;
+#endif
 
 	return 0;
 }
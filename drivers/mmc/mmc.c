@@ -353,44 +353,58 @@ int mmc_send_tuning(struct mmc *mmc, u32 opcode, int *cmd_error)
 }
 #endif
 
-static int mmc_read_blocks(struct mmc *mmc, void *dst, lbaint_t start,
+static void mmc_setup_read(struct mmc *mmc, struct mmc_cmd *cmd,
+			   struct mmc_data *data, void *dst, lbaint_t start,
 			   lbaint_t blkcnt)
 {
-	struct mmc_cmd cmd;
-	struct mmc_data data;
-
 	if (blkcnt > 1)
-		cmd.cmdidx = MMC_CMD_READ_MULTIPLE_BLOCK;
+		cmd->cmdidx = MMC_CMD_READ_MULTIPLE_BLOCK;
 	else
-		cmd.cmdidx = MMC_CMD_READ_SINGLE_BLOCK;
+		cmd->cmdidx = MMC_CMD_READ_SINGLE_BLOCK;
 
 	if (mmc->high_capacity)
-		cmd.cmdarg = start;
+		cmd->cmdarg = start;
 	else
-		cmd.cmdarg = start * mmc->read_bl_len;
+		cmd->cmdarg = start * mmc->read_bl_len;
 
-	cmd.resp_type = MMC_RSP_R1;
+	cmd->resp_type = MMC_RSP_R1;
 
-	data.dest = dst;
-	data.blocks = blkcnt;
-	data.blocksize = mmc->read_bl_len;
-	data.flags = MMC_DATA_READ;
+	data->dest = dst;
+	data->blocks = blkcnt;
+	data->blocksize = mmc->read_bl_len;
+	data->flags = MMC_DATA_READ;
+}
 
-	if (mmc_send_cmd(mmc, &cmd, &data))
-		return 0;
+static int mmc_stop_read(struct mmc *mmc)
+{
+	struct mmc_cmd cmd;
 
-	if (blkcnt > 1) {
-		cmd.cmdidx = MMC_CMD_STOP_TRANSMISSION;
-		cmd.cmdarg = 0;
-		cmd.resp_type = MMC_RSP_R1b;
-		if (mmc_send_cmd(mmc, &cmd, NULL)) {
+	cmd.cmdidx = MMC_CMD_STOP_TRANSMISSION;
+	cmd.cmdarg = 0;
+	cmd.resp_type = MMC_RSP_R1b;
+	if (mmc_send_cmd(mmc, &cmd, NULL)) {
 #if !defined(CONFIG_SPL_BUILD) || defined(CONFIG_SPL_LIBCOMMON_SUPPORT)
-			pr_err("mmc fail to send stop cmd\n");
+		pr_err("mmc fail to send stop cmd\n");
 #endif
-			return 0;
-		}
+		return -EIO;
 	}
 
+	return 0;
+}
+
+static int mmc_read_blocks(struct mmc *mmc, void *dst, lbaint_t start,
+			   lbaint_t blkcnt)
+{
+	struct mmc_cmd cmd;
+	struct mmc_data data;
+
+	mmc_setup_read(mmc, &cmd, &data, dst, start, blkcnt);
+	if (mmc_send_cmd(mmc, &cmd, &data))
+		return 0;
+
+	if (blkcnt > 1 && mmc_stop_read(mmc))
+		return 0;
+
 	return blkcnt;
 }
 
@@ -451,6 +465,96 @@ ulong mmc_bread(struct blk_desc *block_dev, lbaint_t start, lbaint_t blkcnt,
 	return blkcnt;
 }
 
+#if CONFIG_IS_ENABLED(DM_MMC) && CONFIG_IS_ENABLED(BLK)
+/* Start reading the next part of an asynchronous request */
+static int mmc_async_next(struct mmc *mmc, struct blk_req *req)
+{
+	struct mmc_cmd cmd;
+	lbaint_t cur;
+
+	cur = min(req->blkcnt - mmc->req_done, (lbaint_t)mmc->cfg->b_max);
+	mmc_setup_read(mmc, &cmd, &mmc->req_data,
+		       req->buffer + mmc->req_done * mmc->read_bl_len,
+		       req->start + mmc->req_done, cur);
+
+	return dm_mmc_send_cmd_async(mmc->dev, &cmd, &mmc->req_data);
+}
+
+int mmc_bsubmit(struct udevice *dev, struct blk_req *req)
+{
+	struct blk_desc *block_dev = dev_get_uclass_platdata(dev);
+	struct mmc *mmc = find_mmc_device(block_dev->devnum);
+	int ret;
+
+	if (!mmc)
+		return -ENODEV;
+	if (req->op != BLK_REQ_READ || !req->blkcnt)
+		return -ENOSYS;
+	if (mmc->req)
+		return -EBUSY;
+	if (req->start + req->blkcnt > block_dev->lba)
+		return -EINVAL;
+
+	ret = blk_dselect_hwpart(block_dev, block_dev->hwpart);
+	if (ret < 0)
+		return ret;
+	ret = mmc_set_blocklen(mmc, mmc->read_bl_len);
+	if (ret)
+		return ret;
+
+	mmc->req_done = 0;
+	ret = mmc_async_next(mmc, req);
+	if (ret)
+		return ret;
+	mmc->req = req;
+
+	return 0;
+}
+
+static void mmc_async_poll(struct mmc *mmc)
+{
+	struct blk_req *req = mmc->req;
+	int ret;
+
+	ret = dm_mmc_poll_data(mmc->dev, &mmc->req_data);
+	if (ret == -EINPROGRESS)
+		return;
+
+	/* Other commands can be sent again */
+	mmc->req = NULL;
+	if (!ret && mmc->req_data.blocks > 1)
+		ret = mmc_stop_read(mmc);
+	if (!ret) {
+		mmc->req_done += mmc->req_data.blocks;
+		if (mmc->req_done < req->blkcnt) {
+			ret = mmc_async_next(mmc, req);
+			if (!ret) {
+				mmc->req = req;
+				return;
+			}
+		}
+	}
+	blk_req_done(req, ret);
+}
+
+int mmc_bpoll(struct udevice *dev)
+{
+	struct blk_desc *block_dev = dev_get_uclass_platdata(dev);
+	struct mmc *mmc = find_mmc_device(block_dev->devnum);
+
+	if (mmc && mmc->req)
+		mmc_async_poll(mmc);
+
+	return 0;
+}
+
+void mmc_async_finish(struct mmc *mmc)
+{
+	while (mmc->req)
+		mmc_async_poll(mmc);
+}
+#endif
+
 static int mmc_go_idle(struct mmc *mmc)
 {
 	struct mmc_cmd cmd;
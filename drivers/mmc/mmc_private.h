@@ -22,6 +22,21 @@ void mmc_adapter_card_type_ident(void);
 #if CONFIG_IS_ENABLED(BLK)
 ulong mmc_bread(struct udevice *dev, lbaint_t start, lbaint_t blkcnt,
 		void *dst);
+
+/**
+ * mmc_bsubmit() - start an asynchronous block request
+ *
+ * Reads are started with the controller's send_cmd_async() method, if it
+ * has one, so that the data is transferred while the caller gets on with
+ * other things. Other requests return -ENOSYS and are handled synchronously.
+ */
+int mmc_bsubmit(struct udevice *dev, struct blk_req *req);
+
+/* mmc_bpoll() - check the asynchronous read in progress, if any */
+int mmc_bpoll(struct udevice *dev);
+
+/* mmc_async_finish() - wait for the asynchronous read in progress, if any */
+void mmc_async_finish(struct mmc *mmc);
 #else
 ulong mmc_bread(struct blk_desc *block_dev, lbaint_t start, lbaint_t blkcnt,
 		void *dst);
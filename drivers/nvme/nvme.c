@@ -12,13 +12,12 @@
 #include <dm/device-internal.h>
 #include "nvme.h"
 
-#define NVME_Q_DEPTH		2
+#define NVME_Q_DEPTH		CONFIG_NVME_QUEUE_DEPTH
 #define NVME_AQ_DEPTH		2
 #define NVME_SQ_SIZE(depth)	(depth * sizeof(struct nvme_command))
 #define NVME_CQ_SIZE(depth)	(depth * sizeof(struct nvme_completion))
 #define ADMIN_TIMEOUT		60
 #define IO_TIMEOUT		30
-#define MAX_PRP_POOL		512
 
 enum nvme_queue_id {
 	NVME_ADMIN_Q,
@@ -65,57 +64,47 @@ static int nvme_wait_ready(struct nvme_dev *dev, bool enabled)
 	return -ETIME;
 }
 
-static int nvme_setup_prps(struct nvme_dev *dev, u64 *prp2,
-			   int total_len, u64 dma_addr)
+/**
+ * nvme_setup_prps() - work out the second PRP entry of a command
+ *
+ * A transfer which spans more than two pages has its page addresses listed
+ * in @prp_list, which must be a page which can hold all of them.
+ *
+ * @dev:	NVMe device
+ * @prp_list:	Page to use for the PRP list
+ * @prp2:	Returns the second PRP entry
+ * @total_len:	Number of bytes to transfer
+ * @dma_addr:	Address of the data
+ */
+static void nvme_setup_prps(struct nvme_dev *dev, u64 *prp_list, u64 *prp2,
+			    int total_len, u64 dma_addr)
 {
 	u32 page_size = dev->page_size;
 	int offset = dma_addr & (page_size - 1);
-	u64 *prp_pool;
 	int length = total_len;
 	int i, nprps;
 	length -= (page_size - offset);
 
 	if (length <= 0) {
 		*prp2 = 0;
-		return 0;
+		return;
 	}
 
-	if (length)
-		dma_addr += (page_size - offset);
+	dma_addr += (page_size - offset);
 
 	if (length <= page_size) {
 		*prp2 = dma_addr;
-		return 0;
+		return;
 	}
 
 	nprps = DIV_ROUND_UP(length, page_size);
-
-	if (nprps > dev->prp_entry_num) {
-		free(dev->prp_pool);
-		dev->prp_pool = malloc(nprps << 3);
-		if (!dev->prp_pool) {
-			printf("Error: malloc prp_pool fail\n");
-			return -ENOMEM;
-		}
-		dev->prp_entry_num = nprps;
-	}
-
-	prp_pool = dev->prp_pool;
-	i = 0;
-	while (nprps) {
-		if (i == ((page_size >> 3) - 1)) {
-			*(prp_pool + i) = cpu_to_le64((ulong)prp_pool +
-					page_size);
-			i = 0;
-			prp_pool += page_size;
-		}
-		*(prp_pool + i++) = cpu_to_le64(dma_addr);
+	for (i = 0; i < nprps; i++) {
+		prp_list[i] = cpu_to_le64(dma_addr);
 		dma_addr += page_size;
-		nprps--;
 	}
-	*prp2 = (ulong)dev->prp_pool;
-
-	return 0;
+	flush_dcache_range((ulong)prp_list, (ulong)prp_list +
+			   roundup(nprps << 3, ARCH_DMA_MINALIGN));
+	*prp2 = (ulong)prp_list;
 }
 
 static __le16 nvme_get_cmd_id(void)
@@ -136,12 +125,12 @@ static u16 nvme_read_completion_status(struct nvme_queue *nvmeq, u16 index)
 }
 
 /**
- * nvme_submit_cmd() - copy a command into a queue and ring the doorbell
+ * nvme_queue_cmd() - copy a command into a queue without ringing the doorbell
  *
  * @nvmeq:	The queue to use
  * @cmd:	The command to send
  */
-static void nvme_submit_cmd(struct nvme_queue *nvmeq, struct nvme_command *cmd)
+static void nvme_queue_cmd(struct nvme_queue *nvmeq, struct nvme_command *cmd)
 {
 	u16 tail = nvmeq->sq_tail;
 
@@ -151,51 +140,44 @@ static void nvme_submit_cmd(struct nvme_queue *nvmeq, struct nvme_command *cmd)
 
 	if (++tail == nvmeq->q_depth)
 		tail = 0;
-	writel(tail, nvmeq->q_db);
 	nvmeq->sq_tail = tail;
 }
 
-static int nvme_submit_sync_cmd(struct nvme_queue *nvmeq,
-				struct nvme_command *cmd,
-				u32 *result, unsigned timeout)
+/**
+ * nvme_submit_cmd() - copy a command into a queue and ring the doorbell
+ *
+ * @nvmeq:	The queue to use
+ * @cmd:	The command to send
+ */
+static void nvme_submit_cmd(struct nvme_queue *nvmeq, struct nvme_command *cmd)
+{
+	nvme_queue_cmd(nvmeq, cmd);
+	writel(nvmeq->sq_tail, nvmeq->q_db);
+}
+
+/**
+ * nvme_reap_cmd() - collect the completion of the oldest command on a queue
+ *
+ * @nvmeq:	The queue to check
+ * @result:	Returns the command-specific result, if not NULL
+ * @return 0 if the command completed successfully, -EINPROGRESS if it has
+ * not completed yet, -EIO if it failed
+ */
+static int nvme_reap_cmd(struct nvme_queue *nvmeq, u32 *result)
 {
 	u16 head = nvmeq->cq_head;
 	u16 phase = nvmeq->cq_phase;
 	u16 status;
-	ulong start_time;
-	ulong timeout_us = timeout * 100000;
-
-	cmd->common.command_id = nvme_get_cmd_id();
-	nvme_submit_cmd(nvmeq, cmd);
-
-	start_time = timer_get_us();
 
-	for (;;) {
-		status = nvme_read_completion_status(nvmeq, head);
-		if ((status & 0x01) == phase)
-			break;
-		if (timeout_us > 0 && (timer_get_us() - start_time)
-		    >= timeout_us)
-			return -ETIMEDOUT;
-	}
+	status = nvme_read_completion_status(nvmeq, head);
+	if ((status & 0x01) != phase)
+		return -EINPROGRESS;
 
 	status >>= 1;
-	if (status) {
+	if (status)
 		printf("ERROR: status = %x, phase = %d, head = %d\n",
 		       status, phase, head);
-		status = 0;
-		if (++head == nvmeq->q_depth) {
-			head = 0;
-			phase = !phase;
-		}
-		writel(head, nvmeq->q_db + nvmeq->dev->db_stride);
-		nvmeq->cq_head = head;
-		nvmeq->cq_phase = phase;
-
-		return -EIO;
-	}
-
-	if (result)
+	else if (result)
 		*result = le32_to_cpu(readl(&(nvmeq->cqes[head].result)));
 
 	if (++head == nvmeq->q_depth) {
@@ -206,7 +188,30 @@ static int nvme_submit_sync_cmd(struct nvme_queue *nvmeq,
 	nvmeq->cq_head = head;
 	nvmeq->cq_phase = phase;
 
-	return status;
+	return status ? -EIO : 0;
+}
+
+static int nvme_submit_sync_cmd(struct nvme_queue *nvmeq,
+				struct nvme_command *cmd,
+				u32 *result, unsigned timeout)
+{
+	ulong start_time;
+	ulong timeout_us = timeout * 100000;
+	int ret;
+
+	cmd->common.command_id = nvme_get_cmd_id();
+	nvme_submit_cmd(nvmeq, cmd);
+
+	start_time = timer_get_us();
+
+	for (;;) {
+		ret = nvme_reap_cmd(nvmeq, result);
+		if (ret != -EINPROGRESS)
+			return ret;
+		if (timeout_us > 0 && (timer_get_us() - start_time)
+		    >= timeout_us)
+			return -ETIMEDOUT;
+	}
 }
 
 static int nvme_submit_admin_cmd(struct nvme_dev *dev, struct nvme_command *cmd,
@@ -668,65 +673,244 @@ static int nvme_blk_probe(struct udevice *udev)
 	return 0;
 }
 
-static ulong nvme_blk_rw(struct udevice *udev, lbaint_t blknr,
-			 lbaint_t blkcnt, void *buffer, bool read)
+static void nvme_init_rw_cmd(struct nvme_ns *ns, struct nvme_command *c,
+			     bool read)
 {
-	struct nvme_ns *ns = dev_get_priv(udev);
-	struct nvme_dev *dev = ns->dev;
+	c->rw.opcode = read ? nvme_cmd_read : nvme_cmd_write;
+	c->rw.flags = 0;
+	c->rw.nsid = cpu_to_le32(ns->ns_id);
+	c->rw.control = 0;
+	c->rw.dsmgmt = 0;
+	c->rw.reftag = 0;
+	c->rw.apptag = 0;
+	c->rw.appmask = 0;
+	c->rw.metadata = 0;
+}
+
+/**
+ * nvme_xfer_fill() - submit commands of a transfer into all free I/O slots
+ *
+ * The doorbell is rung once for all of the commands.
+ *
+ * @dev:	NVMe device
+ * @xfer:	Transfer to continue
+ * @return number of commands submitted
+ */
+static int nvme_xfer_fill(struct nvme_dev *dev, struct nvme_xfer *xfer)
+{
+	struct nvme_queue *nvmeq = dev->queues[NVME_IO_Q];
+	struct nvme_ns *ns = xfer->ns;
+	u32 max_lbas = min_t(u32, dev->max_xfer_len >> ns->lba_shift, 0x10000);
 	struct nvme_command c;
-	struct blk_desc *desc = dev_get_uclass_platdata(udev);
-	int status;
+	struct nvme_slot *slot;
+	void *buffer;
+	int count = 0;
 	u64 prp2;
-	u64 total_len = blkcnt << desc->log2blksz;
-	u64 temp_len = total_len;
-
-	u64 slba = blknr;
-	u16 lbas = 1 << (dev->max_transfer_shift - ns->lba_shift);
-	u64 total_lbas = blkcnt;
+	u32 lbas;
+	int id;
 
-	if (!read)
-		flush_dcache_range((unsigned long)buffer,
-				   (unsigned long)buffer + total_len);
-
-	c.rw.opcode = read ? nvme_cmd_read : nvme_cmd_write;
-	c.rw.flags = 0;
-	c.rw.nsid = cpu_to_le32(ns->ns_id);
-	c.rw.control = 0;
-	c.rw.dsmgmt = 0;
-	c.rw.reftag = 0;
-	c.rw.apptag = 0;
-	c.rw.appmask = 0;
-	c.rw.metadata = 0;
-
-	while (total_lbas) {
-		if (total_lbas < lbas) {
-			lbas = (u16)total_lbas;
-			total_lbas = 0;
-		} else {
-			total_lbas -= lbas;
-		}
+	memset(&c, 0, sizeof(c));
+	nvme_init_rw_cmd(ns, &c, xfer->read);
 
-		if (nvme_setup_prps(dev, &prp2,
-				    lbas << ns->lba_shift, (ulong)buffer))
-			return -EIO;
-		c.rw.slba = cpu_to_le64(slba);
-		slba += lbas;
+	for (id = 0; id < dev->nslots; id++) {
+		if (xfer->status || xfer->queued == xfer->blkcnt)
+			break;
+		slot = &dev->slots[id];
+		if (slot->busy)
+			continue;
+
+		lbas = min_t(u64, xfer->blkcnt - xfer->queued, max_lbas);
+		buffer = xfer->buffer + (xfer->queued << ns->lba_shift);
+		nvme_setup_prps(dev, slot->prp_list, &prp2,
+				lbas << ns->lba_shift, (ulong)buffer);
+		c.rw.slba = cpu_to_le64(xfer->slba + xfer->queued);
 		c.rw.length = cpu_to_le16(lbas - 1);
 		c.rw.prp1 = cpu_to_le64((ulong)buffer);
 		c.rw.prp2 = cpu_to_le64(prp2);
-		status = nvme_submit_sync_cmd(dev->queues[NVME_IO_Q],
-				&c, NULL, IO_TIMEOUT);
-		if (status)
+		c.common.command_id = cpu_to_le16(id);
+		nvme_queue_cmd(nvmeq, &c);
+
+		slot->busy = true;
+		slot->xfer = xfer;
+		slot->lbas = lbas;
+		xfer->queued += lbas;
+		count++;
+	}
+	if (count)
+		writel(nvmeq->sq_tail, nvmeq->q_db);
+
+	return count;
+}
+
+/**
+ * nvme_reap_io() - collect all completions posted on the I/O queue
+ *
+ * The completion queue head doorbell is written once for all of them.
+ *
+ * @dev:	NVMe device
+ * @return number of completions collected
+ */
+static int nvme_reap_io(struct nvme_dev *dev)
+{
+	struct nvme_queue *nvmeq = dev->queues[NVME_IO_Q];
+	u16 head = nvmeq->cq_head;
+	u16 phase = nvmeq->cq_phase;
+	struct nvme_slot *slot;
+	int count = 0;
+	u16 status;
+	u16 id;
+
+	for (;;) {
+		status = nvme_read_completion_status(nvmeq, head);
+		if ((status & 0x01) != phase)
 			break;
-		temp_len -= (u32)lbas << ns->lba_shift;
-		buffer += lbas << ns->lba_shift;
+
+		status >>= 1;
+		id = le16_to_cpu(readw(&nvmeq->cqes[head].command_id));
+		if (id < dev->nslots && dev->slots[id].busy) {
+			slot = &dev->slots[id];
+			if (status) {
+				printf("ERROR: status = %x, id = %d\n",
+				       status, id);
+				if (slot->xfer)
+					slot->xfer->status = -EIO;
+			}
+			if (slot->xfer) {
+				slot->xfer->done += slot->lbas;
+				slot->xfer->time = timer_get_us();
+			}
+			slot->xfer = NULL;
+			slot->busy = false;
+		}
+
+		if (++head == nvmeq->q_depth) {
+			head = 0;
+			phase = !phase;
+		}
+		count++;
+	}
+
+	if (count) {
+		writel(head, nvmeq->q_db + dev->db_stride);
+		nvmeq->cq_head = head;
+		nvmeq->cq_phase = phase;
+	}
+
+	return count;
+}
+
+static void nvme_xfer_start(struct nvme_xfer *xfer, struct nvme_ns *ns,
+			    u64 slba, u64 blkcnt, void *buffer, bool read)
+{
+	xfer->ns = ns;
+	xfer->read = read;
+	xfer->buffer = buffer;
+	xfer->slba = slba;
+	xfer->blkcnt = blkcnt;
+	xfer->queued = 0;
+	xfer->done = 0;
+	xfer->status = 0;
+	xfer->time = timer_get_us();
+
+	if (!read)
+		flush_dcache_range((ulong)buffer,
+				   (ulong)buffer + (blkcnt << ns->lba_shift));
+}
+
+/**
+ * nvme_xfer_step() - make progress on a transfer without waiting
+ *
+ * Commands which are still outstanding when the transfer times out are left
+ * in their slots until the controller completes them, but no longer count
+ * towards the transfer.
+ *
+ * @dev:	NVMe device
+ * @xfer:	Transfer to continue
+ * @return -EINPROGRESS if the transfer is not finished yet, 0 if it finished
+ * successfully, other -ve on error
+ */
+static int nvme_xfer_step(struct nvme_dev *dev, struct nvme_xfer *xfer)
+{
+	int id;
+
+	nvme_reap_io(dev);
+	if (nvme_xfer_fill(dev, xfer))
+		xfer->time = timer_get_us();
+
+	if (xfer->done != xfer->queued ||
+	    (!xfer->status && xfer->queued != xfer->blkcnt)) {
+		if (timer_get_us() - xfer->time < IO_TIMEOUT * 100000)
+			return -EINPROGRESS;
+		for (id = 0; id < dev->nslots; id++) {
+			if (dev->slots[id].xfer == xfer)
+				dev->slots[id].xfer = NULL;
+		}
+		xfer->status = -ETIMEDOUT;
 	}
 
-	if (read)
-		invalidate_dcache_range((unsigned long)buffer,
-					(unsigned long)buffer + total_len);
+	if (xfer->read)
+		invalidate_dcache_range((ulong)xfer->buffer,
+					(ulong)xfer->buffer +
+					(xfer->blkcnt << xfer->ns->lba_shift));
+
+	return xfer->status;
+}
+
+static int nvme_blk_submit(struct udevice *udev, struct blk_req *req)
+{
+	struct nvme_ns *ns = dev_get_priv(udev);
+	struct nvme_dev *dev = ns->dev;
+
+	if (dev->req)
+		return -EBUSY;
 
-	return (total_len - temp_len) >> desc->log2blksz;
+	nvme_xfer_start(&dev->async, ns, req->start, req->blkcnt,
+			req->buffer, req->op == BLK_REQ_READ);
+	dev->req = req;
+	nvme_xfer_fill(dev, &dev->async);
+
+	return 0;
+}
+
+/* All namespaces share the I/O queue, so this handles any of them */
+static int nvme_blk_poll(struct udevice *udev)
+{
+	struct nvme_ns *ns = dev_get_priv(udev);
+	struct nvme_dev *dev = ns->dev;
+	struct blk_req *req = dev->req;
+	int ret;
+
+	if (!req)
+		return 0;
+
+	ret = nvme_xfer_step(dev, &dev->async);
+	if (ret == -EINPROGRESS)
+		return 0;
+
+	dev->req = NULL;
+	blk_req_done(req, ret);
+
+	return 0;
+}
+
+static ulong nvme_blk_rw(struct udevice *udev, lbaint_t blknr,
+			 lbaint_t blkcnt, void *buffer, bool read)
+{
+	struct nvme_ns *ns = dev_get_priv(udev);
+	struct nvme_dev *dev = ns->dev;
+	struct nvme_xfer xfer;
+	int ret;
+
+	/* Finish any asynchronous request, the timeout is for this one */
+	while (dev->req)
+		nvme_blk_poll(udev);
+
+	nvme_xfer_start(&xfer, ns, blknr, blkcnt, buffer, read);
+	do {
+		ret = nvme_xfer_step(dev, &xfer);
+	} while (ret == -EINPROGRESS);
+
+	return ret ? 0 : blkcnt;
 }
 
 static ulong nvme_blk_read(struct udevice *udev, lbaint_t blknr,
@@ -744,6 +928,8 @@ static ulong nvme_blk_write(struct udevice *udev, lbaint_t blknr,
 static const struct blk_ops nvme_blk_ops = {
 	.read	= nvme_blk_read,
 	.write	= nvme_blk_write,
+	.submit	= nvme_blk_submit,
+	.poll	= nvme_blk_poll,
 };
 
 U_BOOT_DRIVER(nvme_blk) = {
@@ -764,6 +950,39 @@ static int nvme_bind(struct udevice *udev)
 	return device_set_name(udev, name);
 }
 
+/*
+ * Set up a slot for each command the I/O queue can hold, with a PRP list
+ * page big enough for the largest transfer a command is given
+ */
+static int nvme_alloc_slots(struct nvme_dev *dev)
+{
+	u32 page_size = dev->page_size;
+	int i;
+
+	dev->max_xfer_len = min_t(u64, 1ULL << dev->max_transfer_shift,
+				  (u64)(page_size >> 3) * page_size);
+	dev->nslots = dev->q_depth - 1;
+	dev->slots = calloc(dev->nslots, sizeof(struct nvme_slot));
+	if (!dev->slots)
+		return -ENOMEM;
+
+	for (i = 0; i < dev->nslots; i++) {
+		dev->slots[i].prp_list = memalign(page_size, page_size);
+		if (!dev->slots[i].prp_list)
+			goto err;
+	}
+
+	return 0;
+
+err:
+	while (i--)
+		free(dev->slots[i].prp_list);
+	free(dev->slots);
+	dev->slots = NULL;
+
+	return -ENOMEM;
+}
+
 static int nvme_probe(struct udevice *udev)
 {
 	int ret;
@@ -788,14 +1007,6 @@ static int nvme_probe(struct udevice *udev)
 	}
 	memset(ndev->queues, 0, NVME_Q_NUM * sizeof(struct nvme_queue *));
 
-	ndev->prp_pool = malloc(MAX_PRP_POOL);
-	if (!ndev->prp_pool) {
-		ret = -ENOMEM;
-		printf("Error: %s: Out of memory!\n", udev->name);
-		goto free_nvme;
-	}
-	ndev->prp_entry_num = MAX_PRP_POOL >> 3;
-
 	ndev->cap = nvme_readq(&ndev->bar->cap);
 	ndev->q_depth = min_t(int, NVME_CAP_MQES(ndev->cap) + 1, NVME_Q_DEPTH);
 	ndev->db_stride = 1 << NVME_CAP_STRIDE(ndev->cap);
@@ -811,6 +1022,12 @@ static int nvme_probe(struct udevice *udev)
 
 	nvme_get_info_from_identify(ndev);
 
+	ret = nvme_alloc_slots(ndev);
+	if (ret) {
+		printf("Error: %s: Out of memory!\n", udev->name);
+		goto free_queue;
+	}
+
 	return 0;
 
 free_queue:
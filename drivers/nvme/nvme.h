@@ -602,6 +602,31 @@ enum {
 	NVME_CSTS_SHST_MASK	= 3 << 2,
 };
 
+/*
+ * A block transfer, split into I/O commands which are in flight together
+ */
+struct nvme_xfer {
+	struct nvme_ns *ns;
+	bool read;
+	void *buffer;
+	u64 slba;
+	u64 blkcnt;
+	u64 queued;	/* blocks submitted so far */
+	u64 done;	/* blocks completed so far */
+	int status;
+	ulong time;	/* time of the last progress, in us */
+};
+
+/*
+ * An entry of the I/O queue, the command ID is its index in nvme_dev.slots
+ */
+struct nvme_slot {
+	struct nvme_xfer *xfer;	/* NULL if the transfer was abandoned */
+	u64 *prp_list;		/* a page for the PRP list of the command */
+	u32 lbas;
+	bool busy;
+};
+
 /* Represents an NVM Express device. Each nvme_dev is a PCI function. */
 struct nvme_dev {
 	struct list_head node;
@@ -624,9 +649,12 @@ struct nvme_dev {
 	u32 stripe_size;
 	u32 page_size;
 	u8 vwc;
-	u64 *prp_pool;
-	u32 prp_entry_num;
 	u32 nn;
+	u32 max_xfer_len;	/* most bytes moved by one I/O command */
+	struct nvme_slot *slots; /* one per I/O command which can be queued */
+	int nslots;
+	struct nvme_xfer async;	/* transfer of @req */
+	struct blk_req *req;	/* asynchronous request in progress */
 };
 
 /*
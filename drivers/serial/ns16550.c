@@ -322,6 +322,29 @@ static int ns16550_serial_putc(struct udevice *dev, const char ch)
 	return 0;
 }
 
+#if CONFIG_IS_ENABLED(SERIAL_PUTS)
+static ssize_t ns16550_serial_puts(struct udevice *dev, const char *s,
+				   size_t len)
+{
+	struct NS16550 *const com_port = dev_get_priv(dev);
+	size_t i;
+
+	/* Once the transmitter is empty, the whole FIFO can be filled */
+	if (!(serial_in(&com_port->lsr) & UART_LSR_THRE))
+		return -EAGAIN;
+
+	len = min_t(size_t, len, com_port->fifo_size);
+	for (i = 0; i < len; i++)
+		serial_out(s[i], &com_port->thr);
+
+	/* See ns16550_serial_putc() */
+	if (s[len - 1] == '\n')
+		WATCHDOG_RESET();
+
+	return len;
+}
+#endif
+
 static int ns16550_serial_pending(struct udevice *dev, bool input)
 {
 	struct NS16550 *const com_port = dev_get_priv(dev);
@@ -420,6 +443,12 @@ int ns16550_serial_probe(struct udevice *dev)
 	com_port->plat = dev_get_platdata(dev);
 	NS16550_init(com_port, -1);
 
+	/* Without a working FIFO, only the holding register can be filled */
+	if ((serial_in(&com_port->iir) & UART_IIR_FIFO) == UART_IIR_FIFO)
+		com_port->fifo_size = 16;
+	else
+		com_port->fifo_size = 1;
+
 	return 0;
 }
 
@@ -511,6 +540,9 @@ int ns16550_serial_ofdata_to_platdata(struct udevice *dev)
 
 const struct dm_serial_ops ns16550_serial_ops = {
 	.putc = ns16550_serial_putc,
+#if CONFIG_IS_ENABLED(SERIAL_PUTS)
+	.puts = ns16550_serial_puts,
+#endif
 	.pending = ns16550_serial_pending,
 	.getc = ns16550_serial_getc,
 	.setbrg = ns16550_serial_setbrg,
@@ -183,10 +183,47 @@ static void _serial_putc(struct udevice *dev, char ch)
 	} while (err == -EAGAIN);
 }
 
+/* Write @len characters with the puts() method, waiting for room as needed */
+static int _serial_write(struct udevice *dev, const char *s, size_t len)
+{
+	struct dm_serial_ops *ops = serial_get_ops(dev);
+	ssize_t written;
+
+	while (len) {
+		written = ops->puts(dev, s, len);
+		if (written == -EAGAIN)
+			continue;
+		if (written < 0)
+			return written;
+		s += written;
+		len -= written;
+	}
+
+	return 0;
+}
+
 static void _serial_puts(struct udevice *dev, const char *str)
 {
-	while (*str)
-		_serial_putc(dev, *str++);
+	struct dm_serial_ops *ops = serial_get_ops(dev);
+	const char *end;
+
+	if (!CONFIG_IS_ENABLED(SERIAL_PUTS) || !ops->puts) {
+		while (*str)
+			_serial_putc(dev, *str++);
+		return;
+	}
+
+	/* Write up to each newline, then "\r\n" in place of it */
+	while (*str) {
+		end = strchrnul(str, '\n');
+		if (_serial_write(dev, str, end - str))
+			return;
+		if (!*end)
+			break;
+		if (_serial_write(dev, "\r\n", 2))
+			return;
+		str = end + 1;
+	}
 }
 
 static int __serial_getc(struct udevice *dev)
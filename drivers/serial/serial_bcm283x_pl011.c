@@ -72,6 +72,9 @@ static int bcm283x_pl011_serial_setbrg(struct udevice *dev, int baudrate)
 
 static const struct dm_serial_ops bcm283x_pl011_serial_ops = {
 	.putc = pl01x_serial_putc,
+#if CONFIG_IS_ENABLED(SERIAL_PUTS)
+	.puts = pl01x_serial_puts,
+#endif
 	.pending = pl01x_serial_pending,
 	.getc = pl01x_serial_getc,
 	.setbrg = bcm283x_pl011_serial_setbrg,
@@ -312,6 +312,23 @@ int pl01x_serial_putc(struct udevice *dev, const char ch)
 	return pl01x_putc(priv->regs, ch);
 }
 
+#if CONFIG_IS_ENABLED(SERIAL_PUTS)
+ssize_t pl01x_serial_puts(struct udevice *dev, const char *s, size_t len)
+{
+	struct pl01x_priv *priv = dev_get_priv(dev);
+	size_t i;
+
+	/* Fill the FIFO until it is full */
+	for (i = 0; i < len; i++) {
+		if (readl(&priv->regs->fr) & UART_PL01x_FR_TXFF)
+			break;
+		writel(s[i], &priv->regs->dr);
+	}
+
+	return i ? i : -EAGAIN;
+}
+#endif
+
 int pl01x_serial_pending(struct udevice *dev, bool input)
 {
 	struct pl01x_priv *priv = dev_get_priv(dev);
@@ -325,6 +342,9 @@ int pl01x_serial_pending(struct udevice *dev, bool input)
 
 static const struct dm_serial_ops pl01x_serial_ops = {
 	.putc = pl01x_serial_putc,
+#if CONFIG_IS_ENABLED(SERIAL_PUTS)
+	.puts = pl01x_serial_puts,
+#endif
 	.pending = pl01x_serial_pending,
 	.getc = pl01x_serial_getc,
 	.setbrg = pl01x_serial_setbrg,
@@ -45,6 +45,7 @@ int pl01x_serial_probe(struct udevice *dev);
 
 /* Needed for external pl01x_serial_ops drivers */
 int pl01x_serial_putc(struct udevice *dev, const char ch);
+ssize_t pl01x_serial_puts(struct udevice *dev, const char *s, size_t len);
 int pl01x_serial_pending(struct udevice *dev, bool input);
 int pl01x_serial_getc(struct udevice *dev);
 int pl01x_serial_setbrg(struct udevice *dev, int baudrate);
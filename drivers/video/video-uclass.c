@@ -38,6 +38,12 @@
  * video_post_probe(). This function also clears the frame buffer and
  * allocates a suitable text console device. This can then be used to write
  * text to the video device.
+ *
+ * With CONFIG_VIDEO_COPY a second buffer of the same size is reserved below
+ * each frame buffer (plat->shadow_base). Everything draws into this one,
+ * which is normal cached memory, and records the region it changed with
+ * video_damage(). video_sync() then copies just that region to the hardware
+ * frame buffer, so that it is never read back.
  */
 DECLARE_GLOBAL_DATA_PTR;
 
@@ -60,6 +66,10 @@ static ulong alloc_fb(struct udevice *dev, ulong *addrp)
 	base = *addrp - plat->size;
 	base &= ~(align - 1);
 	plat->base = base;
+	if (IS_ENABLED(CONFIG_VIDEO_COPY)) {
+		base = (base - plat->size) & ~(align - 1);
+		plat->shadow_base = base;
+	}
 	size = *addrp - base;
 	*addrp = base;
 
@@ -111,6 +121,7 @@ int video_clear(struct udevice *dev)
 		memset(priv->fb, priv->colour_bg, priv->fb_size);
 		break;
 	}
+	video_damage(dev, 0, 0, priv->xsize, priv->ysize);
 
 	return 0;
 }
@@ -141,31 +152,95 @@ void video_set_default_colors(struct udevice *dev, bool invert)
 	priv->colour_bg = vid_console_color(priv, back);
 }
 
+void video_damage(struct udevice *vid, int x, int y, int width, int height)
+{
+	struct video_priv *priv = dev_get_uclass_priv(vid);
+	int xend = min(x + width, (int)priv->xsize);
+	int yend = min(y + height, (int)priv->ysize);
+
+	x = max(x, 0);
+	y = max(y, 0);
+	if (x >= xend || y >= yend)
+		return;
+
+	if (!priv->damage.xend) {
+		priv->damage.xstart = x;
+		priv->damage.ystart = y;
+		priv->damage.xend = xend;
+		priv->damage.yend = yend;
+	} else {
+		priv->damage.xstart = min(priv->damage.xstart, x);
+		priv->damage.ystart = min(priv->damage.ystart, y);
+		priv->damage.xend = max(priv->damage.xend, xend);
+		priv->damage.yend = max(priv->damage.yend, yend);
+	}
+}
+
+/* Copy the damaged region of the shadow frame buffer to the hardware one */
+static void video_copy_damage(struct video_priv *priv)
+{
+	int bits = VNBITS(priv->bpix);
+	ulong start = priv->damage.xstart * bits / 8;
+	ulong end = DIV_ROUND_UP(priv->damage.xend * bits, 8);
+	ulong offset = priv->damage.ystart * priv->line_length;
+	int y;
+
+	if (!priv->copy_fb)
+		return;
+	if (start == 0 && end >= priv->line_length) {
+		memcpy(priv->copy_fb + offset, priv->fb + offset,
+		       (priv->damage.yend - priv->damage.ystart) *
+		       priv->line_length);
+		return;
+	}
+	for (y = priv->damage.ystart; y < priv->damage.yend; y++) {
+		memcpy(priv->copy_fb + offset + start,
+		       priv->fb + offset + start, end - start);
+		offset += priv->line_length;
+	}
+}
+
 /* Flush video activity to the caches */
 void video_sync(struct udevice *vid, bool force)
 {
+	struct video_priv *priv = dev_get_uclass_priv(vid);
+
+	/*
+	 * Not everything which writes to the frame buffer reports damage,
+	 * e.g. EFI applications drawing into the GOP frame buffer, so sync
+	 * all of it when asked to or when there is nothing more precise
+	 */
+	if (force || !priv->damage.xend)
+		video_damage(vid, 0, 0, priv->xsize, priv->ysize);
+
 	/*
 	 * flush_dcache_range() is declared in common.h but it seems that some
 	 * architectures do not actually implement it. Is there a way to find
 	 * out whether it exists? For now, ARM is safe.
 	 */
 #if defined(CONFIG_ARM) && !CONFIG_IS_ENABLED(SYS_DCACHE_OFF)
-	struct video_priv *priv = dev_get_uclass_priv(vid);
-
+	video_copy_damage(priv);
 	if (priv->flush_dcache) {
-		flush_dcache_range((ulong)priv->fb,
-				   ALIGN((ulong)priv->fb + priv->fb_size,
-					 CONFIG_SYS_CACHELINE_SIZE));
+		ulong fb = (ulong)(priv->copy_fb ? priv->copy_fb : priv->fb);
+		ulong start = fb + priv->damage.ystart * priv->line_length;
+		ulong end = fb + priv->damage.yend * priv->line_length;
+
+		flush_dcache_range(ALIGN_DOWN(start, CONFIG_SYS_CACHELINE_SIZE),
+				   ALIGN(end, CONFIG_SYS_CACHELINE_SIZE));
 	}
 #elif defined(CONFIG_VIDEO_SANDBOX_SDL)
-	struct video_priv *priv = dev_get_uclass_priv(vid);
 	static ulong last_sync;
 
-	if (force || get_timer(last_sync) > 10) {
-		sandbox_sdl_sync(priv->fb);
-		last_sync = get_timer(0);
-	}
+	/* Let the damage build up until the display is next updated */
+	if (!force && get_timer(last_sync) <= 10)
+		return;
+	video_copy_damage(priv);
+	sandbox_sdl_sync(priv->copy_fb ? priv->copy_fb : priv->fb);
+	last_sync = get_timer(0);
+#else
+	video_copy_damage(priv);
 #endif
+	priv->damage.xend = 0;
 }
 
 void video_sync_all(void)
@@ -232,11 +307,22 @@ static int video_post_probe(struct udevice *dev)
 
 	priv->fb_size = priv->line_length * priv->ysize;
 
+	/* Draw into the shadow frame buffer, if there is one */
+	if (IS_ENABLED(CONFIG_VIDEO_COPY) && plat->shadow_base &&
+	    priv->fb_size <= plat->size) {
+		priv->copy_fb = priv->fb;
+		priv->fb = map_sysmem(plat->shadow_base, plat->size);
+		if (CONFIG_IS_ENABLED(NO_FB_CLEAR))
+			memcpy(priv->fb, priv->copy_fb, priv->fb_size);
+	}
+
 	/* Set up colors  */
 	video_set_default_colors(dev, false);
 
-	if (!CONFIG_IS_ENABLED(NO_FB_CLEAR))
+	if (!CONFIG_IS_ENABLED(NO_FB_CLEAR)) {
 		video_clear(dev);
+		video_sync(dev, true);
+	}
 
 	/*
 	 * Create a text console device. For now we always do this, although
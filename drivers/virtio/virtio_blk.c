@@ -10,48 +10,256 @@
 #include <virtio_types.h>
 #include <virtio.h>
 #include <virtio_ring.h>
+#include <linux/sizes.h>
 #include "virtio_blk.h"
 
+/* Most data in one request, if the device allows more */
+#define VIRTIO_BLK_REQ_MAX	SZ_1M
+
+/* A block transfer, split into requests which are on the ring together */
+struct virtio_blk_xfer {
+	u32 type;
+	u64 sector;
+	lbaint_t blkcnt;
+	void *buffer;
+	lbaint_t queued;	/* blocks added to the ring so far */
+	lbaint_t done;		/* blocks completed so far */
+	int status;
+};
+
+/*
+ * A request on the ring. Its header is the first buffer added, so the
+ * address which virtqueue_get_buf() returns leads back to the request.
+ */
+struct virtio_blk_req {
+	struct virtio_blk_outhdr out_hdr;
+	u8 status;
+	bool busy;
+	lbaint_t blkcnt;
+	struct virtio_blk_xfer *xfer;
+};
+
 struct virtio_blk_priv {
 	struct virtqueue *vq;
+	/* One request for each ring entry, and scatter lists to add them */
+	struct virtio_blk_req *reqs;
+	unsigned int nreqs;
+	struct virtio_sg *sg;
+	struct virtio_sg **sgs;
+	/* Data segments in a request, bytes in a segment, blocks in all */
+	u32 seg_max;
+	u32 size_max;
+	lbaint_t req_blks;
+	/* Asynchronous request in progress and its transfer */
+	struct blk_req *req;
+	struct virtio_blk_xfer async;
 };
 
-static ulong virtio_blk_do_req(struct udevice *dev, u64 sector,
-			       lbaint_t blkcnt, void *buffer, u32 type)
+static const u32 feature[] = {
+	VIRTIO_BLK_F_SIZE_MAX,
+	VIRTIO_BLK_F_SEG_MAX,
+};
+
+/* Check whether the device has any request, of any transfer, to complete */
+static bool virtio_blk_busy(struct virtio_blk_priv *priv)
+{
+	int i;
+
+	for (i = 0; i < priv->nreqs; i++) {
+		if (priv->reqs[i].busy)
+			return true;
+	}
+
+	return false;
+}
+
+/* Add a request to the ring, with its data split into segments */
+static int virtio_blk_add_req(struct udevice *dev, struct virtio_blk_req *req,
+			      u64 sector, lbaint_t blkcnt, void *buffer,
+			      u32 type)
 {
 	struct virtio_blk_priv *priv = dev_get_priv(dev);
-	unsigned int num_out = 0, num_in = 0;
-	struct virtio_sg *sgs[3];
-	u8 status;
-	int ret;
+	struct virtio_sg *sg = priv->sg;
+	struct virtio_sg **sgs = priv->sgs;
+	size_t len = blkcnt * 512;
+	unsigned int n = 0;
+
+	req->out_hdr.type = cpu_to_virtio32(dev, type);
+	req->out_hdr.ioprio = 0;
+	req->out_hdr.sector = cpu_to_virtio64(dev, sector);
+
+	sg[n].addr = &req->out_hdr;
+	sg[n].length = sizeof(req->out_hdr);
+	sgs[n] = &sg[n];
+	n++;
 
-	struct virtio_blk_outhdr out_hdr = {
-		.type = cpu_to_virtio32(dev, type),
-		.sector = cpu_to_virtio64(dev, sector),
-	};
-	struct virtio_sg hdr_sg = { &out_hdr, sizeof(out_hdr) };
-	struct virtio_sg data_sg = { buffer, blkcnt * 512 };
-	struct virtio_sg status_sg = { &status, sizeof(status) };
+	while (len) {
+		sg[n].addr = buffer;
+		sg[n].length = min_t(size_t, len, priv->size_max);
+		sgs[n] = &sg[n];
+		buffer += sg[n].length;
+		len -= sg[n].length;
+		n++;
+	}
 
-	sgs[num_out++] = &hdr_sg;
+	sg[n].addr = &req->status;
+	sg[n].length = sizeof(req->status);
+	sgs[n] = &sg[n];
+	n++;
 
 	if (type & VIRTIO_BLK_T_OUT)
-		sgs[num_out++] = &data_sg;
+		return virtqueue_add(priv->vq, sgs, n - 1, 1);
 	else
-		sgs[num_out + num_in++] = &data_sg;
+		return virtqueue_add(priv->vq, sgs, 1, n - 1);
+}
 
-	sgs[num_out + num_in++] = &status_sg;
+/**
+ * virtio_blk_fill() - add requests for a transfer while the ring has room
+ *
+ * The device is notified once for all of the requests.
+ *
+ * @dev:	virtio block device
+ * @xfer:	Transfer to continue
+ * @return number of requests added
+ */
+static int virtio_blk_fill(struct udevice *dev, struct virtio_blk_xfer *xfer)
+{
+	struct virtio_blk_priv *priv = dev_get_priv(dev);
+	struct virtio_blk_req *req;
+	lbaint_t blkcnt;
+	void *buffer;
+	int count = 0;
+	int i;
 
-	ret = virtqueue_add(priv->vq, sgs, num_out, num_in);
-	if (ret)
-		return ret;
+	for (i = 0; i < priv->nreqs; i++) {
+		if (xfer->status || xfer->queued == xfer->blkcnt)
+			break;
+		req = &priv->reqs[i];
+		if (req->busy)
+			continue;
+
+		blkcnt = min(xfer->blkcnt - xfer->queued, priv->req_blks);
+		buffer = xfer->buffer + xfer->queued * 512;
+		if (virtio_blk_add_req(dev, req, xfer->sector + xfer->queued,
+				       blkcnt, buffer, xfer->type)) {
+			/* Nothing is going to make room on the ring */
+			if (!virtio_blk_busy(priv))
+				xfer->status = -EIO;
+			break;
+		}
+
+		req->busy = true;
+		req->blkcnt = blkcnt;
+		req->xfer = xfer;
+		xfer->queued += blkcnt;
+		count++;
+	}
+	if (count)
+		virtqueue_kick(priv->vq);
+
+	return count;
+}
+
+/* Collect all requests which the device has completed */
+static void virtio_blk_reap(struct udevice *dev)
+{
+	struct virtio_blk_priv *priv = dev_get_priv(dev);
+	struct virtio_blk_outhdr *out_hdr;
+	struct virtio_blk_req *req;
+
+	while ((out_hdr = virtqueue_get_buf(priv->vq, NULL))) {
+		req = container_of(out_hdr, struct virtio_blk_req, out_hdr);
+		if (req->status != VIRTIO_BLK_S_OK)
+			req->xfer->status = -EIO;
+		req->xfer->done += req->blkcnt;
+		req->busy = false;
+	}
+}
+
+static void virtio_blk_xfer_start(struct virtio_blk_xfer *xfer, u64 sector,
+				  lbaint_t blkcnt, void *buffer, u32 type)
+{
+	xfer->type = type;
+	xfer->sector = sector;
+	xfer->blkcnt = blkcnt;
+	xfer->buffer = buffer;
+	xfer->queued = 0;
+	xfer->done = 0;
+	xfer->status = 0;
+}
+
+/**
+ * virtio_blk_xfer_step() - make progress on a transfer without waiting
+ *
+ * @dev:	virtio block device
+ * @xfer:	Transfer to continue
+ * @return -EINPROGRESS if the transfer is not finished yet, 0 if it finished
+ * successfully, other -ve on error
+ */
+static int virtio_blk_xfer_step(struct udevice *dev,
+				struct virtio_blk_xfer *xfer)
+{
+	virtio_blk_reap(dev);
+	virtio_blk_fill(dev, xfer);
 
-	virtqueue_kick(priv->vq);
+	if (xfer->done != xfer->queued ||
+	    (!xfer->status && xfer->queued != xfer->blkcnt))
+		return -EINPROGRESS;
 
-	while (!virtqueue_get_buf(priv->vq, NULL))
-		;
+	return xfer->status;
+}
+
+static int virtio_blk_submit(struct udevice *dev, struct blk_req *req)
+{
+	struct virtio_blk_priv *priv = dev_get_priv(dev);
+
+	if (priv->req)
+		return -EBUSY;
+
+	virtio_blk_xfer_start(&priv->async, req->start, req->blkcnt,
+			      req->buffer, req->op == BLK_REQ_READ ?
+			      VIRTIO_BLK_T_IN : VIRTIO_BLK_T_OUT);
+	priv->req = req;
+	virtio_blk_fill(dev, &priv->async);
+
+	return 0;
+}
+
+static int virtio_blk_poll(struct udevice *dev)
+{
+	struct virtio_blk_priv *priv = dev_get_priv(dev);
+	struct blk_req *req = priv->req;
+	int ret;
+
+	if (!req)
+		return 0;
+
+	ret = virtio_blk_xfer_step(dev, &priv->async);
+	if (ret == -EINPROGRESS)
+		return 0;
+
+	priv->req = NULL;
+	blk_req_done(req, ret);
+
+	return 0;
+}
+
+/*
+ * Requests are tied to their own transfer, so this may run while an
+ * asynchronous request is still in progress
+ */
+static ulong virtio_blk_do_req(struct udevice *dev, u64 sector,
+			       lbaint_t blkcnt, void *buffer, u32 type)
+{
+	struct virtio_blk_xfer xfer;
+	int ret;
+
+	virtio_blk_xfer_start(&xfer, sector, blkcnt, buffer, type);
+	do {
+		ret = virtio_blk_xfer_step(dev, &xfer);
+	} while (ret == -EINPROGRESS);
 
-	return status == VIRTIO_BLK_S_OK ? blkcnt : -EIO;
+	return ret ? ret : blkcnt;
 }
 
 static ulong virtio_blk_read(struct udevice *dev, lbaint_t start,
@@ -97,15 +305,27 @@ static int virtio_blk_bind(struct udevice *dev)
 	desc->bdev = dev;
 
 	/* Indicate what driver features we support */
-	virtio_driver_features_init(uc_priv, NULL, 0, NULL, 0);
+	virtio_driver_features_init(uc_priv, feature, ARRAY_SIZE(feature),
+				    NULL, 0);
 
 	return 0;
 }
 
+static void virtio_blk_free(struct virtio_blk_priv *priv)
+{
+	free(priv->reqs);
+	free(priv->sg);
+	free(priv->sgs);
+	priv->reqs = NULL;
+	priv->sg = NULL;
+	priv->sgs = NULL;
+}
+
 static int virtio_blk_probe(struct udevice *dev)
 {
 	struct virtio_blk_priv *priv = dev_get_priv(dev);
 	struct blk_desc *desc = dev_get_uclass_platdata(dev);
+	unsigned int ring_size;
 	u64 cap;
 	int ret;
 
@@ -117,12 +337,60 @@ static int virtio_blk_probe(struct udevice *dev)
 	virtio_cread(dev, struct virtio_blk_config, capacity, &cap);
 	desc->lba = cap;
 
+	/* Without limits from the device, send each request in one segment */
+	if (virtio_cread_feature(dev, VIRTIO_BLK_F_SEG_MAX,
+				 struct virtio_blk_config, seg_max,
+				 &priv->seg_max) || !priv->seg_max)
+		priv->seg_max = 1;
+	if (virtio_cread_feature(dev, VIRTIO_BLK_F_SIZE_MAX,
+				 struct virtio_blk_config, size_max,
+				 &priv->size_max) || !priv->size_max)
+		priv->size_max = VIRTIO_BLK_REQ_MAX;
+
+	/*
+	 * The header and status need descriptors too. An indirect table is
+	 * allocated for each request and the request goes straight into the
+	 * ring when that fails, so it must always fit there.
+	 */
+	ring_size = virtqueue_get_vring_size(priv->vq);
+	priv->seg_max = min(priv->seg_max, ring_size - 2);
+	priv->req_blks = min_t(u64, (u64)priv->seg_max * priv->size_max,
+			       VIRTIO_BLK_REQ_MAX) / 512;
+	if (!priv->req_blks)
+		priv->req_blks = 1;
+	debug("%s: %u segments of %u bytes, %lu blocks per request\n",
+	      dev->name, priv->seg_max, priv->size_max,
+	      (ulong)priv->req_blks);
+
+	priv->nreqs = ring_size;
+	priv->reqs = calloc(priv->nreqs, sizeof(*priv->reqs));
+	priv->sg = calloc(priv->seg_max + 2, sizeof(*priv->sg));
+	priv->sgs = calloc(priv->seg_max + 2, sizeof(*priv->sgs));
+	if (!priv->reqs || !priv->sg || !priv->sgs) {
+		virtio_blk_free(priv);
+		virtio_del_vqs(dev);
+		return -ENOMEM;
+	}
+
 	return 0;
 }
 
+static int virtio_blk_remove(struct udevice *dev)
+{
+	struct virtio_blk_priv *priv = dev_get_priv(dev);
+	int ret;
+
+	ret = virtio_reset(dev);
+	virtio_blk_free(priv);
+
+	return ret;
+}
+
 static const struct blk_ops virtio_blk_ops = {
 	.read	= virtio_blk_read,
 	.write	= virtio_blk_write,
+	.submit	= virtio_blk_submit,
+	.poll	= virtio_blk_poll,
 };
 
 U_BOOT_DRIVER(virtio_blk) = {
@@ -131,7 +399,7 @@ U_BOOT_DRIVER(virtio_blk) = {
 	.ops	= &virtio_blk_ops,
 	.bind	= virtio_blk_bind,
 	.probe	= virtio_blk_probe,
-	.remove	= virtio_reset,
+	.remove	= virtio_blk_remove,
 	.priv_auto_alloc_size = sizeof(struct virtio_blk_priv),
 	.flags	= DM_FLAG_ACTIVE_DMA,
 };
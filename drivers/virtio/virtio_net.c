@@ -12,8 +12,8 @@
 #include <virtio_ring.h>
 #include "virtio_net.h"
 
-/* Amount of buffers to keep in the RX virtqueue */
-#define VIRTIO_NET_NUM_RX_BUFS	32
+/* Most buffers to keep in the RX virtqueue, if it has room for them */
+#define VIRTIO_NET_MAX_RX_BUFS	128
 
 /*
  * This value comes from the VirtIO spec: 1500 for maximum packet size,
@@ -30,7 +30,10 @@ struct virtio_net_priv {
 		};
 	};
 
-	char rx_buff[VIRTIO_NET_NUM_RX_BUFS][VIRTIO_NET_RX_BUF_SIZE];
+	char (*rx_buff)[VIRTIO_NET_RX_BUF_SIZE];
+	unsigned int rx_num_bufs;
+	/* Buffers given back since the device was last notified */
+	unsigned int rx_recycled;
 	bool rx_running;
 	int net_hdr_len;
 };
@@ -60,7 +63,7 @@ static int virtio_net_start(struct udevice *dev)
 		sg.length = VIRTIO_NET_RX_BUF_SIZE;
 
 		/* setup the receive buffer address */
-		for (i = 0; i < VIRTIO_NET_NUM_RX_BUFS; i++) {
+		for (i = 0; i < priv->rx_num_bufs; i++) {
 			sg.addr = priv->rx_buff[i];
 			virtqueue_add(priv->rx_vq, sgs, 0, 1);
 		}
@@ -112,6 +115,15 @@ static int virtio_net_recv(struct udevice *dev, int flags, uchar **packetp)
 	unsigned int len;
 	void *buf;
 
+	/*
+	 * Buffers are put back one at a time as packets are freed, but the
+	 * device is only told about them once per batch of packets
+	 */
+	if ((flags & ETH_RECV_CHECK_DEVICE) && priv->rx_recycled) {
+		virtqueue_kick(priv->rx_vq);
+		priv->rx_recycled = 0;
+	}
+
 	buf = virtqueue_get_buf(priv->rx_vq, &len);
 	if (!buf)
 		return -EAGAIN;
@@ -129,6 +141,13 @@ static int virtio_net_free_pkt(struct udevice *dev, uchar *packet, int length)
 
 	/* Put the buffer back to the rx ring */
 	virtqueue_add(priv->rx_vq, sgs, 0, 1);
+	priv->rx_recycled++;
+
+	/* Do not let the device run out of buffers during a long batch */
+	if (priv->rx_recycled >= priv->rx_num_bufs / 2) {
+		virtqueue_kick(priv->rx_vq);
+		priv->rx_recycled = 0;
+	}
 
 	return 0;
 }
@@ -201,6 +220,15 @@ static int virtio_net_probe(struct udevice *dev)
 	if (ret < 0)
 		return ret;
 
+	/* Keep the whole receive ring populated */
+	priv->rx_num_bufs = min_t(unsigned int, VIRTIO_NET_MAX_RX_BUFS,
+				  virtqueue_get_vring_size(priv->rx_vq));
+	priv->rx_buff = malloc(priv->rx_num_bufs * VIRTIO_NET_RX_BUF_SIZE);
+	if (!priv->rx_buff) {
+		virtio_del_vqs(dev);
+		return -ENOMEM;
+	}
+
 	/*
 	 * For v1.0 compliant device, it always assumes the member
 	 * 'num_buffers' exists in the struct virtio_net_hdr while
@@ -216,6 +244,17 @@ static int virtio_net_probe(struct udevice *dev)
 	return 0;
 }
 
+static int virtio_net_remove(struct udevice *dev)
+{
+	struct virtio_net_priv *priv = dev_get_priv(dev);
+	int ret;
+
+	ret = virtio_reset(dev);
+	free(priv->rx_buff);
+
+	return ret;
+}
+
 static const struct eth_ops virtio_net_ops = {
 	.start = virtio_net_start,
 	.send = virtio_net_send,
@@ -231,7 +270,7 @@ U_BOOT_DRIVER(virtio_net) = {
 	.id	= UCLASS_ETH,
 	.bind	= virtio_net_bind,
 	.probe	= virtio_net_probe,
-	.remove = virtio_reset,
+	.remove = virtio_net_remove,
 	.ops	= &virtio_net_ops,
 	.priv_auto_alloc_size = sizeof(struct virtio_net_priv),
 	.platdata_auto_alloc_size = sizeof(struct eth_pdata),
@@ -13,21 +13,54 @@
 #include <virtio.h>
 #include <virtio_ring.h>
 
+static struct vring_desc *alloc_indirect(struct virtqueue *vq,
+					 unsigned int total_sg)
+{
+	struct vring_desc *desc;
+	unsigned int i;
+
+	desc = memalign(VRING_DESC_ALIGN_SIZE, total_sg * sizeof(*desc));
+	if (!desc)
+		return NULL;
+
+	for (i = 0; i < total_sg; i++)
+		desc[i].next = cpu_to_virtio16(vq->vdev, i + 1);
+
+	return desc;
+}
+
 int virtqueue_add(struct virtqueue *vq, struct virtio_sg *sgs[],
 		  unsigned int out_sgs, unsigned int in_sgs)
 {
 	struct vring_desc *desc;
 	unsigned int total_sg = out_sgs + in_sgs;
 	unsigned int i, n, avail, descs_used, uninitialized_var(prev);
+	bool indirect;
 	int head;
 
 	WARN_ON(total_sg == 0);
 
 	head = vq->free_head;
 
-	desc = vq->vring.desc;
-	i = head;
-	descs_used = total_sg;
+	/*
+	 * A chain of several buffers takes a single ring entry when it is
+	 * described by an indirect table, so more of them fit into the ring
+	 */
+	if (vq->indirect && total_sg > 1 && vq->num_free)
+		desc = alloc_indirect(vq, total_sg);
+	else
+		desc = NULL;
+
+	if (desc) {
+		indirect = true;
+		i = 0;
+		descs_used = 1;
+	} else {
+		indirect = false;
+		desc = vq->vring.desc;
+		i = head;
+		descs_used = total_sg;
+	}
 
 	if (vq->num_free < descs_used) {
 		debug("Can't add buf len %i - avail = %i\n",
@@ -39,6 +72,8 @@ int virtqueue_add(struct virtqueue *vq, struct virtio_sg *sgs[],
 		 */
 		if (out_sgs)
 			virtio_notify(vq->vdev, vq);
+		if (indirect)
+			free(desc);
 		return -ENOSPC;
 	}
 
@@ -67,11 +102,26 @@ int virtqueue_add(struct virtqueue *vq, struct virtio_sg *sgs[],
 	/* Last one doesn't continue */
 	desc[prev].flags &= cpu_to_virtio16(vq->vdev, ~VRING_DESC_F_NEXT);
 
+	if (indirect) {
+		/* Now that the indirect table is filled in, point to it */
+		struct vring_desc *entry = &vq->vring.desc[head];
+
+		entry->flags = cpu_to_virtio16(vq->vdev, VRING_DESC_F_INDIRECT);
+		entry->addr = cpu_to_virtio64(vq->vdev, (u64)(uintptr_t)desc);
+		entry->len = cpu_to_virtio32(vq->vdev,
+					     total_sg * sizeof(*desc));
+		vq->indir_desc[head] = desc;
+	}
+
 	/* We're using some buffers from the free list. */
 	vq->num_free -= descs_used;
 
 	/* Update free pointer */
-	vq->free_head = i;
+	if (indirect)
+		vq->free_head = virtio16_to_cpu(vq->vdev,
+						vq->vring.desc[head].next);
+	else
+		vq->free_head = i;
 
 	/*
 	 * Put entry in available array (but don't update avail->idx
@@ -149,6 +199,9 @@ static void detach_buf(struct virtqueue *vq, unsigned int head)
 
 	/* Plus final descriptor */
 	vq->num_free++;
+
+	free(vq->indir_desc[head]);
+	vq->indir_desc[head] = NULL;
 }
 
 static inline bool more_used(const struct virtqueue *vq)
@@ -161,6 +214,7 @@ void *virtqueue_get_buf(struct virtqueue *vq, unsigned int *len)
 {
 	unsigned int i;
 	u16 last_used;
+	__virtio64 addr;
 
 	if (!more_used(vq)) {
 		debug("(%s.%d): No more buffers in queue\n",
@@ -186,6 +240,12 @@ void *virtqueue_get_buf(struct virtqueue *vq, unsigned int *len)
 		return NULL;
 	}
 
+	/* Return the first buffer which was added, not the indirect table */
+	if (vq->indir_desc[i])
+		addr = vq->indir_desc[i][0].addr;
+	else
+		addr = vq->vring.desc[i].addr;
+
 	detach_buf(vq, i);
 	vq->last_used_idx++;
 	/*
@@ -197,8 +257,7 @@ void *virtqueue_get_buf(struct virtqueue *vq, unsigned int *len)
 		virtio_store_mb(&vring_used_event(&vq->vring),
 				cpu_to_virtio16(vq->vdev, vq->last_used_idx));
 
-	return (void *)(uintptr_t)virtio64_to_cpu(vq->vdev,
-						  vq->vring.desc[i].addr);
+	return (void *)(uintptr_t)virtio64_to_cpu(vq->vdev, addr);
 }
 
 static struct virtqueue *__vring_new_virtqueue(unsigned int index,
@@ -214,6 +273,12 @@ static struct virtqueue *__vring_new_virtqueue(unsigned int index,
 	if (!vq)
 		return NULL;
 
+	vq->indir_desc = calloc(vring.num, sizeof(*vq->indir_desc));
+	if (!vq->indir_desc) {
+		free(vq);
+		return NULL;
+	}
+
 	vq->vdev = vdev;
 	vq->index = index;
 	vq->num_free = vring.num;
@@ -225,6 +290,7 @@ static struct virtqueue *__vring_new_virtqueue(unsigned int index,
 	list_add_tail(&vq->list, &uc_priv->vqs);
 
 	vq->event = virtio_has_feature(vdev, VIRTIO_RING_F_EVENT_IDX);
+	vq->indirect = virtio_has_feature(vdev, VIRTIO_RING_F_INDIRECT_DESC);
 
 	/* Tell other side not to bother us */
 	vq->avail_flags_shadow |= VRING_AVAIL_F_NO_INTERRUPT;
@@ -287,6 +353,11 @@ struct virtqueue *vring_create_virtqueue(unsigned int index, unsigned int num,
 
 void vring_del_virtqueue(struct virtqueue *vq)
 {
+	unsigned int i;
+
+	for (i = 0; i < vq->vring.num; i++)
+		free(vq->indir_desc[i]);
+	free(vq->indir_desc);
 	free(vq->vring.desc);
 	list_del(&vq->list);
 	free(vq);
@@ -12,6 +12,15 @@
 #include <virtio_ring.h>
 #include <linux/compat.h>
 #include <linux/io.h>
+#include "virtio_blk.h"
+
+/*
+ * The block device has a small disk in memory. Its limits on requests are
+ * low, so that drivers have to split transfers over several of them.
+ */
+#define SANDBOX_VIRTIO_BLK_SECTORS	2048
+#define SANDBOX_VIRTIO_BLK_SEG_MAX	4
+#define SANDBOX_VIRTIO_BLK_SIZE_MAX	4096
 
 struct virtio_sandbox_priv {
 	u8 id;
@@ -21,11 +30,20 @@ struct virtio_sandbox_priv {
 	ulong queue_desc;
 	ulong queue_available;
 	ulong queue_used;
+	u16 last_avail_idx;
+	struct virtio_blk_config config;
+	u8 *disk;
 };
 
 static int virtio_sandbox_get_config(struct udevice *udev, unsigned int offset,
 				     void *buf, unsigned int len)
 {
+	struct virtio_sandbox_priv *priv = dev_get_priv(udev);
+
+	if (offset + len > sizeof(priv->config))
+		return -EINVAL;
+	memcpy(buf, (u8 *)&priv->config + offset, len);
+
 	return 0;
 }
 
@@ -108,6 +126,7 @@ static struct virtqueue *virtio_sandbox_setup_vq(struct udevice *udev,
 
 	addr = virtqueue_get_used_addr(vq);
 	priv->queue_used = addr;
+	priv->last_avail_idx = 0;
 
 	return vq;
 
@@ -147,8 +166,92 @@ static int virtio_sandbox_find_vqs(struct udevice *udev, unsigned int nvqs,
 	return 0;
 }
 
+/**
+ * virtio_sandbox_blk_req() - carry out a block request from the ring
+ *
+ * @priv:	Device private data
+ * @vq:		Queue holding the request
+ * @head:	Descriptor the request starts at
+ * @return number of bytes written to the request's buffers
+ */
+static uint virtio_sandbox_blk_req(struct virtio_sandbox_priv *priv,
+				   struct virtqueue *vq, unsigned int head)
+{
+	struct udevice *vdev = vq->vdev;
+	struct vring_desc *desc = vq->vring.desc;
+	struct virtio_blk_outhdr *out_hdr;
+	u64 pos, size = SANDBOX_VIRTIO_BLK_SECTORS * 512;
+	u8 status = VIRTIO_BLK_S_OK;
+	unsigned int i = head;
+	uint written = 0;
+	void *buf = NULL;
+	u32 type;
+	u32 len;
+
+	if (desc[i].flags & cpu_to_virtio16(vdev, VRING_DESC_F_INDIRECT)) {
+		desc = (void *)(uintptr_t)virtio64_to_cpu(vdev, desc[i].addr);
+		i = 0;
+	}
+
+	out_hdr = (void *)(uintptr_t)virtio64_to_cpu(vdev, desc[i].addr);
+	type = virtio32_to_cpu(vdev, out_hdr->type);
+	pos = virtio64_to_cpu(vdev, out_hdr->sector) * 512;
+
+	/* Everything between the header and the status byte is data */
+	while (desc[i].flags & cpu_to_virtio16(vdev, VRING_DESC_F_NEXT)) {
+		i = virtio16_to_cpu(vdev, desc[i].next);
+		buf = (void *)(uintptr_t)virtio64_to_cpu(vdev, desc[i].addr);
+		len = virtio32_to_cpu(vdev, desc[i].len);
+		if (!(desc[i].flags & cpu_to_virtio16(vdev, VRING_DESC_F_NEXT)))
+			break;
+
+		if (pos + len > size) {
+			status = VIRTIO_BLK_S_IOERR;
+		} else if (type == VIRTIO_BLK_T_IN) {
+			memcpy(buf, priv->disk + pos, len);
+			written += len;
+		} else if (type == VIRTIO_BLK_T_OUT) {
+			memcpy(priv->disk + pos, buf, len);
+		} else {
+			status = VIRTIO_BLK_S_UNSUPP;
+		}
+		pos += len;
+	}
+	if (!buf)
+		return 0;
+	*(u8 *)buf = status;
+
+	return written + 1;
+}
+
 static int virtio_sandbox_notify(struct udevice *udev, struct virtqueue *vq)
 {
+	struct virtio_sandbox_priv *priv = dev_get_priv(udev);
+	struct udevice *vdev = vq->vdev;
+	struct vring *vring = &vq->vring;
+	struct vring_used_elem *elem;
+	unsigned int head;
+	u16 used_idx, slot;
+	uint len;
+
+	/* A device only looks at its queues once the driver is ready */
+	if (!(priv->status & VIRTIO_CONFIG_S_DRIVER_OK))
+		return 0;
+
+	while (priv->last_avail_idx !=
+	       virtio16_to_cpu(vdev, vring->avail->idx)) {
+		slot = priv->last_avail_idx & (vring->num - 1);
+		head = virtio16_to_cpu(vdev, vring->avail->ring[slot]);
+		len = virtio_sandbox_blk_req(priv, vq, head);
+
+		used_idx = virtio16_to_cpu(vdev, vring->used->idx);
+		elem = &vring->used->ring[used_idx & (vring->num - 1)];
+		elem->id = cpu_to_virtio32(vdev, head);
+		elem->len = cpu_to_virtio32(vdev, len);
+		vring->used->idx = cpu_to_virtio16(vdev, used_idx + 1);
+		priv->last_avail_idx++;
+	}
+
 	return 0;
 }
 
@@ -158,10 +261,29 @@ static int virtio_sandbox_probe(struct udevice *udev)
 	struct virtio_dev_priv *uc_priv = dev_get_uclass_priv(udev);
 
 	/* fake some information for testing */
-	priv->device_features = VIRTIO_F_VERSION_1;
+	priv->device_features = (1ULL << VIRTIO_F_VERSION_1) |
+				(1ULL << VIRTIO_RING_F_INDIRECT_DESC) |
+				(1ULL << VIRTIO_BLK_F_SIZE_MAX) |
+				(1ULL << VIRTIO_BLK_F_SEG_MAX);
 	uc_priv->device = VIRTIO_ID_BLOCK;
 	uc_priv->vendor = ('u' << 24) | ('b' << 16) | ('o' << 8) | 't';
 
+	priv->config.capacity = cpu_to_le64(SANDBOX_VIRTIO_BLK_SECTORS);
+	priv->config.size_max = cpu_to_le32(SANDBOX_VIRTIO_BLK_SIZE_MAX);
+	priv->config.seg_max = cpu_to_le32(SANDBOX_VIRTIO_BLK_SEG_MAX);
+	priv->disk = calloc(SANDBOX_VIRTIO_BLK_SECTORS, 512);
+	if (!priv->disk)
+		return -ENOMEM;
+
+	return 0;
+}
+
+static int virtio_sandbox_remove(struct udevice *udev)
+{
+	struct virtio_sandbox_priv *priv = dev_get_priv(udev);
+
+	free(priv->disk);
+
 	return 0;
 }
 
@@ -201,6 +323,7 @@ U_BOOT_DRIVER(virtio_sandbox1) = {
 	.of_match = virtio_sandbox1_ids,
 	.ops	= &virtio_sandbox1_ops,
 	.probe	= virtio_sandbox_probe,
+	.remove	= virtio_sandbox_remove,
 	.child_post_remove = virtio_sandbox_child_post_remove,
 	.priv_auto_alloc_size = sizeof(struct virtio_sandbox_priv),
 };
@@ -229,5 +352,6 @@ U_BOOT_DRIVER(virtio_sandbox2) = {
 	.of_match = virtio_sandbox2_ids,
 	.ops	= &virtio_sandbox2_ops,
 	.probe	= virtio_sandbox_probe,
+	.remove	= virtio_sandbox_remove,
 	.priv_auto_alloc_size = sizeof(struct virtio_sandbox_priv),
 };
@@ -155,6 +155,55 @@ int flush_dirty_fat_buffer(fsdata *mydata)
 }
 #endif
 
+/*
+ * Return a pointer to window 'bufnum' (FATBUFBLOCKS sectors) of the FAT,
+ * reading it from disk unless it is already cached.
+ * On failure NULL is returned.
+ */
+static __u8 *get_fatbuf(fsdata *mydata, __u32 bufnum)
+{
+	__u32 getsize = FATBUFBLOCKS;
+	__u32 fatlength = mydata->fatlength;
+	__u32 startblock = bufnum * FATBUFBLOCKS;
+	__u8 *bufptr = mydata->fatbuf;
+
+	if (startblock >= fatlength) {
+		debug("Error: FAT window %u out of range\n", bufnum);
+		return NULL;
+	}
+
+	if (mydata->fatbufstate) {
+		bufptr += bufnum * FATBUFSIZE;
+		if (mydata->fatbufstate[bufnum] & FATBUF_VALID)
+			return bufptr;
+	} else {
+		if (bufnum == mydata->fatbufnum)
+			return bufptr;
+
+		/* Write back the fatbuf to the disk */
+		if (flush_dirty_fat_buffer(mydata) < 0)
+			return NULL;
+	}
+
+	/* Cap length if fatlength is not a multiple of FATBUFBLOCKS */
+	if (startblock + getsize > fatlength)
+		getsize = fatlength - startblock;
+
+	startblock += mydata->fat_sect;	/* Offset from start of disk */
+
+	if (disk_read(startblock, getsize, bufptr) < 0) {
+		debug("Error reading FAT blocks\n");
+		return NULL;
+	}
+
+	if (mydata->fatbufstate)
+		mydata->fatbufstate[bufnum] |= FATBUF_VALID;
+	else
+		mydata->fatbufnum = bufnum;
+
+	return bufptr;
+}
+
 /*
  * Get the entry at index 'entry' in a FAT (12/16/32) table.
  * On failure 0x00 is returned.
@@ -164,6 +213,7 @@ static __u32 get_fatent(fsdata *mydata, __u32 entry)
 	__u32 bufnum;
 	__u32 offset, off8;
 	__u32 ret = 0x00;
+	__u8 *fatbuf;
 
 	if (CHECK_CLUST(entry, mydata->fatsize)) {
 		printf("Error: Invalid FAT entry: 0x%08x\n", entry);
@@ -192,42 +242,22 @@ static __u32 get_fatent(fsdata *mydata, __u32 entry)
 	debug("FAT%d: entry: 0x%08x = %d, offset: 0x%04x = %d\n",
 	       mydata->fatsize, entry, entry, offset, offset);
 
-	/* Read a new block of FAT entries into the cache. */
-	if (bufnum != mydata->fatbufnum) {
-		__u32 getsize = FATBUFBLOCKS;
-		__u8 *bufptr = mydata->fatbuf;
-		__u32 fatlength = mydata->fatlength;
-		__u32 startblock = bufnum * FATBUFBLOCKS;
-
-		/* Cap length if fatlength is not a multiple of FATBUFBLOCKS */
-		if (startblock + getsize > fatlength)
-			getsize = fatlength - startblock;
-
-		startblock += mydata->fat_sect;	/* Offset from start of disk */
-
-		/* Write back the fatbuf to the disk */
-		if (flush_dirty_fat_buffer(mydata) < 0)
-			return -1;
-
-		if (disk_read(startblock, getsize, bufptr) < 0) {
-			debug("Error reading FAT blocks\n");
-			return ret;
-		}
-		mydata->fatbufnum = bufnum;
-	}
+	fatbuf = get_fatbuf(mydata, bufnum);
+	if (!fatbuf)
+		return ret;
 
 	/* Get the actual entry from the table */
 	switch (mydata->fatsize) {
 	case 32:
-		ret = FAT2CPU32(((__u32 *) mydata->fatbuf)[offset]);
+		ret = FAT2CPU32(((__u32 *)fatbuf)[offset]);
 		break;
 	case 16:
-		ret = FAT2CPU16(((__u16 *) mydata->fatbuf)[offset]);
+		ret = FAT2CPU16(((__u16 *)fatbuf)[offset]);
 		break;
 	case 12:
 		off8 = (offset * 3) / 2;
 		/* fatbut + off8 may be unaligned, read in byte granularity */
-		ret = mydata->fatbuf[off8] + (mydata->fatbuf[off8 + 1] << 8);
+		ret = fatbuf[off8] + (fatbuf[off8 + 1] << 8);
 
 		if (offset & 0x1)
 			ret >>= 4;
@@ -259,21 +289,39 @@ get_cluster(fsdata *mydata, __u32 clustnum, __u8 *buffer, unsigned long size)
 	debug("gc - clustnum: %d, startsect: %d\n", clustnum, startsect);
 
 	if ((unsigned long)buffer & (ARCH_DMA_MINALIGN - 1)) {
-		ALLOC_CACHE_ALIGN_BUFFER(__u8, tmpbuf, mydata->sect_size);
+		__u32 nsects = min_t(unsigned long, size, MAX_CLUSTSIZE) /
+			       mydata->sect_size;
+		__u8 *tmpbuf = NULL;
 
 		debug("FAT: Misaligned buffer address (%p)\n", buffer);
 
+		/* Bounce whole runs of sectors rather than one at a time */
+		if (nsects) {
+			idx = nsects * mydata->sect_size;
+			tmpbuf = malloc_cache_aligned(idx);
+			if (!tmpbuf) {
+				debug("Error: allocating buffer\n");
+				return -1;
+			}
+		}
+
 		while (size >= mydata->sect_size) {
-			ret = disk_read(startsect++, 1, tmpbuf);
-			if (ret != 1) {
+			idx = min_t(unsigned long, size / mydata->sect_size,
+				    nsects);
+			ret = disk_read(startsect, idx, tmpbuf);
+			if (ret != idx) {
 				debug("Error reading data (got %d)\n", ret);
+				free(tmpbuf);
 				return -1;
 			}
 
-			memcpy(buffer, tmpbuf, mydata->sect_size);
-			buffer += mydata->sect_size;
-			size -= mydata->sect_size;
+			startsect += idx;
+			idx *= mydata->sect_size;
+			memcpy(buffer, tmpbuf, idx);
+			buffer += idx;
+			size -= idx;
 		}
+		free(tmpbuf);
 	} else {
 		idx = size / mydata->sect_size;
 		ret = disk_read(startsect, idx, buffer);
@@ -399,18 +447,18 @@ static int get_contents(fsdata *mydata, dir_entry *dentptr, loff_t pos,
 
 		/* get remaining bytes */
 		actsize = filesize;
-		if (get_cluster(mydata, curclust, buffer, (int)actsize) != 0) {
+		if (get_cluster(mydata, curclust, buffer, actsize) != 0) {
 			printf("Error reading cluster\n");
 			return -1;
 		}
 		*gotsize += actsize;
 		return 0;
 getit:
-		if (get_cluster(mydata, curclust, buffer, (int)actsize) != 0) {
+		if (get_cluster(mydata, curclust, buffer, actsize) != 0) {
 			printf("Error reading cluster\n");
 			return -1;
 		}
-		*gotsize += (int)actsize;
+		*gotsize += actsize;
 		filesize -= actsize;
 		buffer += actsize;
 
@@ -542,6 +590,30 @@ exit:
 	return ret;
 }
 
+/*
+ * Allocate a buffer for the whole FAT, followed by the state of each of its
+ * windows, so that every FAT sector is read at most once per operation.
+ * Returns NULL if the FAT is larger than FAT_CACHE_SIZE or on allocation
+ * failure, in which case a single window is used instead.
+ */
+static __u8 *fat_cache_alloc(fsdata *mydata)
+{
+	__u32 nbufs = DIV_ROUND_UP(mydata->fatlength, FATBUFBLOCKS);
+	__u8 *buf;
+
+	if (!nbufs || (u64)nbufs * FATBUFSIZE > FAT_CACHE_SIZE)
+		return NULL;
+
+	buf = malloc_cache_aligned(nbufs * (FATBUFSIZE + 1));
+	if (!buf)
+		return NULL;
+
+	mydata->fatbufstate = buf + nbufs * FATBUFSIZE;
+	memset(mydata->fatbufstate, 0, nbufs);
+
+	return buf;
+}
+
 static int get_fs_info(fsdata *mydata)
 {
 	boot_sector bs;
@@ -613,7 +685,10 @@ static int get_fs_info(fsdata *mydata)
 
 	mydata->fatbufnum = -1;
 	mydata->fat_dirty = 0;
-	mydata->fatbuf = malloc_cache_aligned(FATBUFSIZE);
+	mydata->fatbufstate = NULL;
+	mydata->fatbuf = fat_cache_alloc(mydata);
+	if (!mydata->fatbuf)
+		mydata->fatbuf = malloc_cache_aligned(FATBUFSIZE);
 	if (mydata->fatbuf == NULL) {
 		debug("Error: allocating memory\n");
 		return -1;
@@ -100,20 +100,13 @@ static void set_name(dir_entry *dirent, const char *filename)
 }
 
 /*
- * Write fat buffer into block device
+ * Write 'getsize' sectors of FAT buffer, starting at FAT sector 'startblock',
+ * into all copies of the FAT
  */
-static int flush_dirty_fat_buffer(fsdata *mydata)
+static int write_fat_blocks(fsdata *mydata, __u32 startblock, __u32 getsize,
+			    __u8 *bufptr)
 {
-	int getsize = FATBUFBLOCKS;
 	__u32 fatlength = mydata->fatlength;
-	__u8 *bufptr = mydata->fatbuf;
-	__u32 startblock = mydata->fatbufnum * FATBUFBLOCKS;
-
-	debug("debug: evicting %d, dirty: %d\n", mydata->fatbufnum,
-	      (int)mydata->fat_dirty);
-
-	if ((!mydata->fat_dirty) || (mydata->fatbufnum == -1))
-		return 0;
 
 	/* Cap length if fatlength is not a multiple of FATBUFBLOCKS */
 	if (startblock + getsize > fatlength)
@@ -135,6 +128,50 @@ static int flush_dirty_fat_buffer(fsdata *mydata)
 			return -1;
 		}
 	}
+
+	return 0;
+}
+
+/*
+ * Write fat buffer into block device
+ */
+static int flush_dirty_fat_buffer(fsdata *mydata)
+{
+	__u8 *state = mydata->fatbufstate;
+	__u32 nbufs, i, end;
+
+	debug("debug: evicting %d, dirty: %d\n", mydata->fatbufnum,
+	      (int)mydata->fat_dirty);
+
+	if (!mydata->fat_dirty)
+		return 0;
+
+	if (!state) {
+		if (mydata->fatbufnum == -1)
+			return 0;
+		if (write_fat_blocks(mydata, mydata->fatbufnum * FATBUFBLOCKS,
+				     FATBUFBLOCKS, mydata->fatbuf) < 0)
+			return -1;
+		mydata->fat_dirty = 0;
+		return 0;
+	}
+
+	/* Write back each run of dirty windows with a single request */
+	nbufs = DIV_ROUND_UP(mydata->fatlength, FATBUFBLOCKS);
+	for (i = 0; i < nbufs; i = end) {
+		end = i + 1;
+		if (!(state[i] & FATBUF_DIRTY))
+			continue;
+		while (end < nbufs && (state[end] & FATBUF_DIRTY))
+			end++;
+
+		if (write_fat_blocks(mydata, i * FATBUFBLOCKS,
+				     (end - i) * FATBUFBLOCKS,
+				     mydata->fatbuf + i * FATBUFSIZE) < 0)
+			return -1;
+		while (i < end)
+			state[i++] &= ~FATBUF_DIRTY;
+	}
 	mydata->fat_dirty = 0;
 
 	return 0;
@@ -265,6 +302,7 @@ static int set_fatent_value(fsdata *mydata, __u32 entry, __u32 entry_value)
 {
 	__u32 bufnum, offset, off16;
 	__u16 val1, val2;
+	__u8 *fatbuf;
 
 	switch (mydata->fatsize) {
 	case 32:
@@ -284,39 +322,22 @@ static int set_fatent_value(fsdata *mydata, __u32 entry, __u32 entry_value)
 		return -1;
 	}
 
-	/* Read a new block of FAT entries into the cache. */
-	if (bufnum != mydata->fatbufnum) {
-		int getsize = FATBUFBLOCKS;
-		__u8 *bufptr = mydata->fatbuf;
-		__u32 fatlength = mydata->fatlength;
-		__u32 startblock = bufnum * FATBUFBLOCKS;
-
-		/* Cap length if fatlength is not a multiple of FATBUFBLOCKS */
-		if (startblock + getsize > fatlength)
-			getsize = fatlength - startblock;
-
-		if (flush_dirty_fat_buffer(mydata) < 0)
-			return -1;
-
-		startblock += mydata->fat_sect;
-
-		if (disk_read(startblock, getsize, bufptr) < 0) {
-			debug("Error reading FAT blocks\n");
-			return -1;
-		}
-		mydata->fatbufnum = bufnum;
-	}
+	fatbuf = get_fatbuf(mydata, bufnum);
+	if (!fatbuf)
+		return -1;
 
 	/* Mark as dirty */
+	if (mydata->fatbufstate)
+		mydata->fatbufstate[bufnum] |= FATBUF_DIRTY;
 	mydata->fat_dirty = 1;
 
 	/* Set the actual entry */
 	switch (mydata->fatsize) {
 	case 32:
-		((__u32 *) mydata->fatbuf)[offset] = cpu_to_le32(entry_value);
+		((__u32 *)fatbuf)[offset] = cpu_to_le32(entry_value);
 		break;
 	case 16:
-		((__u16 *) mydata->fatbuf)[offset] = cpu_to_le16(entry_value);
+		((__u16 *)fatbuf)[offset] = cpu_to_le16(entry_value);
 		break;
 	case 12:
 		off16 = (offset * 3) / 4;
@@ -324,33 +345,33 @@ static int set_fatent_value(fsdata *mydata, __u32 entry, __u32 entry_value)
 		switch (offset & 0x3) {
 		case 0:
 			val1 = cpu_to_le16(entry_value) & 0xfff;
-			((__u16 *)mydata->fatbuf)[off16] &= ~0xfff;
-			((__u16 *)mydata->fatbuf)[off16] |= val1;
+			((__u16 *)fatbuf)[off16] &= ~0xfff;
+			((__u16 *)fatbuf)[off16] |= val1;
 			break;
 		case 1:
 			val1 = cpu_to_le16(entry_value) & 0xf;
 			val2 = (cpu_to_le16(entry_value) >> 4) & 0xff;
 
-			((__u16 *)mydata->fatbuf)[off16] &= ~0xf000;
-			((__u16 *)mydata->fatbuf)[off16] |= (val1 << 12);
+			((__u16 *)fatbuf)[off16] &= ~0xf000;
+			((__u16 *)fatbuf)[off16] |= (val1 << 12);
 
-			((__u16 *)mydata->fatbuf)[off16 + 1] &= ~0xff;
-			((__u16 *)mydata->fatbuf)[off16 + 1] |= val2;
+			((__u16 *)fatbuf)[off16 + 1] &= ~0xff;
+			((__u16 *)fatbuf)[off16 + 1] |= val2;
 			break;
 		case 2:
 			val1 = cpu_to_le16(entry_value) & 0xff;
 			val2 = (cpu_to_le16(entry_value) >> 8) & 0xf;
 
-			((__u16 *)mydata->fatbuf)[off16] &= ~0xff00;
-			((__u16 *)mydata->fatbuf)[off16] |= (val1 << 8);
+			((__u16 *)fatbuf)[off16] &= ~0xff00;
+			((__u16 *)fatbuf)[off16] |= (val1 << 8);
 
-			((__u16 *)mydata->fatbuf)[off16 + 1] &= ~0xf;
-			((__u16 *)mydata->fatbuf)[off16 + 1] |= val2;
+			((__u16 *)fatbuf)[off16 + 1] &= ~0xf;
+			((__u16 *)fatbuf)[off16 + 1] |= val2;
 			break;
 		case 3:
 			val1 = cpu_to_le16(entry_value) & 0xfff;
-			((__u16 *)mydata->fatbuf)[off16] &= ~0xfff0;
-			((__u16 *)mydata->fatbuf)[off16] |= (val1 << 4);
+			((__u16 *)fatbuf)[off16] &= ~0xfff0;
+			((__u16 *)fatbuf)[off16] |= (val1 << 4);
 			break;
 		default:
 			break;
@@ -1232,21 +1253,25 @@ static int fat_dir_entries(fat_itr *itr)
 	fat_itr_child(dirs, itr);
 	fsdata = *dirs->fsdata;
 
-	/* allocate local fat buffer */
-	fsdata.fatbuf = malloc_cache_aligned(FATBUFSIZE);
-	if (!fsdata.fatbuf) {
-		debug("Error: allocating memory\n");
-		count = -ENOMEM;
-		goto exit;
+	/* allocate local fat buffer, a cache of the whole FAT is shared */
+	if (!fsdata.fatbufstate) {
+		fsdata.fatbuf = malloc_cache_aligned(FATBUFSIZE);
+		if (!fsdata.fatbuf) {
+			debug("Error: allocating memory\n");
+			count = -ENOMEM;
+			goto exit;
+		}
+		fsdata.fatbufnum = -1;
+		fsdata.fat_dirty = 0;
+		dirs->fsdata = &fsdata;
 	}
-	fsdata.fatbufnum = -1;
-	dirs->fsdata = &fsdata;
 
 	for (count = 0; fat_itr_next(dirs); count++)
 		;
 
 exit:
-	free(fsdata.fatbuf);
+	if (!fsdata.fatbufstate)
+		free(fsdata.fatbuf);
 	free(dirs);
 	return count;
 }
@@ -11,12 +11,14 @@
 #include <ext4fs.h>
 #include <fat.h>
 #include <fs.h>
+#include <image.h>
 #include <sandboxfs.h>
 #include <ubifs_uboot.h>
 #include <btrfs.h>
 #include <asm/io.h>
 #include <div64.h>
 #include <linux/math64.h>
+#include <linux/sizes.h>
 
 DECLARE_GLOBAL_DATA_PTR;
 
@@ -470,14 +472,45 @@ static int fs_read_lmb_check(const char *filename, ulong addr, loff_t offset,
 	lmb_init_and_reserve(&lmb, gd->bd, (void *)gd->fdt_blob);
 	lmb_dump_all(&lmb);
 
-	if (lmb_alloc_addr(&lmb, addr, read_len) == addr)
-		return 0;
+	ret = lmb_alloc_addr(&lmb, addr, read_len) == addr ? 0 : -ENOSPC;
+	lmb_release(&lmb);
+	if (ret)
+		printf("** Reading file would overwrite reserved memory **\n");
 
-	printf("** Reading file would overwrite reserved memory **\n");
-	return -ENOSPC;
+	return ret;
 }
 #endif
 
+/*
+ * Pieces in which a file is hashed after loading it. The first piece must
+ * hold the FIT header.
+ */
+#define FS_HASH_CHUNK_SIZE	SZ_256K
+
+/*
+ * Read a whole file, then hand it to fit_hash_load_data() piece by piece.
+ * Filesystems find the position of a read from the start of the file each
+ * time, so the file is read in one go rather than in pieces.
+ */
+static int fs_read_hashed(struct fstype_info *info, const char *filename,
+			  void *buf, loff_t len, loff_t *actread)
+{
+	loff_t pos, chunk;
+	int ret;
+
+	ret = info->read(filename, buf, 0, len, actread);
+	if (ret)
+		return ret;
+
+	fit_hash_load_start(buf);
+	for (pos = 0; pos < *actread && fit_hash_load_active(); pos += chunk) {
+		chunk = min_t(loff_t, *actread - pos, FS_HASH_CHUNK_SIZE);
+		fit_hash_load_data(buf + pos, chunk);
+	}
+
+	return 0;
+}
+
 static int _fs_read(const char *filename, ulong addr, loff_t offset, loff_t len,
 		    int do_lmb_check, loff_t *actread)
 {
@@ -498,7 +531,11 @@ static int _fs_read(const char *filename, ulong addr, loff_t offset, loff_t len,
 	 * means read the whole file.
 	 */
 	buf = map_sysmem(addr, len);
-	ret = info->read(filename, buf, offset, len, actread);
+	/* Only files loaded by the 'load' command are hashed */
+	if (IMAGE_ENABLE_HASH_ON_LOAD && do_lmb_check && !offset)
+		ret = fs_read_hashed(info, filename, buf, len, actread);
+	else
+		ret = info->read(filename, buf, offset, len, actread);
 	unmap_sysmem(buf);
 
 	/* If we requested a specific number of bytes, check we got it */
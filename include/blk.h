@@ -8,6 +8,7 @@
 #define BLK_H
 
 #include <efi.h>
+#include <linux/list.h>
 
 #ifdef CONFIG_SYS_64BIT_LBA
 typedef uint64_t lbaint_t;
@@ -85,6 +86,10 @@ struct blk_desc {
 		uint32_t mbr_sig;	/* MBR integer signature */
 		efi_guid_t guid_sig;	/* GPT GUID Signature */
 	};
+#if CONFIG_IS_ENABLED(PARTITION_CACHE)
+	struct part_cache *part_cache;	/* parsed partition table */
+	unsigned int	part_reads;	/* times the table was read */
+#endif
 #if CONFIG_IS_ENABLED(BLK)
 	/*
 	 * For now we have a few functions which take struct blk_desc as a
@@ -112,65 +117,129 @@ struct blk_desc {
 #define PAD_TO_BLOCKSIZE(size, blk_desc) \
 	(PAD_SIZE(size, blk_desc->blksz))
 
+/**
+ * typedef blkcache_read_t - read blocks from a device, bypassing the cache
+ *
+ * This has the same arguments and return value as blk_dread()
+ */
+typedef unsigned long (*blkcache_read_t)(struct blk_desc *block_dev,
+					 lbaint_t start, lbaint_t blkcnt,
+					 void *buffer);
+
+/**
+ * typedef blkcache_write_t - write blocks to a device, bypassing the cache
+ *
+ * This has the same arguments and return value as blk_dwrite()
+ */
+typedef unsigned long (*blkcache_write_t)(struct blk_desc *block_dev,
+					  lbaint_t start, lbaint_t blkcnt,
+					  const void *buffer);
+
 #if CONFIG_IS_ENABLED(BLOCK_CACHE)
 /**
- * blkcache_read() - attempt to read a set of blocks from cache
+ * blkcache_read() - read a set of blocks through the block cache
  *
- * @param iftype - IF_TYPE_x for type of device
- * @param dev - device index of particular type
+ * Blocks which are not cached are read from the device using @read, along
+ * with any read-ahead when the device is being read sequentially. Requests
+ * which are too large to cache are passed straight to @read.
+ *
+ * @param block_dev - block device to read from
  * @param start - starting block number
  * @param blkcnt - number of blocks to read
- * @param blksz - size in bytes of each block
- * @param buf - buffer to contain cached data
+ * @param buffer - buffer to contain the data read
+ * @param read - function to read blocks from the device
  *
- * @return - '1' if block returned from cache, '0' otherwise.
+ * @return - number of blocks read, or -ve error number (see the
+ * IS_ERR_VALUE() macro)
  */
-int blkcache_read(int iftype, int dev,
-		  lbaint_t start, lbaint_t blkcnt,
-		  unsigned long blksz, void *buffer);
+ulong blkcache_read(struct blk_desc *block_dev, lbaint_t start,
+		    lbaint_t blkcnt, void *buffer, blkcache_read_t read);
 
 /**
- * blkcache_fill() - make data read from a block device available
- * to the block cache
+ * blkcache_write() - write a set of blocks through the block cache
+ *
+ * By default the data is written to the device with @write and any cached
+ * copy updated. With CONFIG_BLOCK_CACHE_WRITEBACK the data may instead be
+ * held in the cache until blkcache_flush() is called or the page is evicted.
+ *
+ * @param block_dev - block device to write to
+ * @param start - starting block number
+ * @param blkcnt - number of blocks to write
+ * @param buffer - buffer containing the data to write
+ * @param write - function to write blocks to the device
+ *
+ * @return - number of blocks written, or -ve error number (see the
+ * IS_ERR_VALUE() macro)
+ */
+ulong blkcache_write(struct blk_desc *block_dev, lbaint_t start,
+		     lbaint_t blkcnt, const void *buffer,
+		     blkcache_write_t write);
+
+/**
+ * blkcache_flush() - write back any dirty blocks held for a device
  *
  * @param iftype - IF_TYPE_x for type of device
  * @param dev - device index of particular type
- * @param start - starting block number
- * @param blkcnt - number of blocks available
- * @param blksz - size in bytes of each block
- * @param buf - buffer containing data to cache
  *
+ * @return - 0 if OK, -EIO if a write failed
+ */
+int blkcache_flush(int iftype, int dev);
+
+/**
+ * blkcache_flush_all() - write back the dirty blocks of every device
+ *
+ * This must be called before handing over to an OS or resetting, since
+ * nothing else writes back blocks held by CONFIG_BLOCK_CACHE_WRITEBACK.
+ *
+ * @return - 0 if OK, -EIO if a write failed
  */
-void blkcache_fill(int iftype, int dev,
-		   lbaint_t start, lbaint_t blkcnt,
-		   unsigned long blksz, void const *buffer);
+int blkcache_flush_all(void);
 
 /**
  * blkcache_invalidate() - discard the cache for a set of blocks
  * because of a write or device (re)initialization.
  *
+ * Any dirty blocks are written back first. Blocks which cannot be written
+ * back stay in the cache, still dirty.
+ *
  * @param iftype - IF_TYPE_x for type of device
  * @param dev - device index of particular type
+ * @return - 0 if OK, -EIO if a write failed
  */
-void blkcache_invalidate(int iftype, int dev);
+int blkcache_invalidate(int iftype, int dev);
 
 /**
  * blkcache_configure() - configure block cache
  *
- * @param blocks - maximum blocks per entry
- * @param entries - maximum entries in cache
+ * @param blocks - blocks per cache page, rounded down to a power of two
+ * @param entries - maximum pages in cache
  */
 void blkcache_configure(unsigned blocks, unsigned entries);
 
+/**
+ * blkcache_set_readahead() - set the maximum read-ahead
+ *
+ * @param blocks - maximum number of blocks to read ahead, 0 to disable
+ */
+void blkcache_set_readahead(unsigned blocks);
+
 /*
  * statistics of the block cache
+ *
+ * hits and misses are counted in cache pages, read-ahead and write-back
+ * in blocks
  */
 struct block_cache_stats {
 	unsigned hits;
 	unsigned misses;
 	unsigned entries; /* current entry count */
+	unsigned dirty; /* current count of entries not written back */
+	unsigned readahead_blocks; /* blocks read ahead */
+	unsigned readahead_hits; /* read-ahead blocks later used */
+	unsigned writebacks; /* blocks written back */
 	unsigned max_blocks_per_entry;
 	unsigned max_entries;
+	unsigned max_readahead;
 };
 
 /**
@@ -182,24 +251,89 @@ void blkcache_stats(struct block_cache_stats *stats);
 
 #else
 
-static inline int blkcache_read(int iftype, int dev,
-				lbaint_t start, lbaint_t blkcnt,
-				unsigned long blksz, void *buffer)
+static inline ulong blkcache_read(struct blk_desc *block_dev, lbaint_t start,
+				  lbaint_t blkcnt, void *buffer,
+				  blkcache_read_t read)
+{
+	return read(block_dev, start, blkcnt, buffer);
+}
+
+static inline ulong blkcache_write(struct blk_desc *block_dev,
+				   lbaint_t start, lbaint_t blkcnt,
+				   const void *buffer, blkcache_write_t write)
+{
+	return write(block_dev, start, blkcnt, buffer);
+}
+
+static inline int blkcache_flush(int iftype, int dev)
 {
 	return 0;
 }
 
-static inline void blkcache_fill(int iftype, int dev,
-				 lbaint_t start, lbaint_t blkcnt,
-				 unsigned long blksz, void const *buffer) {}
+static inline int blkcache_flush_all(void)
+{
+	return 0;
+}
+
+static inline int blkcache_invalidate(int iftype, int dev)
+{
+	return 0;
+}
 
-static inline void blkcache_invalidate(int iftype, int dev) {}
+#endif
 
+#if CONFIG_IS_ENABLED(PARTITION_CACHE)
+/**
+ * part_cache_write() - note that blocks of a device are being changed
+ *
+ * This drops the cached partition table of the device if the blocks hold
+ * part of it.
+ *
+ * @param desc - block device descriptor
+ * @param start - first block being changed
+ * @param blkcnt - number of blocks being changed
+ */
+void part_cache_write(struct blk_desc *desc, lbaint_t start, lbaint_t blkcnt);
+#else
+static inline void part_cache_write(struct blk_desc *desc, lbaint_t start,
+				    lbaint_t blkcnt) {}
 #endif
 
 #if CONFIG_IS_ENABLED(BLK)
 struct udevice;
 
+/* Operations which can be performed by an asynchronous block request */
+enum blk_req_op {
+	BLK_REQ_READ,
+	BLK_REQ_WRITE,
+};
+
+/**
+ * struct blk_req - an asynchronous block request
+ *
+ * The caller fills in @op, @start, @blkcnt and @buffer and hands the request
+ * to blk_submit(). From then on it belongs to the block device until @status
+ * changes from -EINPROGRESS, so it must not be changed or freed before that.
+ *
+ * @op:		Operation to perform
+ * @start:	Start block number (0=first)
+ * @blkcnt:	Number of blocks to transfer
+ * @buffer:	Buffer to read into or write from
+ * @status:	-EINPROGRESS while the request is outstanding, then 0 if all
+ *		blocks were transferred or -ve error number
+ * @sibling:	Node in the device's request queue, for use by the uclass
+ * @priv:	For use by the driver while it is handling the request
+ */
+struct blk_req {
+	enum blk_req_op op;
+	lbaint_t start;
+	lbaint_t blkcnt;
+	void *buffer;
+	int status;
+	struct list_head sibling;
+	void *priv;
+};
+
 /* Operations on block devices */
 struct blk_ops {
 	/**
@@ -258,6 +392,35 @@ struct blk_ops {
 	 * @return 0 if OK, -ve on error
 	 */
 	int (*select_hwpart)(struct udevice *dev, int hwpart);
+
+	/**
+	 * submit() - start an asynchronous request
+	 *
+	 * This starts the transfer and returns without waiting for it. The
+	 * driver reports completion by calling blk_req_done(), normally from
+	 * its poll() method. It must not use @req->sibling.
+	 *
+	 * @dev:	Device to transfer to or from
+	 * @req:	Request to start
+	 * @return 0 if the request was started, -EBUSY if the device cannot
+	 * take another request until an earlier one completes, -ENOSYS if
+	 * this request cannot be handled asynchronously (the uclass then
+	 * uses read() or write() instead), other -ve on error
+	 */
+	int (*submit)(struct udevice *dev, struct blk_req *req);
+
+	/**
+	 * poll() - check for completed asynchronous requests
+	 *
+	 * This must not wait for the device. It calls blk_req_done() for
+	 * each request which has completed, or timed out, since the last
+	 * call.
+	 *
+	 * @dev:	Device to check
+	 * @return 0 if OK, -ve on error, in which case all the device's
+	 * outstanding requests are failed with that error
+	 */
+	int (*poll)(struct udevice *dev);
 };
 
 #define blk_get_ops(dev)	((struct blk_ops *)(dev)->driver->ops)
@@ -275,6 +438,58 @@ unsigned long blk_dwrite(struct blk_desc *block_dev, lbaint_t start,
 unsigned long blk_derase(struct blk_desc *block_dev, lbaint_t start,
 			 lbaint_t blkcnt);
 
+/**
+ * blk_submit() - queue an asynchronous block request
+ *
+ * The request is started as soon as the device can accept it, which may be
+ * straight away. Each device handles its requests in the order they are
+ * submitted, but they may complete in any order. For devices whose driver
+ * does not support asynchronous requests, the transfer is performed before
+ * this function returns.
+ *
+ * Requests bypass the block cache: dirty blocks are written back before a
+ * read is queued and the cache is invalidated before a write is queued.
+ *
+ * @dev:	Block device to use
+ * @req:	Request to queue, see struct blk_req
+ * @return 0 if OK, -ve on error, in which case the request is not queued
+ */
+int blk_submit(struct udevice *dev, struct blk_req *req);
+
+/**
+ * blk_poll() - progress the asynchronous requests on a device
+ *
+ * This checks for completed requests and starts any queued ones which the
+ * device can now accept. It does not wait.
+ *
+ * @dev:	Block device to check
+ * @return number of requests which are still outstanding
+ */
+int blk_poll(struct udevice *dev);
+
+/**
+ * blk_wait() - wait for an asynchronous request to complete
+ *
+ * Drivers time out requests which the device does not complete, so this
+ * does not need its own timeout.
+ *
+ * @dev:	Block device the request was submitted to
+ * @req:	Request to wait for
+ * @return the request's final status: 0 if OK, -ve on error
+ */
+int blk_wait(struct udevice *dev, struct blk_req *req);
+
+/**
+ * blk_req_done() - report that an asynchronous request has completed
+ *
+ * This is called by drivers once a request passed to their submit() method
+ * has completed. The request then belongs to its submitter again.
+ *
+ * @req:	Request which has completed
+ * @status:	0 if all blocks were transferred, else -ve error number
+ */
+void blk_req_done(struct blk_req *req, int status);
+
 /**
  * blk_find_device() - Find a block device
  *
@@ -428,35 +643,29 @@ struct blk_desc *blk_get_by_device(struct udevice *dev);
 static inline ulong blk_dread(struct blk_desc *block_dev, lbaint_t start,
 			      lbaint_t blkcnt, void *buffer)
 {
-	ulong blks_read;
-	if (blkcache_read(block_dev->if_type, block_dev->devnum,
-			  start, blkcnt, block_dev->blksz, buffer))
-		return blkcnt;
-
 	/*
 	 * We could check if block_read is NULL and return -ENOSYS. But this
 	 * bloats the code slightly (cause some board to fail to build), and
 	 * it would be an error to try an operation that does not exist.
 	 */
-	blks_read = block_dev->block_read(block_dev, start, blkcnt, buffer);
-	if (blks_read == blkcnt)
-		blkcache_fill(block_dev->if_type, block_dev->devnum,
-			      start, blkcnt, block_dev->blksz, buffer);
-
-	return blks_read;
+	return blkcache_read(block_dev, start, blkcnt, buffer,
+			     block_dev->block_read);
 }
 
 static inline ulong blk_dwrite(struct blk_desc *block_dev, lbaint_t start,
 			       lbaint_t blkcnt, const void *buffer)
 {
-	blkcache_invalidate(block_dev->if_type, block_dev->devnum);
-	return block_dev->block_write(block_dev, start, blkcnt, buffer);
+	part_cache_write(block_dev, start, blkcnt);
+	return blkcache_write(block_dev, start, blkcnt, buffer,
+			      block_dev->block_write);
 }
 
 static inline ulong blk_derase(struct blk_desc *block_dev, lbaint_t start,
 			       lbaint_t blkcnt)
 {
-	blkcache_invalidate(block_dev->if_type, block_dev->devnum);
+	if (blkcache_invalidate(block_dev->if_type, block_dev->devnum))
+		return -EIO;
+	part_cache_write(block_dev, start, blkcnt);
 	return block_dev->block_erase(block_dev, start, blkcnt);
 }
 
@@ -434,6 +434,28 @@ int gunzip(void *, int, unsigned char *, unsigned long *);
 int zunzip(void *dst, int dstlen, unsigned char *src, unsigned long *lenp,
 						int stoponerr, int offset);
 
+/**
+ * gunzip_stream() - Decompress gzip data which arrives piece by piece
+ *
+ * Each piece is decompressed as soon as it has been read, so that reading
+ * and decompressing overlap and the compressed data never needs to be in
+ * memory all at once. Once the header has been read, @buf is always
+ * aligned to ARCH_DMA_MINALIGN, so @read can read from a device straight
+ * into it. Its size depends on what fits in the heap, from 4KiB to 64KiB.
+ *
+ * @dst:	buffer for the uncompressed data
+ * @dstlen:	size of @dst
+ * @lenp:	returns the number of bytes uncompressed
+ * @read:	called to read up to @len more bytes of compressed data into
+ *		@buf. Returns the number of bytes read, 0 at the end of the
+ *		data or -ve on error
+ * @priv:	private data for @read
+ * @return 0 if OK, -ENOSPC if @dst is too small, -ENOMEM if there is not
+ *	enough memory, other -ve on error
+ */
+int gunzip_stream(void *dst, ulong dstlen, ulong *lenp,
+		  int (*read)(void *priv, void *buf, ulong len), void *priv);
+
 /**
  * gzwrite progress indicators: defined weak to allow board-specific
  * overrides:
@@ -476,6 +498,41 @@ int gzwrite(unsigned char *src, int len,
 /* lib/lz4_wrapper.c */
 int ulz4fn(const void *src, size_t srcn, void *dst, size_t *dstn);
 
+/**
+ * zstd_decompress() - Decompress a buffer holding Zstandard frames
+ *
+ * @src:	compressed data
+ * @srcn:	length of the compressed data
+ * @dst:	buffer for the uncompressed data
+ * @dstn:	on entry the size of @dst, on exit the number of bytes
+ *		uncompressed. It is left unchanged if @dst is too small.
+ * @return 0 if OK, -ENOSPC if @dst is too small, other -ve on error
+ */
+int zstd_decompress(const void *src, size_t srcn, void *dst, size_t *dstn);
+
+/**
+ * zstd_decompress_stream() - Decompress Zstandard frames which arrive piece
+ *			      by piece
+ *
+ * This is like gunzip_stream(). The output is written straight to @dst, so
+ * no window buffer is needed, however large the frames' window size. The
+ * buffer for compressed data holds at least one block of up to 128KiB and
+ * @buf is always aligned to ARCH_DMA_MINALIGN.
+ *
+ * @dst:	buffer for the uncompressed data
+ * @dstn:	on entry the size of @dst, on exit the number of bytes
+ *		uncompressed
+ * @read:	called to read up to @len more bytes of compressed data into
+ *		@buf. Returns the number of bytes read, 0 at the end of the
+ *		data or -ve on error
+ * @priv:	private data for @read
+ * @return 0 if OK, -ENOSPC if @dst is too small, -ENOMEM if there is not
+ *	enough memory, other -ve on error
+ */
+int zstd_decompress_stream(void *dst, size_t *dstn,
+			   int (*read)(void *priv, void *buf, ulong len),
+			   void *priv);
+
 /* lib/qsort.c */
 void qsort(void *base, size_t nmemb, size_t size,
 	   int(*compar)(const void *, const void *));
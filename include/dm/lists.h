@@ -61,6 +61,31 @@ int lists_bind_drivers(struct udevice *parent, bool pre_reloc_only);
 int lists_bind_fdt(struct udevice *parent, ofnode node, struct udevice **devp,
 		   bool pre_reloc_only);
 
+/**
+ * lists_driver_lookup_compatible() - Find the driver for a compatible string
+ *
+ * This returns the first driver in the linker list with a matching entry in
+ * its of_match table. With CONFIG_DM_COMPAT_INDEX this uses the index built
+ * by lists_build_compat_index(), if available.
+ *
+ * @compat: Compatible string to look up
+ * @of_idp: Returns the matching entry of the driver's of_match table
+ * @return pointer to driver, or NULL if not found
+ */
+struct driver *lists_driver_lookup_compatible(const char *compat,
+					      const struct udevice_id **of_idp);
+
+/**
+ * lists_build_compat_index() - Build the compatible string to driver index
+ *
+ * This is called by dm_init(). Until it has been called, or if it fails,
+ * drivers are looked up by searching through all of them.
+ *
+ * @return 0 if OK, -ENOMEM if there is not enough memory for the index,
+ * -E2BIG if there are too many drivers
+ */
+int lists_build_compat_index(void);
+
 /**
  * device_bind_driver() - bind a device to a driver
  *
@@ -218,7 +218,8 @@ int uclass_get_device_by_ofnode(enum uclass_id id, ofnode node,
 /**
  * uclass_get_device_by_phandle_id() - Get a uclass device by phandle id
  *
- * This searches the devices in the uclass for one with the given phandle id.
+ * This looks up the device tree node with the given phandle id, then
+ * searches the devices in the uclass for one attached to that node.
  *
  * The device is probed to activate it ready for use.
  *
@@ -29,6 +29,17 @@
 #define FAT16BUFSIZE	(FATBUFSIZE/2)
 #define FAT32BUFSIZE	(FATBUFSIZE/4)
 
+/* Largest FAT kept in memory as a whole, see CONFIG_FS_FAT_CACHE_SIZE */
+#if defined(CONFIG_SPL_BUILD) || !defined(CONFIG_FS_FAT_CACHE_SIZE)
+#define FAT_CACHE_SIZE	0
+#else
+#define FAT_CACHE_SIZE	(CONFIG_FS_FAT_CACHE_SIZE * 1024ULL)
+#endif
+
+/* Per-window state of the FAT cache, see fsdata.fatbufstate */
+#define FATBUF_VALID	0x01
+#define FATBUF_DIRTY	0x02
+
 /* Maximum number of entry for long file name according to spec */
 #define MAX_LFN_SLOT	20
 
@@ -161,11 +172,12 @@ typedef struct dir_slot {
  * (see FAT32 accesses)
  */
 typedef struct {
-	__u8	*fatbuf;	/* Current FAT buffer */
+	__u8	*fatbuf;	/* Current FAT buffer, or the cached FAT */
+	__u8	*fatbufstate;	/* FATBUF_* per window, NULL if uncached */
 	int	fatsize;	/* Size of FAT in bits */
 	__u32	fatlength;	/* Length of FAT in sectors */
 	__u16	fat_sect;	/* Starting sector of the FAT */
-	__u8	fat_dirty;      /* Set if fatbuf has been modified */
+	__u8	fat_dirty;      /* Set if any of fatbuf has been modified */
 	__u32	rootdir_sect;	/* Start sector of root directory */
 	__u16	sect_size;	/* Size of sectors in bytes */
 	__u16	clust_size;	/* Size of clusters in sectors */
@@ -675,6 +675,41 @@ const char *fdtdec_get_compatible(enum fdt_compat_id id);
  */
 int fdtdec_lookup_phandle(const void *blob, int node, const char *prop_name);
 
+#if CONFIG_IS_ENABLED(OF_PHANDLE_CACHE)
+/**
+ * fdtdec_node_offset_by_phandle() - find the node which has a given phandle
+ *
+ * This does the same as fdt_node_offset_by_phandle(). After relocation it
+ * builds an index of the phandles in @blob on first use, so that later
+ * lookups in the same tree do not have to scan it. The index is rebuilt if
+ * the tree changes.
+ *
+ * @param blob		FDT blob
+ * @param phandle	phandle to look for
+ * @return node offset if found, -ve error code on error
+ */
+int fdtdec_node_offset_by_phandle(const void *blob, uint32_t phandle);
+
+/**
+ * fdtdec_phandle_cache_invalidate() - drop the phandle index of a tree
+ *
+ * Call this after changing the phandles or the structure of a tree, for
+ * example by applying an overlay to it. Changes are also detected during
+ * lookups, so this only avoids a needless lookup in a stale index.
+ *
+ * @param blob		FDT blob which was changed, or NULL for any
+ */
+void fdtdec_phandle_cache_invalidate(const void *blob);
+#else
+static inline int fdtdec_node_offset_by_phandle(const void *blob,
+						uint32_t phandle)
+{
+	return fdt_node_offset_by_phandle(blob, phandle);
+}
+
+static inline void fdtdec_phandle_cache_invalidate(const void *blob) {}
+#endif
+
 /**
  * Look up a property in a node and return its contents in an integer
  * array of given length. The property must have at least enough data for
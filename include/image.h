@@ -32,8 +32,12 @@ struct fdt_region;
 #define CONFIG_FIT_VERBOSE	1 /* enable fit_format_{error,warning}() */
 #define CONFIG_FIT_ENABLE_RSASSA_PSS_SUPPORT 1
 #define CONFIG_FIT_ENABLE_SHA256_SUPPORT
+#define CONFIG_FIT_ENABLE_SHA384_SUPPORT
+#define CONFIG_FIT_ENABLE_SHA512_SUPPORT
 #define CONFIG_SHA1
 #define CONFIG_SHA256
+#define CONFIG_SHA384
+#define CONFIG_SHA512
 
 #define IMAGE_ENABLE_IGNORE	0
 #define IMAGE_INDENT_STRING	""
@@ -92,6 +96,20 @@ struct fdt_region;
 #define IMAGE_ENABLE_SHA256	0
 #endif
 
+#if defined(CONFIG_FIT_ENABLE_SHA384_SUPPORT) || \
+	defined(CONFIG_SPL_SHA384_SUPPORT)
+#define IMAGE_ENABLE_SHA384	1
+#else
+#define IMAGE_ENABLE_SHA384	0
+#endif
+
+#if defined(CONFIG_FIT_ENABLE_SHA512_SUPPORT) || \
+	defined(CONFIG_SPL_SHA512_SUPPORT)
+#define IMAGE_ENABLE_SHA512	1
+#else
+#define IMAGE_ENABLE_SHA512	0
+#endif
+
 #endif /* IMAGE_ENABLE_FIT */
 
 #ifdef CONFIG_SYS_BOOT_GET_CMDLINE
@@ -301,6 +319,7 @@ enum {
 	IH_COMP_LZMA,			/* lzma  Compression Used	*/
 	IH_COMP_LZO,			/* lzo   Compression Used	*/
 	IH_COMP_LZ4,			/* lz4   Compression Used	*/
+	IH_COMP_ZSTD,			/* zstd  Compression Used	*/
 
 	IH_COMP_COUNT,
 };
@@ -1305,6 +1324,88 @@ static inline int fit_image_check_target_arch(const void *fdt, int node)
 #endif /* CONFIG_FIT_VERBOSE */
 #endif /* CONFIG_FIT */
 
+#ifdef USE_HOSTCC
+#define IMAGE_ENABLE_HASH_ON_LOAD	0
+#else
+#define IMAGE_ENABLE_HASH_ON_LOAD	CONFIG_IS_ENABLED(FIT_HASH_ON_LOAD)
+#endif
+
+#if IMAGE_ENABLE_HASH_ON_LOAD
+/**
+ * fit_hash_load_start() - Start hashing a FIT while it is being loaded
+ *
+ * Any digests from a previous load are dropped. Loaders call this before
+ * storing the first byte of a file, whether or not it turns out to be a FIT.
+ *
+ * @buf:	Address the file is loaded to
+ */
+void fit_hash_load_start(const void *buf);
+
+/**
+ * fit_hash_load_data() - Note that part of the file has been stored
+ *
+ * Data may be stored in any order, e.g. by TFTP with a window of several
+ * blocks, but must not be stored twice. Once the FIT header has arrived,
+ * each image with external data is hashed as soon as all data up to it is
+ * in place.
+ *
+ * @buf:	Address the data was stored at
+ * @len:	Number of bytes stored
+ */
+void fit_hash_load_data(const void *buf, ulong len);
+
+/**
+ * fit_hash_load_command() - Note that a command is about to run
+ *
+ * Memory may be changed by commands which do not report it, so the digests
+ * of a load are kept for the next command only and dropped by the one after.
+ */
+void fit_hash_load_command(void);
+
+/**
+ * fit_hash_load_claim() - Claim the digests of a load for a bootm
+ *
+ * This keeps the digests for verifying the images if the bootm is the
+ * command run straight after the load, and drops them otherwise. Digests
+ * which are not claimed are never used.
+ */
+void fit_hash_load_claim(void);
+
+/**
+ * fit_hash_load_active() - Check whether the load is being hashed
+ *
+ * @return true if the file may be a FIT whose images are being hashed, false
+ *	once it is known not to be one or to have nothing to hash
+ */
+bool fit_hash_load_active(void);
+#else
+static inline void fit_hash_load_start(const void *buf) {}
+static inline void fit_hash_load_data(const void *buf, ulong len) {}
+static inline void fit_hash_load_command(void) {}
+static inline void fit_hash_load_claim(void) {}
+static inline bool fit_hash_load_active(void)
+{
+	return false;
+}
+#endif
+
+/**
+ * fit_hash_load_lookup() - Get a digest calculated while loading
+ *
+ * Only digests claimed with fit_hash_load_claim() are returned, and each
+ * of them only once.
+ *
+ * @algo:	Name of the hash algorithm, as in the FIT
+ * @data:	Start of the image data
+ * @size:	Size of the image data
+ * @value:	Returns the digest
+ * @value_len:	Returns the size of the digest
+ * @return 0 if a digest for exactly this data and algorithm is available,
+ *	-ENOENT if not
+ */
+int fit_hash_load_lookup(const char *algo, const void *data, ulong size,
+			 uint8_t *value, int *value_len);
+
 #if defined(CONFIG_ANDROID_BOOT_IMAGE)
 struct andr_img_hdr;
 int android_image_check_header(const struct andr_img_hdr *hdr);
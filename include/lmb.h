@@ -12,17 +12,51 @@
  * Copyright (C) 2001 Peter Bergner, IBM Corp.
  */
 
+/*
+ * Number of regions which fit into struct lmb_region itself; once they are
+ * used up the table is moved to the heap and grows as needed.
+ */
 #define MAX_LMB_REGIONS 8
 
+/**
+ * enum lmb_flags - attributes of a reserved region
+ *
+ * @LMB_NONE:		no special request
+ * @LMB_NOMAP:		the OS must not map the region, e.g. a reserved-memory
+ *			node with the no-map property
+ * @LMB_NOOVERWRITE:	the region may not be reserved a second time, so that
+ *			nothing else can be loaded on top of it
+ */
+enum lmb_flags {
+	LMB_NONE		= 0,
+	LMB_NOMAP		= 1 << 0,
+	LMB_NOOVERWRITE		= 1 << 1,
+};
+
 struct lmb_property {
 	phys_addr_t base;
 	phys_size_t size;
+	enum lmb_flags flags;
 };
 
+/**
+ * struct lmb_region - table of regions, sorted by base address
+ *
+ * The regions never overlap, so the table can be searched with a binary
+ * search.
+ *
+ * @cnt:		Number of regions in use
+ * @max:		Number of regions which fit into @region
+ * @size:		Unused
+ * @region:		The regions, either @initial_region or a heap buffer
+ * @initial_region:	Storage used until the table outgrows it
+ */
 struct lmb_region {
 	unsigned long cnt;
+	unsigned long max;
 	phys_size_t size;
-	struct lmb_property region[MAX_LMB_REGIONS+1];
+	struct lmb_property *region;
+	struct lmb_property initial_region[MAX_LMB_REGIONS];
 };
 
 struct lmb {
@@ -31,11 +65,23 @@ struct lmb {
 };
 
 extern void lmb_init(struct lmb *lmb);
+/**
+ * lmb_release() - Free the heap memory of the region tables
+ *
+ * This must be called once an initialised struct lmb is no longer needed or
+ * before it is initialised again. Afterwards the struct is empty, as after
+ * lmb_init(). A zeroed struct lmb can also be released.
+ *
+ * @lmb: the lmb to release
+ */
+extern void lmb_release(struct lmb *lmb);
 extern void lmb_init_and_reserve(struct lmb *lmb, bd_t *bd, void *fdt_blob);
 extern void lmb_init_and_reserve_range(struct lmb *lmb, phys_addr_t base,
 				       phys_size_t size, void *fdt_blob);
 extern long lmb_add(struct lmb *lmb, phys_addr_t base, phys_size_t size);
 extern long lmb_reserve(struct lmb *lmb, phys_addr_t base, phys_size_t size);
+extern long lmb_reserve_flags(struct lmb *lmb, phys_addr_t base,
+			      phys_size_t size, enum lmb_flags flags);
 extern phys_addr_t lmb_alloc(struct lmb *lmb, phys_size_t size, ulong align);
 extern phys_addr_t lmb_alloc_base(struct lmb *lmb, phys_size_t size, ulong align,
 			    phys_addr_t max_addr);
@@ -45,6 +91,8 @@ extern phys_addr_t lmb_alloc_addr(struct lmb *lmb, phys_addr_t base,
 				  phys_size_t size);
 extern phys_size_t lmb_get_free_size(struct lmb *lmb, phys_addr_t addr);
 extern int lmb_is_reserved(struct lmb *lmb, phys_addr_t addr);
+extern int lmb_is_reserved_flags(struct lmb *lmb, phys_addr_t addr,
+				 enum lmb_flags flags);
 extern long lmb_free(struct lmb *lmb, phys_addr_t base, phys_size_t size);
 
 extern void lmb_dump_all(struct lmb *lmb);
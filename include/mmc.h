@@ -461,6 +461,34 @@ struct dm_mmc_ops {
 	 */
 	int (*wait_dat0)(struct udevice *dev, int state, int timeout);
 #endif
+
+	/**
+	 * send_cmd_async() - Send a data command without waiting for the data
+	 *
+	 * This sends the command and collects its response, then returns
+	 * while the controller is still transferring the data. poll_data()
+	 * must then be called until the transfer completes, before any other
+	 * command is sent.
+	 *
+	 * @dev:	Device to receive the command
+	 * @cmd:	Command to send
+	 * @data:	Data to send/receive, which must stay valid until the
+	 *		transfer completes
+	 * @return 0 if OK, -ENOSYS if the transfer cannot be done like this
+	 * (e.g. because it does not use DMA), other -ve on error
+	 */
+	int (*send_cmd_async)(struct udevice *dev, struct mmc_cmd *cmd,
+			      struct mmc_data *data);
+
+	/**
+	 * poll_data() - Check the transfer started by send_cmd_async()
+	 *
+	 * @dev:	Device to check
+	 * @data:	Data passed to send_cmd_async()
+	 * @return 0 if the transfer has completed, -EINPROGRESS if not, other
+	 * -ve on error
+	 */
+	int (*poll_data)(struct udevice *dev, struct mmc_data *data);
 };
 
 #define mmc_get_ops(dev)        ((struct dm_mmc_ops *)(dev)->driver->ops)
@@ -473,6 +501,9 @@ int dm_mmc_get_cd(struct udevice *dev);
 int dm_mmc_get_wp(struct udevice *dev);
 int dm_mmc_execute_tuning(struct udevice *dev, uint opcode);
 int dm_mmc_wait_dat0(struct udevice *dev, int state, int timeout);
+int dm_mmc_send_cmd_async(struct udevice *dev, struct mmc_cmd *cmd,
+			  struct mmc_data *data);
+int dm_mmc_poll_data(struct udevice *dev, struct mmc_data *data);
 
 /* Transition functions for compatibility */
 int mmc_set_ios(struct mmc *mmc);
@@ -628,6 +659,9 @@ struct mmc {
 	struct udevice *vmmc_supply;	/* Main voltage regulator (Vcc)*/
 	struct udevice *vqmmc_supply;	/* IO voltage regulator (Vccq)*/
 #endif
+	struct blk_req *req;		/* asynchronous read in progress */
+	lbaint_t req_done;		/* blocks of @req read so far */
+	struct mmc_data req_data;	/* data of the command in progress */
 #endif
 	u8 *ext_csd;
 	u32 cardtype;		/* cardtype read from the MMC */
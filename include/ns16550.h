@@ -94,6 +94,7 @@ struct NS16550 {
 #endif
 #ifdef CONFIG_DM_SERIAL
 	struct ns16550_platdata *plat;
+	int fifo_size;	/* characters which fit when THR is empty */
 #endif
 };
 
@@ -186,6 +187,7 @@ typedef struct NS16550 *NS16550_t;
  */
 #define UART_IIR_NO_INT	0x01	/* No interrupts pending */
 #define UART_IIR_ID	0x06	/* Mask for the interrupt ID */
+#define UART_IIR_FIFO	0xc0	/* FIFOs enabled (16550A and later) */
 
 #define UART_IIR_MSI	0x00	/* Modem status interrupt */
 #define UART_IIR_THRI	0x02	/* Transmitter holding register empty */
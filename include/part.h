@@ -75,6 +75,60 @@ struct disk_part {
 	struct list_head list;
 };
 
+/**
+ * struct part_cache - partition table of a block device kept in memory
+ *
+ * A partition driver embeds this as the first member of its own structure,
+ * which holds the parsed table and is freed with free() when the table may
+ * have changed.
+ *
+ * @hwpart:	Hardware partition the table was read from
+ * @lba:	Number of blocks of the device when the table was read
+ * @blksz:	Block size of the device when the table was read
+ * @first_lba:	First block which does not hold part of the table
+ * @last_lba:	Last block which does not hold part of the table
+ */
+struct part_cache {
+	int hwpart;
+	lbaint_t lba;
+	ulong blksz;
+	lbaint_t first_lba;
+	lbaint_t last_lba;
+};
+
+#if CONFIG_IS_ENABLED(PARTITION_CACHE)
+/**
+ * part_cache_get() - Get the cached partition table of a device
+ *
+ * A table read from another hardware partition, or before the device
+ * changed size, is dropped.
+ *
+ * @desc:	Block device descriptor
+ * @return cached table, or NULL if there is none
+ */
+struct part_cache *part_cache_get(struct blk_desc *desc);
+
+/**
+ * part_cache_set() - Keep a partition table read from a device
+ *
+ * @desc:	Block device descriptor
+ * @cache:	Table, allocated with malloc(). The caller sets up @first_lba
+ *		and @last_lba, the rest is filled in here
+ */
+void part_cache_set(struct blk_desc *desc, struct part_cache *cache);
+
+/**
+ * part_cache_invalidate() - Drop the cached partition table of a device
+ *
+ * @desc:	Block device descriptor
+ */
+void part_cache_invalidate(struct blk_desc *desc);
+#else
+static inline struct part_cache *part_cache_get(struct blk_desc *desc)
+{ return NULL; }
+static inline void part_cache_invalidate(struct blk_desc *desc) {}
+#endif
+
 /* Misc _get_dev functions */
 #ifdef CONFIG_PARTITIONS
 /**
@@ -273,6 +327,19 @@ struct part_driver {
 	int (*get_info)(struct blk_desc *dev_desc, int part,
 			disk_partition_t *info);
 
+	/**
+	 * find_name() - Find a partition by name (optional)
+	 *
+	 * Without this, part_get_info_by_name() calls get_info() for each
+	 * partition in turn.
+	 *
+	 * @dev_desc:	Block device descriptor
+	 * @name:	Partition name
+	 * @return partition number (1 = first), -ENOSYS to fall back to
+	 *	   get_info(), other -ve if not found
+	 */
+	int (*find_name)(struct blk_desc *dev_desc, const char *name);
+
 	/**
 	 * print() - Print partition information
 	 *
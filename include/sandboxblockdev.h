@@ -6,12 +6,19 @@
 #ifndef __SANDBOX_BLOCK_DEV__
 #define __SANDBOX_BLOCK_DEV__
 
+/* Number of asynchronous requests a host device accepts at once */
+#define HOST_BLK_QUEUE_DEPTH	4
+
 struct host_block_dev {
 #ifndef CONFIG_BLK
 	struct blk_desc blk_dev;
 #endif
 	char *filename;
 	int fd;
+#ifdef CONFIG_BLK
+	struct blk_req *req[HOST_BLK_QUEUE_DEPTH];
+	int nreqs;
+#endif
 };
 
 int host_dev_bind(int dev, char *filename);
@@ -315,6 +315,7 @@ struct sdhci_host {
 #if CONFIG_IS_ENABLED(MMC_SDHCI_ADMA)
 	struct sdhci_adma_desc *adma_desc_table;
 	uint desc_slot;
+	ulong data_start;	/* time an asynchronous transfer started */
 #endif
 };
 
@@ -38,8 +38,9 @@ typedef struct entry {
 	int flags;
 } ENTRY;
 
-/* Opaque type for internal use.  */
+/* Opaque types for internal use.  */
 struct _ENTRY;
+struct htab_arena;
 
 /*
  * Family of hash table handling functions.  The functions also
@@ -52,6 +53,8 @@ struct hsearch_data {
 	struct _ENTRY *table;
 	unsigned int size;
 	unsigned int filled;
+	unsigned int deleted;
+	struct htab_arena *arena;
 /*
  * Callback function which will check whether the given change for variable
  * "__item" to "newval" may be applied or not, and possibly apply such change.
@@ -63,7 +66,10 @@ struct hsearch_data {
 		int flag);
 };
 
-/* Create a new hash table which will contain at most "__nel" elements.  */
+/*
+ * Create a new hash table with room for "__nel" elements. The table grows
+ * automatically when more elements are entered.
+ */
 extern int hcreate_r(size_t __nel, struct hsearch_data *__htab);
 
 /* Destroy current internal hash table.  */
@@ -189,6 +189,23 @@ struct dm_serial_ops {
 	 * @return 0 if OK, -ve on error
 	 */
 	int (*putc)(struct udevice *dev, const char ch);
+	/**
+	 * puts() - Write several characters
+	 *
+	 * Write as many characters as the device can take without waiting,
+	 * e.g. as many as fit into the transmit FIFO. The uclass has already
+	 * turned each '\n' into "\r\n".
+	 *
+	 * This method is optional. Without it, putc() is called for each
+	 * character.
+	 *
+	 * @dev: Device pointer
+	 * @s: Characters to write
+	 * @len: Number of characters to write
+	 * @return number of characters written (at least 1), -EAGAIN if none
+	 *	can be written yet, other -ve on error
+	 */
+	ssize_t (*puts)(struct udevice *dev, const char *s, size_t len);
 	/**
 	 * pending() - Check if input/output characters are waiting
 	 *
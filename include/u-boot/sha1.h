@@ -101,6 +101,20 @@ void sha1_hmac(const unsigned char *key, int keylen,
  */
 int sha1_self_test( void );
 
+/**
+ * \brief	   Hash whole blocks with CPU instructions, provided by
+ *		   architecture code, e.g. for CONFIG_ARMV8_CE_SHA1
+ *
+ * \param state    SHA-1 state to update
+ * \param data     input data
+ * \param blocks   number of 64-byte blocks in data
+ *
+ * \return	   0 if the blocks were hashed, -ENOSYS if the CPU lacks
+ *		   support, in which case the generic code hashes them
+ */
+int sha1_process_arch(unsigned long state[5], const unsigned char *data,
+		      unsigned int blocks);
+
 #ifdef __cplusplus
 }
 #endif
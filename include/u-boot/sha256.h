@@ -22,4 +22,18 @@ void sha256_finish(sha256_context * ctx, uint8_t digest[SHA256_SUM_LEN]);
 void sha256_csum_wd(const unsigned char *input, unsigned int ilen,
 		unsigned char *output, unsigned int chunk_sz);
 
+/**
+ * sha256_process_arch() - Hash whole blocks with CPU instructions
+ *
+ * Provided by architecture code, e.g. for CONFIG_ARMV8_CE_SHA256.
+ *
+ * @state:	SHA-256 state to update
+ * @data:	input data
+ * @blocks:	number of 64-byte blocks in @data
+ * @return 0 if the blocks were hashed, -ENOSYS if the CPU lacks support, in
+ * which case the generic code hashes them
+ */
+int sha256_process_arch(uint32_t state[8], const uint8_t *data,
+			uint32_t blocks);
+
 #endif /* _SHA256_H */
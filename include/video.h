@@ -17,10 +17,21 @@
 
 #include <stdio_dev.h>
 
+/**
+ * struct video_uc_platdata - uclass platform data for a video device
+ *
+ * @align:	Frame-buffer alignment, set by the driver
+ * @size:	Frame-buffer size, set by the driver
+ * @base:	Hardware frame buffer, set up by the uclass unless the driver
+ *		sets it in its probe() method
+ * @shadow_base:	Frame buffer which is drawn into and copied to @base,
+ *		set up by the uclass with CONFIG_VIDEO_COPY
+ */
 struct video_uc_platdata {
 	uint align;
 	uint size;
 	ulong base;
+	ulong shadow_base;
 };
 
 enum video_polarity {
@@ -59,7 +70,10 @@ enum video_log2_bpp {
  * @vidconsole_drv_name:	Driver to use for the text console, NULL to
  *		select automatically
  * @font_size:	Font size in pixels (0 to use a default value)
- * @fb:		Frame buffer
+ * @fb:		Frame buffer which is drawn into
+ * @copy_fb:	Hardware frame buffer which the changed parts of @fb are
+ *		copied to by video_sync(), NULL if @fb is the hardware frame
+ *		buffer
  * @fb_size:	Frame buffer size
  * @line_length:	Length of each frame buffer line, in bytes. This can be
  *		set by the driver, but if not, the uclass will set it after
@@ -71,6 +85,8 @@ enum video_log2_bpp {
  * @cmap:	Colour map for 8-bit-per-pixel displays
  * @fg_col_idx:	Foreground color code (bit 3 = bold, bit 0-2 = color)
  * @bg_col_idx:	Background color code (bit 3 = bold, bit 0-2 = color)
+ * @damage:	Region of @fb, in pixels, which changed since the last
+ *		video_sync(). It is empty if @damage.xend is 0
  */
 struct video_priv {
 	/* Things set up by the driver: */
@@ -86,6 +102,7 @@ struct video_priv {
 	 * driver
 	 */
 	void *fb;
+	void *copy_fb;
 	int fb_size;
 	int line_length;
 	u32 colour_fg;
@@ -94,6 +111,12 @@ struct video_priv {
 	ushort *cmap;
 	u8 fg_col_idx;
 	u8 bg_col_idx;
+	struct {
+		int xstart;
+		int ystart;
+		int xend;
+		int yend;
+	} damage;
 };
 
 /* Placeholder - there are no video operations at present */
@@ -128,12 +151,29 @@ int video_reserve(ulong *addrp);
  */
 int video_clear(struct udevice *dev);
 
+/**
+ * video_damage() - Record that part of the frame buffer has changed
+ *
+ * Anything which draws into the frame buffer must call this, so that the
+ * region is included in the next video_sync(). The region is clipped to the
+ * display.
+ *
+ * @vid:	Video device
+ * @x:		X position of the region in pixels from the left
+ * @y:		Y position of the region in pixels from the top
+ * @width:	Width of the region in pixels
+ * @height:	Height of the region in pixels
+ */
+void video_damage(struct udevice *vid, int x, int y, int width, int height);
+
 /**
  * video_sync() - Sync a device's frame buffer with its hardware
  *
  * Some frame buffers are cached or have a secondary frame buffer. This
  * function syncs these up so that the current contents of the U-Boot frame
- * buffer are displayed to the user.
+ * buffer are displayed to the user. Only the region recorded with
+ * video_damage() since the last sync is copied or flushed, unless @force is
+ * true or no region was recorded, when the whole frame buffer is.
  *
  * @dev:	Device to sync
  * @force:	True to force a sync even if there was one recently (this is
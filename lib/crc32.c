@@ -29,6 +29,14 @@
 
 #define tole(x) cpu_to_le32(x)
 
+#if defined(CONFIG_CRC32_ARM64) && !defined(CONFIG_SPL_BUILD)
+#define CRC32_ARM64
+#elif defined(USE_HOSTCC) || \
+	(defined(CONFIG_CRC32_SLICE_BY_8) && !defined(CONFIG_SPL_BUILD))
+#define CRC32_SLICE_BY_8
+#endif
+
+#if !defined(CRC32_ARM64) && !defined(CRC32_SLICE_BY_8)
 #ifdef CONFIG_DYNAMIC_CRC_TABLE
 
 static int __efi_runtime_data crc_table_empty = 1;
@@ -154,6 +162,7 @@ tole(0xb3667a2eL), tole(0xc4614ab8L), tole(0x5d681b02L), tole(0x2a6f2b94L),
 tole(0xb40bbe37L), tole(0xc30c8ea1L), tole(0x5a05df1bL), tole(0x2d02ef8dL)
 };
 #endif
+#endif /* !CRC32_ARM64 && !CRC32_SLICE_BY_8 */
 
 #if 0
 /* =========================================================================
@@ -168,6 +177,97 @@ const uint32_t * ZEXPORT get_crc_table()
 }
 #endif
 
+#ifdef CRC32_ARM64
+/*
+ * The ARMv8 CRC32 instructions implement the same (reflected) polynomial as
+ * crc_table, taking the crc and the data in the native byte order.
+ */
+#define ARM64_CRC32(insn, reg, crc, val)			\
+	asm(".arch_extension crc\n\t"				\
+	    insn " %w0, %w0, %" reg "1" : "+r" (crc) : "r" (val))
+
+static uint32_t __efi_runtime crc32_arm64(uint32_t crc, const uint8_t *p,
+					  uInt len)
+{
+	while (len && ((uintptr_t)p & 7)) {
+		ARM64_CRC32("crc32b", "w", crc, *p++);
+		len--;
+	}
+	for (; len >= 8; len -= 8, p += 8)
+		ARM64_CRC32("crc32x", "x", crc, le64_to_cpu(*(uint64_t *)p));
+	if (len & 4) {
+		ARM64_CRC32("crc32w", "w", crc, le32_to_cpu(*(uint32_t *)p));
+		p += 4;
+	}
+	if (len & 2) {
+		ARM64_CRC32("crc32h", "w", crc, le16_to_cpu(*(uint16_t *)p));
+		p += 2;
+	}
+	if (len & 1)
+		ARM64_CRC32("crc32b", "w", crc, *p);
+
+	return crc;
+}
+#endif
+
+#ifdef CRC32_SLICE_BY_8
+/*
+ * Slice-by-8 tables in native byte order, replacing crc_table: crc_slice[k][n]
+ * is the crc of byte n followed by k zero bytes, so that eight bytes can be
+ * folded into the crc with eight independent lookups.
+ */
+static int __efi_runtime_data crc_slice_empty = 1;
+static uint32_t __efi_runtime_data crc_slice[8][256];
+
+static void __efi_runtime make_crc_slice(void)
+{
+	uint32_t c;
+	int n, k;
+
+	for (n = 0; n < 256; n++) {
+		c = n;
+		for (k = 0; k < 8; k++)
+			c = c & 1 ? 0xedb88320 ^ (c >> 1) : c >> 1;
+		crc_slice[0][n] = c;
+	}
+	for (n = 0; n < 256; n++) {
+		c = crc_slice[0][n];
+		for (k = 1; k < 8; k++) {
+			c = crc_slice[0][c & 255] ^ (c >> 8);
+			crc_slice[k][n] = c;
+		}
+	}
+	crc_slice_empty = 0;
+}
+
+static uint32_t __efi_runtime crc32_slice8(uint32_t crc, const uint8_t *p,
+					   uInt len)
+{
+	const uint32_t (*t)[256] = (const uint32_t (*)[256])crc_slice;
+	uint32_t lo, hi;
+
+	if (crc_slice_empty)
+		make_crc_slice();
+
+	while (len && ((uintptr_t)p & 3)) {
+		crc = t[0][(crc ^ *p++) & 255] ^ (crc >> 8);
+		len--;
+	}
+	for (; len >= 8; len -= 8, p += 8) {
+		lo = le32_to_cpu(*(const uint32_t *)p) ^ crc;
+		hi = le32_to_cpu(*(const uint32_t *)(p + 4));
+		crc = t[7][lo & 255] ^ t[6][(lo >> 8) & 255] ^
+		      t[5][(lo >> 16) & 255] ^ t[4][lo >> 24] ^
+		      t[3][hi & 255] ^ t[2][(hi >> 8) & 255] ^
+		      t[1][(hi >> 16) & 255] ^ t[0][hi >> 24];
+	}
+	while (len--)
+		crc = t[0][(crc ^ *p++) & 255] ^ (crc >> 8);
+
+	return crc;
+}
+#endif
+
 /* ========================================================================= */
 # if __BYTE_ORDER == __LITTLE_ENDIAN
 #  define DO_CRC(x) crc = tab[(crc ^ (x)) & 255] ^ (crc >> 8)
@@ -182,6 +282,11 @@ const uint32_t * ZEXPORT get_crc_table()
  */
 uint32_t __efi_runtime crc32_no_comp(uint32_t crc, const Bytef *buf, uInt len)
 {
+#if defined(CRC32_ARM64)
+    return crc32_arm64(crc, buf, len);
+#elif defined(CRC32_SLICE_BY_8)
+    return crc32_slice8(crc, buf, len);
+#else
     const uint32_t *tab = crc_table;
     const uint32_t *b =(const uint32_t *)buf;
     size_t rem_len;
@@ -219,6 +324,7 @@ uint32_t __efi_runtime crc32_no_comp(uint32_t crc, const Bytef *buf, uInt len)
     }
 
     return le32_to_cpu(crc);
+#endif
 }
 #undef DO_CRC
 
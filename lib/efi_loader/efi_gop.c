@@ -25,6 +25,7 @@ static const efi_guid_t efi_gop_guid = EFI_GRAPHICS_OUTPUT_PROTOCOL_GUID;
  * @mode:	graphical output mode
  * @bpix:	bits per pixel
  * @fb:		frame buffer
+ * @vdev:	video device
  */
 struct efi_gop_obj {
 	struct efi_object header;
@@ -34,6 +35,9 @@ struct efi_gop_obj {
 	/* Fields we only have access to during init */
 	u32 bpix;
 	void *fb;
+#ifdef CONFIG_DM_VIDEO
+	struct udevice *vdev;
+#endif
 };
 
 static efi_status_t EFIAPI gop_query_mode(struct efi_gop *this, u32 mode_number,
@@ -374,6 +378,13 @@ efi_status_t EFIAPI gop_blt(struct efi_gop *this, struct efi_gop_pixel *buffer,
 		return EFI_EXIT(ret);
 
 #ifdef CONFIG_DM_VIDEO
+	if (operation != EFI_BLT_VIDEO_TO_BLT_BUFFER) {
+		struct efi_gop_obj *gopobj = container_of(this,
+							  struct efi_gop_obj,
+							  ops);
+
+		video_damage(gopobj->vdev, dx, dy, width, height);
+	}
 	video_sync_all();
 #else
 	lcd_sync();
@@ -410,7 +421,8 @@ efi_status_t efi_gop_register(void)
 	bpix = priv->bpix;
 	col = video_get_xsize(vdev);
 	row = video_get_ysize(vdev);
-	fb_base = (uintptr_t)priv->fb;
+	/* Direct access by the application goes to the hardware */
+	fb_base = (uintptr_t)(priv->copy_fb ? priv->copy_fb : priv->fb);
 	fb_size = priv->fb_size;
 	fb = priv->fb;
 #else
@@ -486,6 +498,9 @@ efi_status_t efi_gop_register(void)
 
 	gopobj->bpix = bpix;
 	gopobj->fb = fb;
+#ifdef CONFIG_DM_VIDEO
+	gopobj->vdev = vdev;
+#endif
 
 	return EFI_SUCCESS;
 }
@@ -10,7 +10,7 @@
 #include <malloc.h>
 #include <mapmem.h>
 #include <watchdog.h>
-#include <linux/list_sort.h>
+#include <linux/rbtree_augmented.h>
 #include <linux/sizes.h>
 
 DECLARE_GLOBAL_DATA_PTR;
@@ -18,19 +18,39 @@ DECLARE_GLOBAL_DATA_PTR;
 /* Magic number identifying memory allocated from pool */
 #define EFI_ALLOC_POOL_MAGIC 0x1fe67ddf6491caa2
 
+/* Magic number identifying a page which is split into pool allocations */
+#define EFI_POOL_PAGE_MAGIC 0x5c2b81f3d4a06e97
+
+/*
+ * Small pool allocations are served from pages which are split into slots
+ * of one size. Slot sizes are powers of two from EFI_POOL_MIN_SIZE up to
+ * EFI_POOL_MAX_SIZE, including the allocation header.
+ */
+#define EFI_POOL_MIN_SIZE	64
+#define EFI_POOL_CLASSES	5
+#define EFI_POOL_MAX_SIZE	(EFI_POOL_MIN_SIZE << (EFI_POOL_CLASSES - 1))
+
 efi_uintn_t efi_memory_map_key;
 
+/**
+ * struct efi_mem_list - memory map entry
+ *
+ * @rb:		node in the tree of memory map entries, sorted by address
+ * @desc:	memory descriptor
+ * @free_pages:	largest number of free pages in one entry of the subtree
+ *		below and including this node
+ */
 struct efi_mem_list {
-	struct list_head link;
+	struct rb_node rb;
 	struct efi_mem_desc desc;
+	u64 free_pages;
 };
 
-#define EFI_CARVE_NO_OVERLAP		-1
-#define EFI_CARVE_LOOP_AGAIN		-2
-#define EFI_CARVE_OVERLAPS_NONRAM	-3
+/* This tree contains all memory map items, which never overlap */
+static struct rb_root efi_mem = RB_ROOT;
 
-/* This list contains all memory map items */
-LIST_HEAD(efi_mem);
+/* Number of entries in efi_mem */
+static efi_uintn_t efi_mem_count;
 
 #ifdef CONFIG_EFI_LOADER_BOUNCE_BUFFER
 void *efi_bounce_buffer;
@@ -39,12 +59,12 @@ void *efi_bounce_buffer;
 /**
  * efi_pool_allocation - memory block allocated from pool
  *
- * @num_pages:	number of pages allocated
+ * @num_pages:	number of pages allocated, 0 for a slot of a pool page
  * @checksum:	checksum
  *
- * U-Boot services each EFI AllocatePool request as a separate
- * (multiple) page allocation.  We have to track the number of pages
- * to be able to free the correct amount later.
+ * U-Boot services each EFI AllocatePool request which does not fit into
+ * a pool page slot as a separate (multiple) page allocation.  We have to
+ * track the number of pages to be able to free the correct amount later.
  * EFI requires 8 byte alignment for pool allocations, so we can
  * prepend each allocation with an 64 bit header tracking the
  * allocation size, and hand out the remainder to the caller.
@@ -55,6 +75,30 @@ struct efi_pool_allocation {
 	char data[] __aligned(ARCH_DMA_MINALIGN);
 };
 
+/**
+ * struct efi_pool_page - page split into pool allocations of one size
+ *
+ * The header lives in the first slot(s) of the page.
+ *
+ * @link:	entry in efi_pool_pages while the page has a free slot
+ * @checksum:	checksum identifying a pool page
+ * @free:	first free slot, the next one is stored at the start of it
+ * @type:	memory type of the page
+ * @slot_size:	size of each slot
+ * @used:	number of slots handed out
+ */
+struct efi_pool_page {
+	struct list_head link;
+	u64 checksum;
+	void *free;
+	u32 type;
+	u16 slot_size;
+	u16 used;
+};
+
+/* Pool pages with free slots, one list for each slot size */
+static struct list_head efi_pool_pages[EFI_POOL_CLASSES];
+
 /**
  * checksum() - calculate checksum for memory allocated from pool
  *
@@ -71,24 +115,21 @@ static u64 checksum(struct efi_pool_allocation *alloc)
 	return ret;
 }
 
-/*
- * Sorts the memory list from highest address to lowest address
+/**
+ * pool_page_checksum() - calculate checksum for a pool page
  *
- * When allocating memory we should always start from the highest
- * address chunk, so sort the memory list such that the first list
- * iterator gets the highest address and goes lower from there.
+ * @page:	pool page header
+ * Return:	checksum, always non-zero
  */
-static int efi_mem_cmp(void *priv, struct list_head *a, struct list_head *b)
+static u64 pool_page_checksum(struct efi_pool_page *page)
 {
-	struct efi_mem_list *mema = list_entry(a, struct efi_mem_list, link);
-	struct efi_mem_list *memb = list_entry(b, struct efi_mem_list, link);
+	u64 addr = (uintptr_t)page;
+	u64 ret = (addr >> 32) ^ (addr << 32) ^ page->type ^
+		  ((u64)page->slot_size << 32) ^ EFI_POOL_PAGE_MAGIC;
 
-	if (mema->desc.physical_start == memb->desc.physical_start)
-		return 0;
-	else if (mema->desc.physical_start < memb->desc.physical_start)
-		return 1;
-	else
-		return -1;
+	if (!ret)
+		++ret;
+	return ret;
 }
 
 static uint64_t desc_get_end(struct efi_mem_desc *desc)
@@ -96,139 +137,209 @@ static uint64_t desc_get_end(struct efi_mem_desc *desc)
 	return desc->physical_start + (desc->num_pages << EFI_PAGE_SHIFT);
 }
 
-static void efi_mem_sort(void)
+/* Calculate the free pages of a subtree of the memory map */
+static u64 efi_mem_compute_free(struct efi_mem_list *mem)
 {
-	struct list_head *lhandle;
-	struct efi_mem_list *prevmem = NULL;
-	bool merge_again = true;
-
-	list_sort(NULL, &efi_mem, efi_mem_cmp);
-
-	/* Now merge entries that can be merged */
-	while (merge_again) {
-		merge_again = false;
-		list_for_each(lhandle, &efi_mem) {
-			struct efi_mem_list *lmem;
-			struct efi_mem_desc *prev = &prevmem->desc;
-			struct efi_mem_desc *cur;
-			uint64_t pages;
-
-			lmem = list_entry(lhandle, struct efi_mem_list, link);
-			if (!prevmem) {
-				prevmem = lmem;
-				continue;
-			}
-
-			cur = &lmem->desc;
-
-			if ((desc_get_end(cur) == prev->physical_start) &&
-			    (prev->type == cur->type) &&
-			    (prev->attribute == cur->attribute)) {
-				/* There is an existing map before, reuse it */
-				pages = cur->num_pages;
-				prev->num_pages += pages;
-				prev->physical_start -= pages << EFI_PAGE_SHIFT;
-				prev->virtual_start -= pages << EFI_PAGE_SHIFT;
-				list_del(&lmem->link);
-				free(lmem);
-
-				merge_again = true;
-				break;
-			}
-
-			prevmem = lmem;
-		}
+	u64 free_pages = 0;
+	struct efi_mem_list *child;
+
+	if (mem->desc.type == EFI_CONVENTIONAL_MEMORY)
+		free_pages = mem->desc.num_pages;
+	if (mem->rb.rb_left) {
+		child = rb_entry(mem->rb.rb_left, struct efi_mem_list, rb);
+		free_pages = max(free_pages, child->free_pages);
 	}
+	if (mem->rb.rb_right) {
+		child = rb_entry(mem->rb.rb_right, struct efi_mem_list, rb);
+		free_pages = max(free_pages, child->free_pages);
+	}
+
+	return free_pages;
 }
 
-/** efi_mem_carve_out - unmap memory region
- *
- * @map:		memory map
- * @carve_desc:		memory region to unmap
- * @overlap_only_ram:	the carved out region may only overlap RAM
- * Return Value:	the number of overlapping pages which have been
- *			removed from the map,
- *			EFI_CARVE_NO_OVERLAP, if the regions don't overlap,
- *			EFI_CARVE_OVERLAPS_NONRAM, if the carve and map overlap,
- *			and the map contains anything but free ram
- *			(only when overlap_only_ram is true),
- *			EFI_CARVE_LOOP_AGAIN, if the mapping list should be
- *			traversed again, as it has been altered.
+RB_DECLARE_CALLBACKS(static, efi_mem_callbacks, struct efi_mem_list, rb,
+		     u64, free_pages, efi_mem_compute_free)
+
+static struct efi_mem_list *efi_mem_next(struct efi_mem_list *mem)
+{
+	struct rb_node *rb = rb_next(&mem->rb);
+
+	return rb ? rb_entry(rb, struct efi_mem_list, rb) : NULL;
+}
+
+/**
+ * efi_mem_lookup() - find the first memory map entry ending above an address
  *
- * Unmaps all memory occupied by the carve_desc region from the list entry
- * pointed to by map.
+ * As entries do not overlap, this is the entry containing @addr, if any.
  *
- * In case of EFI_CARVE_OVERLAPS_NONRAM it is the callers responsibility
- * to re-add the already carved out pages to the mapping.
+ * @addr:	address
+ * Return:	memory map entry, or NULL if all entries end at or below @addr
  */
-static s64 efi_mem_carve_out(struct efi_mem_list *map,
-			     struct efi_mem_desc *carve_desc,
-			     bool overlap_only_ram)
+static struct efi_mem_list *efi_mem_lookup(u64 addr)
 {
-	struct efi_mem_list *newmap;
-	struct efi_mem_desc *map_desc = &map->desc;
-	uint64_t map_start = map_desc->physical_start;
-	uint64_t map_end = map_start + (map_desc->num_pages << EFI_PAGE_SHIFT);
-	uint64_t carve_start = carve_desc->physical_start;
-	uint64_t carve_end = carve_start +
-			     (carve_desc->num_pages << EFI_PAGE_SHIFT);
-
-	/* check whether we're overlapping */
-	if ((carve_end <= map_start) || (carve_start >= map_end))
-		return EFI_CARVE_NO_OVERLAP;
-
-	/* We're overlapping with non-RAM, warn the caller if desired */
-	if (overlap_only_ram && (map_desc->type != EFI_CONVENTIONAL_MEMORY))
-		return EFI_CARVE_OVERLAPS_NONRAM;
-
-	/* Sanitize carve_start and carve_end to lie within our bounds */
-	carve_start = max(carve_start, map_start);
-	carve_end = min(carve_end, map_end);
-
-	/* Carving at the beginning of our map? Just move it! */
-	if (carve_start == map_start) {
-		if (map_end == carve_end) {
-			/* Full overlap, just remove map */
-			list_del(&map->link);
-			free(map);
+	struct rb_node *rb = efi_mem.rb_node;
+	struct efi_mem_list *mem, *found = NULL;
+
+	while (rb) {
+		mem = rb_entry(rb, struct efi_mem_list, rb);
+		if (desc_get_end(&mem->desc) > addr) {
+			found = mem;
+			rb = rb->rb_left;
 		} else {
-			map->desc.physical_start = carve_end;
-			map->desc.virtual_start = carve_end;
-			map->desc.num_pages = (map_end - carve_end)
-					      >> EFI_PAGE_SHIFT;
+			rb = rb->rb_right;
 		}
+	}
+
+	return found;
+}
 
-		return (carve_end - carve_start) >> EFI_PAGE_SHIFT;
+/* Add an entry which does not overlap any other to the memory map */
+static void efi_mem_insert(struct efi_mem_list *new)
+{
+	struct rb_node **link = &efi_mem.rb_node, *parent = NULL;
+	struct efi_mem_list *mem;
+
+	new->free_pages = new->desc.type == EFI_CONVENTIONAL_MEMORY ?
+			  new->desc.num_pages : 0;
+	while (*link) {
+		parent = *link;
+		mem = rb_entry(parent, struct efi_mem_list, rb);
+		if (mem->free_pages < new->free_pages)
+			mem->free_pages = new->free_pages;
+		if (new->desc.physical_start < mem->desc.physical_start)
+			link = &parent->rb_left;
+		else
+			link = &parent->rb_right;
 	}
+	rb_link_node(&new->rb, parent, link);
+	rb_insert_augmented(&new->rb, &efi_mem, &efi_mem_callbacks);
+	efi_mem_count++;
+}
 
-	/*
-	 * Overlapping maps, just split the list map at carve_start,
-	 * it will get moved or removed in the next iteration.
-	 *
-	 * [ map_desc |__carve_start__| newmap ]
-	 */
+static void efi_mem_erase(struct efi_mem_list *mem)
+{
+	rb_erase_augmented(&mem->rb, &efi_mem, &efi_mem_callbacks);
+	efi_mem_count--;
+	free(mem);
+}
+
+/* Update the tree after the size or type of an entry has changed */
+static void efi_mem_update(struct efi_mem_list *mem)
+{
+	efi_mem_callbacks_propagate(&mem->rb, NULL);
+}
 
-	/* Create a new map from [ carve_start ... map_end ] */
-	newmap = calloc(1, sizeof(*newmap));
-	newmap->desc = map->desc;
-	newmap->desc.physical_start = carve_start;
-	newmap->desc.virtual_start = carve_start;
-	newmap->desc.num_pages = (map_end - carve_start) >> EFI_PAGE_SHIFT;
-	/* Insert before current entry (descending address order) */
-	list_add_tail(&newmap->link, &map->link);
+/**
+ * efi_mem_carve_out() - unmap memory region
+ *
+ * Removes the range from all memory map entries which it overlaps, trimming
+ * or splitting entries which overlap it partially.
+ *
+ * @start:	start of the range to unmap
+ * @end:	end of the range to unmap
+ * Return:	0 if OK, -ENOMEM if an entry could not be split
+ */
+static int efi_mem_carve_out(u64 start, u64 end)
+{
+	struct efi_mem_list *mem, *next, *newmem;
+	u64 map_start, map_end;
+
+	for (mem = efi_mem_lookup(start);
+	     mem && mem->desc.physical_start < end; mem = next) {
+		next = efi_mem_next(mem);
+		map_start = mem->desc.physical_start;
+		map_end = desc_get_end(&mem->desc);
+
+		if (map_start < start && map_end > end) {
+			/*
+			 * The range lies within this entry, split it:
+			 * [ mem | carved | newmem ]
+			 */
+			newmem = calloc(1, sizeof(*newmem));
+			if (!newmem)
+				return -ENOMEM;
+			newmem->desc = mem->desc;
+			newmem->desc.physical_start = end;
+			newmem->desc.virtual_start = end;
+			newmem->desc.num_pages = (map_end - end) >>
+						 EFI_PAGE_SHIFT;
+			mem->desc.num_pages = (start - map_start) >>
+					      EFI_PAGE_SHIFT;
+			efi_mem_update(mem);
+			efi_mem_insert(newmem);
+			break;
+		} else if (map_start < start) {
+			/* Keep the part below the range */
+			mem->desc.num_pages = (start - map_start) >>
+					      EFI_PAGE_SHIFT;
+			efi_mem_update(mem);
+		} else if (map_end > end) {
+			/* Keep the part above the range */
+			mem->desc.physical_start = end;
+			mem->desc.virtual_start = end;
+			mem->desc.num_pages = (map_end - end) >> EFI_PAGE_SHIFT;
+			efi_mem_update(mem);
+		} else {
+			/* Full overlap, just remove the entry */
+			efi_mem_erase(mem);
+		}
+	}
 
-	/* Shrink the map to [ map_start ... carve_start ] */
-	map_desc->num_pages = (carve_start - map_start) >> EFI_PAGE_SHIFT;
+	return 0;
+}
 
-	return EFI_CARVE_LOOP_AGAIN;
+/* Check whether two adjacent memory map entries can be merged */
+static bool efi_mem_can_merge(struct efi_mem_desc *lower,
+			      struct efi_mem_desc *upper)
+{
+	return desc_get_end(lower) == upper->physical_start &&
+	       lower->type == upper->type &&
+	       lower->attribute == upper->attribute;
+}
+
+/**
+ * efi_mem_add() - add an entry to the memory map, merging it with neighbours
+ *
+ * The range of the entry must not be mapped.
+ *
+ * @new:	new entry
+ */
+static void efi_mem_add(struct efi_mem_list *new)
+{
+	struct efi_mem_list *prev = NULL, *next;
+	u64 start = new->desc.physical_start;
+
+	if (start)
+		prev = efi_mem_lookup(start - 1);
+	if (prev && desc_get_end(&prev->desc) > start)
+		prev = NULL;
+	next = efi_mem_lookup(start);
+
+	if (next && efi_mem_can_merge(&new->desc, &next->desc)) {
+		/* There is an existing map above, extend it downwards */
+		next->desc.physical_start = start;
+		next->desc.virtual_start = start;
+		next->desc.num_pages += new->desc.num_pages;
+		free(new);
+		new = next;
+		efi_mem_update(new);
+	} else {
+		efi_mem_insert(new);
+	}
+
+	if (prev && efi_mem_can_merge(&prev->desc, &new->desc)) {
+		/* There is an existing map below, swallow it */
+		prev->desc.num_pages += new->desc.num_pages;
+		efi_mem_erase(new);
+		efi_mem_update(prev);
+	}
 }
 
 uint64_t efi_add_memory_map(uint64_t start, uint64_t pages, int memory_type,
 			    bool overlap_only_ram)
 {
-	struct list_head *lhandle;
-	struct efi_mem_list *newlist;
-	bool carve_again;
+	struct efi_mem_list *newlist, *mem;
+	uint64_t end = start + (pages << EFI_PAGE_SHIFT);
 	uint64_t carved_pages = 0;
 
 	EFI_PRINT("%s: 0x%llx 0x%llx %d %s\n", __func__,
@@ -240,8 +351,32 @@ uint64_t efi_add_memory_map(uint64_t start, uint64_t pages, int memory_type,
 	if (!pages)
 		return start;
 
+	if (overlap_only_ram) {
+		for (mem = efi_mem_lookup(start);
+		     mem && mem->desc.physical_start < end;
+		     mem = efi_mem_next(mem)) {
+			/*
+			 * The user requested to only have RAM overlaps,
+			 * but we hit a non-RAM region. Error out.
+			 */
+			if (mem->desc.type != EFI_CONVENTIONAL_MEMORY)
+				return 0;
+			carved_pages += (min(end, desc_get_end(&mem->desc)) -
+					 max(start, mem->desc.physical_start))
+					>> EFI_PAGE_SHIFT;
+		}
+		/*
+		 * The payload wanted to have RAM overlaps, but we overlapped
+		 * with an unallocated region. Error out.
+		 */
+		if (carved_pages != pages)
+			return 0;
+	}
+
 	++efi_memory_map_key;
 	newlist = calloc(1, sizeof(*newlist));
+	if (!newlist)
+		return 0;
 	newlist->desc.type = memory_type;
 	newlist->desc.physical_start = start;
 	newlist->desc.virtual_start = start;
@@ -260,60 +395,12 @@ uint64_t efi_add_memory_map(uint64_t start, uint64_t pages, int memory_type,
 		break;
 	}
 
-	/* Add our new map */
-	do {
-		carve_again = false;
-		list_for_each(lhandle, &efi_mem) {
-			struct efi_mem_list *lmem;
-			s64 r;
-
-			lmem = list_entry(lhandle, struct efi_mem_list, link);
-			r = efi_mem_carve_out(lmem, &newlist->desc,
-					      overlap_only_ram);
-			switch (r) {
-			case EFI_CARVE_OVERLAPS_NONRAM:
-				/*
-				 * The user requested to only have RAM overlaps,
-				 * but we hit a non-RAM region. Error out.
-				 */
-				return 0;
-			case EFI_CARVE_NO_OVERLAP:
-				/* Just ignore this list entry */
-				break;
-			case EFI_CARVE_LOOP_AGAIN:
-				/*
-				 * We split an entry, but need to loop through
-				 * the list again to actually carve it.
-				 */
-				carve_again = true;
-				break;
-			default:
-				/* We carved a number of pages */
-				carved_pages += r;
-				carve_again = true;
-				break;
-			}
-
-			if (carve_again) {
-				/* The list changed, we need to start over */
-				break;
-			}
-		}
-	} while (carve_again);
-
-	if (overlap_only_ram && (carved_pages != pages)) {
-		/*
-		 * The payload wanted to have RAM overlaps, but we overlapped
-		 * with an unallocated region. Error out.
-		 */
+	/* Remove whatever was mapped there and add our new map */
+	if (efi_mem_carve_out(start, end)) {
+		free(newlist);
 		return 0;
 	}
-
-	/* Add our new map */
-        list_add_tail(&newlist->link, &efi_mem);
-
-	/* And make sure memory is listed in descending order */
-	efi_mem_sort();
+	efi_mem_add(newlist);
 
 	return start;
 }
@@ -340,62 +427,74 @@ static efi_status_t efi_check_allocated(u64 addr, bool must_be_allocated)
 
 	if (!addr)
 		return EFI_INVALID_PARAMETER;
-	list_for_each_entry(item, &efi_mem, link) {
-		u64 start = item->desc.physical_start;
-		u64 end = start + (item->desc.num_pages << EFI_PAGE_SHIFT);
-
-		if (addr >= start && addr < end) {
-			if (must_be_allocated ^
-			    (item->desc.type == EFI_CONVENTIONAL_MEMORY))
-				return EFI_SUCCESS;
-			else
-				return EFI_NOT_FOUND;
-		}
+	item = efi_mem_lookup(addr);
+	if (item && addr >= item->desc.physical_start) {
+		if (must_be_allocated ^
+		    (item->desc.type == EFI_CONVENTIONAL_MEMORY))
+			return EFI_SUCCESS;
+		else
+			return EFI_NOT_FOUND;
 	}
 
 	return EFI_NOT_FOUND;
 }
 
-static uint64_t efi_find_free_memory(uint64_t len, uint64_t max_addr)
+/**
+ * efi_find_free_in() - find free memory in a subtree of the memory map
+ *
+ * Subtrees without a large enough free entry are skipped, and higher
+ * addresses are tried first.
+ *
+ * @rb:		root of the subtree
+ * @len:	number of bytes needed
+ * @max_addr:	page aligned address which the memory must end below
+ * Return:	highest suitable address, 0 if there is none
+ */
+static uint64_t efi_find_free_in(struct rb_node *rb, uint64_t len,
+				 uint64_t max_addr)
 {
-	struct list_head *lhandle;
+	struct efi_mem_list *mem;
+	struct efi_mem_desc *desc;
+	uint64_t curmax, ret;
+
+	while (rb) {
+		mem = rb_entry(rb, struct efi_mem_list, rb);
+		desc = &mem->desc;
+		if ((mem->free_pages << EFI_PAGE_SHIFT) < len)
+			return 0;
+
+		/* Entries from here upwards all start above max_addr */
+		if (desc->physical_start >= max_addr) {
+			rb = rb->rb_left;
+			continue;
+		}
+
+		ret = efi_find_free_in(rb->rb_right, len, max_addr);
+		if (ret)
+			return ret;
 
+		/* We only take memory from free RAM */
+		if (desc->type == EFI_CONVENTIONAL_MEMORY) {
+			curmax = min(max_addr, desc_get_end(desc));
+			/* Return the highest address within bounds */
+			if (curmax - desc->physical_start >= len)
+				return curmax - len;
+		}
+		rb = rb->rb_left;
+	}
+
+	return 0;
+}
+
+static uint64_t efi_find_free_memory(uint64_t len, uint64_t max_addr)
+{
 	/*
 	 * Prealign input max address, so we simplify our matching
 	 * logic below and can just reuse it as return pointer.
 	 */
 	max_addr &= ~EFI_PAGE_MASK;
 
-	list_for_each(lhandle, &efi_mem) {
-		struct efi_mem_list *lmem = list_entry(lhandle,
-			struct efi_mem_list, link);
-		struct efi_mem_desc *desc = &lmem->desc;
-		uint64_t desc_len = desc->num_pages << EFI_PAGE_SHIFT;
-		uint64_t desc_end = desc->physical_start + desc_len;
-		uint64_t curmax = min(max_addr, desc_end);
-		uint64_t ret = curmax - len;
-
-		/* We only take memory from free RAM */
-		if (desc->type != EFI_CONVENTIONAL_MEMORY)
-			continue;
-
-		/* Out of bounds for max_addr */
-		if ((ret + len) > max_addr)
-			continue;
-
-		/* Out of bounds for upper map limit */
-		if ((ret + len) > desc_end)
-			continue;
-
-		/* Out of bounds for lower map limit */
-		if (ret < desc->physical_start)
-			continue;
-
-		/* Return the highest address in this map within bounds */
-		return ret;
-	}
-
-	return 0;
+	return efi_find_free_in(efi_mem.rb_node, len, max_addr);
 }
 
 /*
@@ -494,7 +593,6 @@ efi_status_t efi_free_pages(uint64_t memory, efi_uintn_t pages)
 	}
 
 	r = efi_add_memory_map(memory, pages, EFI_CONVENTIONAL_MEMORY, false);
-	/* Merging of adjacent free regions is missing */
 
 	if (r == memory)
 		return EFI_SUCCESS;
@@ -502,9 +600,148 @@ efi_status_t efi_free_pages(uint64_t memory, efi_uintn_t pages)
 	return EFI_NOT_FOUND;
 }
 
+/**
+ * efi_pool_class() - get the slot size class for a pool allocation
+ *
+ * @size:	number of bytes requested
+ * Return:	index into efi_pool_pages, -1 if the allocation does not fit
+ *		into a slot
+ */
+static int efi_pool_class(efi_uintn_t size)
+{
+	size_t slot_size = EFI_POOL_MIN_SIZE;
+	int class;
+
+	if (size > EFI_POOL_MAX_SIZE - sizeof(struct efi_pool_allocation))
+		return -1;
+	size += sizeof(struct efi_pool_allocation);
+	for (class = 0; slot_size < size; class++)
+		slot_size <<= 1;
+
+	return class;
+}
+
+/**
+ * efi_pool_page_alloc() - set up a new page split into pool slots
+ *
+ * @pool_type:	memory type of the page
+ * @class:	slot size class
+ * Return:	pool page, or NULL if out of memory
+ */
+static struct efi_pool_page *efi_pool_page_alloc(int pool_type, int class)
+{
+	struct efi_pool_page *page;
+	size_t slot_size = EFI_POOL_MIN_SIZE << class;
+	size_t offset;
+	void **next;
+	u64 addr;
+
+	if (efi_allocate_pages(EFI_ALLOCATE_ANY_PAGES, pool_type, 1,
+			       &addr) != EFI_SUCCESS)
+		return NULL;
+
+	page = (struct efi_pool_page *)(uintptr_t)addr;
+	page->type = pool_type;
+	page->slot_size = slot_size;
+	page->used = 0;
+	page->checksum = pool_page_checksum(page);
+
+	/* Chain up all slots after the header */
+	next = &page->free;
+	for (offset = roundup(sizeof(*page), slot_size);
+	     offset < EFI_PAGE_SIZE; offset += slot_size) {
+		*next = (void *)page + offset;
+		next = *next;
+	}
+	*next = NULL;
+	list_add(&page->link, &efi_pool_pages[class]);
+
+	return page;
+}
+
+/**
+ * efi_pool_slot_alloc() - allocate a slot from a pool page
+ *
+ * @pool_type:	type of the pool from which memory is to be allocated
+ * @class:	slot size class
+ * Return:	allocation header, or NULL if out of memory
+ */
+static struct efi_pool_allocation *efi_pool_slot_alloc(int pool_type,
+							int class)
+{
+	struct efi_pool_allocation *alloc;
+	struct efi_pool_page *page;
+
+	list_for_each_entry(page, &efi_pool_pages[class], link) {
+		if (page->type == pool_type)
+			goto found;
+	}
+	page = efi_pool_page_alloc(pool_type, class);
+	if (!page)
+		return NULL;
+found:
+	alloc = page->free;
+	page->free = *(void **)alloc;
+	page->used++;
+	/* Full pages are taken off the list until a slot is freed */
+	if (!page->free)
+		list_del(&page->link);
+
+	alloc->num_pages = 0;
+	alloc->checksum = checksum(alloc);
+
+	return alloc;
+}
+
+/**
+ * efi_pool_slot_free() - return a slot to its pool page
+ *
+ * The page is freed once none of its slots is in use.
+ *
+ * @alloc:	allocation header, which must not be page aligned
+ * Return:	status code
+ */
+static efi_status_t efi_pool_slot_free(struct efi_pool_allocation *alloc)
+{
+	struct efi_pool_page *page;
+	size_t offset;
+	bool was_full;
+	int class;
+
+	page = (struct efi_pool_page *)((uintptr_t)alloc & ~EFI_PAGE_MASK);
+	offset = (uintptr_t)alloc & EFI_PAGE_MASK;
+	if (page->checksum != pool_page_checksum(page) ||
+	    offset % page->slot_size || offset < sizeof(*page) ||
+	    alloc->num_pages || alloc->checksum != checksum(alloc))
+		return EFI_INVALID_PARAMETER;
+
+	/* Avoid double free */
+	alloc->checksum = 0;
+	*(void **)alloc = page->free;
+	was_full = !page->free;
+	page->free = alloc;
+	page->used--;
+
+	class = efi_pool_class(page->slot_size -
+			       sizeof(struct efi_pool_allocation));
+	if (!page->used) {
+		if (!was_full)
+			list_del(&page->link);
+		page->checksum = 0;
+		return efi_free_pages((uintptr_t)page, 1);
+	}
+	if (was_full)
+		list_add(&page->link, &efi_pool_pages[class]);
+
+	return EFI_SUCCESS;
+}
+
 /**
  * efi_allocate_pool - allocate memory from pool
  *
+ * Small allocations share pages with others of a similar size and the same
+ * memory type, larger ones get pages of their own.
+ *
  * @pool_type:	type of the pool from which memory is to be allocated
  * @size:	number of bytes to be allocated
  * @buffer:	allocated memory
@@ -517,7 +754,11 @@ efi_status_t efi_allocate_pool(int pool_type, efi_uintn_t size, void **buffer)
 	struct efi_pool_allocation *alloc;
 	u64 num_pages = efi_size_in_pages(size +
 					  sizeof(struct efi_pool_allocation));
+	int class;
 
+	/* Small allocations never reach the check in efi_allocate_pages() */
+	if (pool_type >= EFI_PERSISTENT_MEMORY_TYPE && pool_type <= 0x6FFFFFFF)
+		return EFI_INVALID_PARAMETER;
 	if (!buffer)
 		return EFI_INVALID_PARAMETER;
 
@@ -526,6 +767,16 @@ efi_status_t efi_allocate_pool(int pool_type, efi_uintn_t size, void **buffer)
 		return EFI_SUCCESS;
 	}
 
+	class = efi_pool_class(size);
+	if (class >= 0) {
+		alloc = efi_pool_slot_alloc(pool_type, class);
+		if (!alloc)
+			return EFI_OUT_OF_RESOURCES;
+		*buffer = alloc->data;
+
+		return EFI_SUCCESS;
+	}
+
 	r = efi_allocate_pages(EFI_ALLOCATE_ANY_PAGES, pool_type, num_pages,
 			       &addr);
 	if (r == EFI_SUCCESS) {
@@ -555,9 +806,16 @@ efi_status_t efi_free_pool(void *buffer)
 
 	alloc = container_of(buffer, struct efi_pool_allocation, data);
 
+	/* Allocations which are not page aligned come from a pool page */
+	if ((uintptr_t)alloc & EFI_PAGE_MASK) {
+		ret = efi_pool_slot_free(alloc);
+		if (ret != EFI_SUCCESS)
+			printf("%s: illegal free 0x%p\n", __func__, buffer);
+		return ret;
+	}
+
 	/* Check that this memory was allocated by efi_allocate_pool() */
-	if (((uintptr_t)alloc & EFI_PAGE_MASK) ||
-	    alloc->checksum != checksum(alloc)) {
+	if (alloc->checksum != checksum(alloc)) {
 		printf("%s: illegal free 0x%p\n", __func__, buffer);
 		return EFI_INVALID_PARAMETER;
 	}
@@ -587,8 +845,8 @@ efi_status_t efi_get_memory_map(efi_uintn_t *memory_map_size,
 				uint32_t *descriptor_version)
 {
 	efi_uintn_t map_size = 0;
-	int map_entries = 0;
-	struct list_head *lhandle;
+	int map_entries = efi_mem_count;
+	struct rb_node *rb;
 	efi_uintn_t provided_map_size;
 
 	if (!memory_map_size)
@@ -596,9 +854,6 @@ efi_status_t efi_get_memory_map(efi_uintn_t *memory_map_size,
 
 	provided_map_size = *memory_map_size;
 
-	list_for_each(lhandle, &efi_mem)
-		map_entries++;
-
 	map_size = map_entries * sizeof(struct efi_mem_desc);
 
 	*memory_map_size = map_size;
@@ -615,15 +870,13 @@ efi_status_t efi_get_memory_map(efi_uintn_t *memory_map_size,
 	if (descriptor_version)
 		*descriptor_version = EFI_MEMORY_DESCRIPTOR_VERSION;
 
-	/* Copy list into array */
-	/* Return the list in ascending order */
-	memory_map = &memory_map[map_entries - 1];
-	list_for_each(lhandle, &efi_mem) {
+	/* Copy tree into array, in ascending order as the list was */
+	for (rb = rb_first(&efi_mem); rb; rb = rb_next(rb)) {
 		struct efi_mem_list *lmem;
 
-		lmem = list_entry(lhandle, struct efi_mem_list, link);
+		lmem = rb_entry(rb, struct efi_mem_list, rb);
 		*memory_map = lmem->desc;
-		memory_map--;
+		memory_map++;
 	}
 
 	if (map_key)
@@ -724,6 +977,11 @@ static void add_u_boot_and_runtime(void)
 
 int efi_memory_init(void)
 {
+	int i;
+
+	for (i = 0; i < EFI_POOL_CLASSES; i++)
+		INIT_LIST_HEAD(&efi_pool_pages[i]);
+
 	efi_add_known_memory();
 
 	if (!IS_ENABLED(CONFIG_SANDBOX))
@@ -109,6 +109,15 @@ static int execute(void)
 	struct efi_mem_desc *memory_map;
 	efi_status_t ret;
 
+	/* Reserved memory types are rejected, even for small allocations */
+	ret = boottime->allocate_pool(EFI_PERSISTENT_MEMORY_TYPE, 16,
+				      (void **)&memory_map);
+	if (ret != EFI_INVALID_PARAMETER) {
+		efi_st_error
+			("AllocatePool did not return EFI_INVALID_PARAMETER\n");
+		return EFI_ST_FAILURE;
+	}
+
 	/* Allocate two page ranges with different memory type */
 	ret = boottime->allocate_pages(EFI_ALLOCATE_ANY_PAGES,
 				       EFI_RUNTIME_SERVICES_CODE,
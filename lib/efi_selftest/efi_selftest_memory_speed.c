@@ -0,0 +1,293 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * efi_selftest_memory_speed
+ *
+ * This unit test checks the following boottime services:
+ * AllocatePool, FreePool, AllocatePages, FreePages, GetMemoryMap
+ *
+ * Many pool allocations of mixed sizes and memory types are made and freed
+ * in a scattered order, after which the memory map must be as before. Then
+ * the number of allocations which can be made in a fixed time is reported.
+ */
+
+#include <efi_selftest.h>
+
+/* Number of allocations which are held at the same time */
+#define EFI_ST_ALLOCATIONS	1000
+/* Stride for freeing in a scattered order, coprime with the above */
+#define EFI_ST_STRIDE		37
+/* Time for each measurement in 100 ns units, 100 ms */
+#define EFI_ST_PERIOD		1000000
+
+static struct efi_boot_services *boottime;
+static struct efi_event *timer;
+static u8 **buffers;
+
+/**
+ * setup() - setup unit test
+ *
+ * @handle:	handle of the loaded image
+ * @systable:	system table
+ * Return:	EFI_ST_SUCCESS for success
+ */
+static int setup(const efi_handle_t handle,
+		 const struct efi_system_table *systable)
+{
+	efi_status_t ret;
+
+	boottime = systable->boottime;
+
+	ret = boottime->create_event(EVT_TIMER, TPL_CALLBACK, NULL, NULL,
+				     &timer);
+	if (ret != EFI_SUCCESS) {
+		efi_st_error("could not create event\n");
+		return EFI_ST_FAILURE;
+	}
+	ret = boottime->allocate_pool(EFI_LOADER_DATA,
+				      EFI_ST_ALLOCATIONS * sizeof(*buffers),
+				      (void **)&buffers);
+	if (ret != EFI_SUCCESS) {
+		efi_st_error("AllocatePool did not return EFI_SUCCESS\n");
+		return EFI_ST_FAILURE;
+	}
+
+	return EFI_ST_SUCCESS;
+}
+
+/**
+ * teardown() - tear down unit test
+ *
+ * Return:	EFI_ST_SUCCESS for success
+ */
+static int teardown(void)
+{
+	efi_status_t ret;
+
+	if (timer) {
+		ret = boottime->close_event(timer);
+		timer = NULL;
+		if (ret != EFI_SUCCESS) {
+			efi_st_error("could not close event\n");
+			return EFI_ST_FAILURE;
+		}
+	}
+	if (buffers) {
+		ret = boottime->free_pool(buffers);
+		buffers = NULL;
+		if (ret != EFI_SUCCESS) {
+			efi_st_error("FreePool did not return EFI_SUCCESS\n");
+			return EFI_ST_FAILURE;
+		}
+	}
+
+	return EFI_ST_SUCCESS;
+}
+
+/**
+ * get_map_size() - get the size of the memory map
+ *
+ * Return:	size of the memory map in bytes, 0 on error
+ */
+static efi_uintn_t get_map_size(void)
+{
+	efi_uintn_t map_size = 0;
+	efi_uintn_t map_key;
+	efi_uintn_t desc_size;
+	u32 desc_version;
+	efi_status_t ret;
+
+	ret = boottime->get_memory_map(&map_size, NULL, &map_key, &desc_size,
+				       &desc_version);
+	if (ret != EFI_BUFFER_TOO_SMALL) {
+		efi_st_error
+			("GetMemoryMap did not return EFI_BUFFER_TOO_SMALL\n");
+		return 0;
+	}
+
+	return map_size;
+}
+
+/* Size of the i-th allocation, from a few bytes to more than a page */
+static efi_uintn_t buffer_size(unsigned int i)
+{
+	return (i * 97) % (EFI_PAGE_SIZE + 512) + 1;
+}
+
+/**
+ * alloc_free_many() - allocate and free many buffers of mixed sizes
+ *
+ * @check:	fill and check the contents of each buffer
+ * Return:	EFI_ST_SUCCESS for success
+ */
+static int alloc_free_many(bool check)
+{
+	efi_status_t ret;
+	efi_uintn_t j;
+	unsigned int i, k;
+
+	for (i = 0; i < EFI_ST_ALLOCATIONS; ++i) {
+		ret = boottime->allocate_pool(i & 1 ? EFI_LOADER_DATA :
+					      EFI_BOOT_SERVICES_DATA,
+					      buffer_size(i),
+					      (void **)&buffers[i]);
+		if (ret != EFI_SUCCESS) {
+			efi_st_error("AllocatePool did not return EFI_SUCCESS\n");
+			return EFI_ST_FAILURE;
+		}
+		if ((uintptr_t)buffers[i] & 7) {
+			efi_st_error("Pool memory is not 8 byte aligned\n");
+			return EFI_ST_FAILURE;
+		}
+		if (check)
+			boottime->set_mem(buffers[i], buffer_size(i), (u8)i);
+	}
+	for (k = 0; k < EFI_ST_ALLOCATIONS; ++k) {
+		i = (k * EFI_ST_STRIDE) % EFI_ST_ALLOCATIONS;
+		for (j = 0; check && j < buffer_size(i); ++j) {
+			if (buffers[i][j] != (u8)i) {
+				efi_st_error("Pool buffer %u overwritten\n", i);
+				return EFI_ST_FAILURE;
+			}
+		}
+		ret = boottime->free_pool(buffers[i]);
+		if (ret != EFI_SUCCESS) {
+			efi_st_error("FreePool did not return EFI_SUCCESS\n");
+			return EFI_ST_FAILURE;
+		}
+	}
+
+	return EFI_ST_SUCCESS;
+}
+
+/**
+ * alloc_free_small() - allocate and free many small buffers
+ *
+ * Return:	EFI_ST_SUCCESS for success
+ */
+static int alloc_free_small(void)
+{
+	efi_status_t ret;
+	unsigned int i;
+
+	for (i = 0; i < EFI_ST_ALLOCATIONS; ++i) {
+		ret = boottime->allocate_pool(EFI_LOADER_DATA, 32,
+					      (void **)&buffers[i]);
+		if (ret != EFI_SUCCESS) {
+			efi_st_error("AllocatePool did not return EFI_SUCCESS\n");
+			return EFI_ST_FAILURE;
+		}
+	}
+	for (i = 0; i < EFI_ST_ALLOCATIONS; ++i) {
+		ret = boottime->free_pool(buffers[i]);
+		if (ret != EFI_SUCCESS) {
+			efi_st_error("FreePool did not return EFI_SUCCESS\n");
+			return EFI_ST_FAILURE;
+		}
+	}
+
+	return EFI_ST_SUCCESS;
+}
+
+/**
+ * alloc_free_pages() - allocate and free many single pages
+ *
+ * Return:	EFI_ST_SUCCESS for success
+ */
+static int alloc_free_pages(void)
+{
+	efi_status_t ret;
+	unsigned int i;
+	u64 addr;
+
+	for (i = 0; i < EFI_ST_ALLOCATIONS; ++i) {
+		ret = boottime->allocate_pages(EFI_ALLOCATE_ANY_PAGES,
+					       EFI_LOADER_DATA, 1, &addr);
+		if (ret != EFI_SUCCESS) {
+			efi_st_error("AllocatePages did not return EFI_SUCCESS\n");
+			return EFI_ST_FAILURE;
+		}
+		buffers[i] = (u8 *)(uintptr_t)addr;
+	}
+	for (i = 0; i < EFI_ST_ALLOCATIONS; ++i) {
+		ret = boottime->free_pages((uintptr_t)buffers[i], 1);
+		if (ret != EFI_SUCCESS) {
+			efi_st_error("FreePages did not return EFI_SUCCESS\n");
+			return EFI_ST_FAILURE;
+		}
+	}
+
+	return EFI_ST_SUCCESS;
+}
+
+static int alloc_free_mixed(void)
+{
+	return alloc_free_many(false);
+}
+
+/**
+ * measure() - report how often a round of allocations runs in a fixed time
+ *
+ * @round:	function making EFI_ST_ALLOCATIONS allocations and freeing them
+ * @what:	description of the allocations
+ * Return:	EFI_ST_SUCCESS for success
+ */
+static int measure(int (*round)(void), const char *what)
+{
+	unsigned int count;
+	efi_status_t ret;
+
+	ret = boottime->set_timer(timer, EFI_TIMER_RELATIVE, EFI_ST_PERIOD);
+	if (ret != EFI_SUCCESS) {
+		efi_st_error("Could not set timer\n");
+		return EFI_ST_FAILURE;
+	}
+	for (count = 0; boottime->check_event(timer) != EFI_SUCCESS; ++count) {
+		if (round() != EFI_ST_SUCCESS)
+			return EFI_ST_FAILURE;
+	}
+	efi_st_printf("%u %s in 100 ms\n", count * EFI_ST_ALLOCATIONS, what);
+
+	return EFI_ST_SUCCESS;
+}
+
+/*
+ * execute() - execute unit test
+ *
+ * Return:	EFI_ST_SUCCESS for success
+ */
+static int execute(void)
+{
+	efi_uintn_t map_size;
+
+	map_size = get_map_size();
+	if (!map_size)
+		return EFI_ST_FAILURE;
+	if (alloc_free_many(true) != EFI_ST_SUCCESS)
+		return EFI_ST_FAILURE;
+	if (get_map_size() != map_size) {
+		efi_st_error("Memory map changed after freeing all buffers\n");
+		return EFI_ST_FAILURE;
+	}
+
+	if (measure(alloc_free_small, "small pool allocations") !=
+	    EFI_ST_SUCCESS ||
+	    measure(alloc_free_pages, "page allocations") != EFI_ST_SUCCESS ||
+	    measure(alloc_free_mixed, "mixed pool allocations") !=
+	    EFI_ST_SUCCESS)
+		return EFI_ST_FAILURE;
+
+	if (get_map_size() != map_size) {
+		efi_st_error("Memory map changed after freeing all buffers\n");
+		return EFI_ST_FAILURE;
+	}
+
+	return EFI_ST_SUCCESS;
+}
+
+EFI_UNIT_TEST(memory_speed) = {
+	.name = "memory allocation speed",
+	.phase = EFI_EXECUTE_BEFORE_BOOTTIME_EXIT,
+	.setup = setup,
+	.execute = execute,
+	.teardown = teardown,
+};
@@ -633,6 +633,140 @@ int fdtdec_prepare_fdt(void)
 	return 0;
 }
 
+#if CONFIG_IS_ENABLED(OF_PHANDLE_CACHE)
+/**
+ * struct fdtdec_phandle - entry in the phandle index of a tree
+ *
+ * @phandle:	phandle of the node
+ * @offset:	offset of the node in the tree
+ */
+struct fdtdec_phandle {
+	u32 phandle;
+	int offset;
+};
+
+/*
+ * Phandles of the tree at @blob, sorted by phandle. The sizes from the
+ * header of the tree catch most changes to it; in addition each offset is
+ * checked against the tree before it is returned.
+ */
+static struct {
+	const void *blob;
+	u32 totalsize;
+	u32 size_dt_struct;
+	int count;
+	struct fdtdec_phandle *entries;
+} phandle_cache;
+
+void fdtdec_phandle_cache_invalidate(const void *blob)
+{
+	if (!(gd->flags & GD_FLG_RELOC))
+		return;
+	if (blob && blob != phandle_cache.blob)
+		return;
+	free(phandle_cache.entries);
+	memset(&phandle_cache, '\0', sizeof(phandle_cache));
+}
+
+static int fdtdec_phandle_cmp(const void *a, const void *b)
+{
+	const struct fdtdec_phandle *pa = a, *pb = b;
+
+	if (pa->phandle == pb->phandle)
+		return 0;
+
+	return pa->phandle < pb->phandle ? -1 : 1;
+}
+
+static int fdtdec_phandle_cache_build(const void *blob)
+{
+	struct fdtdec_phandle *entries = NULL, *new;
+	int count = 0, max = 0;
+	u32 phandle;
+	int offset;
+
+	fdtdec_phandle_cache_invalidate(NULL);
+	for (offset = fdt_next_node(blob, -1, NULL); offset >= 0;
+	     offset = fdt_next_node(blob, offset, NULL)) {
+		phandle = fdt_get_phandle(blob, offset);
+		if (!phandle)
+			continue;
+		if (count == max) {
+			max = max ? max * 2 : 64;
+			new = realloc(entries, max * sizeof(*entries));
+			if (!new) {
+				free(entries);
+				return -ENOMEM;
+			}
+			entries = new;
+		}
+		entries[count].phandle = phandle;
+		entries[count].offset = offset;
+		count++;
+	}
+	qsort(entries, count, sizeof(*entries), fdtdec_phandle_cmp);
+
+	phandle_cache.blob = blob;
+	phandle_cache.totalsize = fdt_totalsize(blob);
+	phandle_cache.size_dt_struct = fdt_size_dt_struct(blob);
+	phandle_cache.count = count;
+	phandle_cache.entries = entries;
+	debug("%s: %d phandles\n", __func__, count);
+
+	return 0;
+}
+
+static int fdtdec_phandle_cache_find(u32 phandle)
+{
+	int lo = 0, hi = phandle_cache.count;
+
+	while (lo < hi) {
+		int mid = lo + (hi - lo) / 2;
+		u32 val = phandle_cache.entries[mid].phandle;
+
+		if (val == phandle)
+			return phandle_cache.entries[mid].offset;
+		if (val < phandle)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	return -FDT_ERR_NOTFOUND;
+}
+
+int fdtdec_node_offset_by_phandle(const void *blob, uint32_t phandle)
+{
+	int offset;
+
+	/* The index lives in BSS and malloc(), so wait for relocation */
+	if (!(gd->flags & GD_FLG_RELOC) || phandle == 0 ||
+	    phandle == (uint32_t)-1)
+		return fdt_node_offset_by_phandle(blob, phandle);
+
+	if (phandle_cache.blob != blob ||
+	    phandle_cache.totalsize != fdt_totalsize(blob) ||
+	    phandle_cache.size_dt_struct != fdt_size_dt_struct(blob)) {
+		if (fdtdec_phandle_cache_build(blob))
+			return fdt_node_offset_by_phandle(blob, phandle);
+	}
+
+	offset = fdtdec_phandle_cache_find(phandle);
+	if (offset >= 0 && fdt_get_phandle(blob, offset) == phandle)
+		return offset;
+
+	/*
+	 * The tree may have been changed without its size changing, so
+	 * search it. If the phandle is there after all, the index is stale.
+	 */
+	offset = fdt_node_offset_by_phandle(blob, phandle);
+	if (offset >= 0)
+		fdtdec_phandle_cache_invalidate(blob);
+
+	return offset;
+}
+#endif
+
 int fdtdec_lookup_phandle(const void *blob, int node, const char *prop_name)
 {
 	const u32 *phandle;
@@ -643,7 +777,7 @@ int fdtdec_lookup_phandle(const void *blob, int node, const char *prop_name)
 	if (!phandle)
 		return -FDT_ERR_NOTFOUND;
 
-	lookup = fdt_node_offset_by_phandle(blob, fdt32_to_cpu(*phandle));
+	lookup = fdtdec_node_offset_by_phandle(blob, fdt32_to_cpu(*phandle));
 	return lookup;
 }
 
@@ -774,8 +908,8 @@ int fdtdec_parse_phandle_with_args(const void *blob, int src_node,
 			 * below.
 			 */
 			if (cells_name || cur_index == index) {
-				node = fdt_node_offset_by_phandle(blob,
-								  phandle);
+				node = fdtdec_node_offset_by_phandle(blob,
+								     phandle);
 				if (!node) {
 					debug("%s: could not find phandle\n",
 					      fdt_get_name(blob, src_node,
@@ -1426,7 +1560,7 @@ int fdtdec_get_carveout(const void *blob, const char *node, const char *name,
 
 	phandle = fdt32_to_cpu(prop[index]);
 
-	offset = fdt_node_offset_by_phandle(blob, phandle);
+	offset = fdtdec_node_offset_by_phandle(blob, phandle);
 	if (offset < 0) {
 		debug("failed to find node for phandle %u\n", phandle);
 		return offset;
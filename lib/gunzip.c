@@ -13,6 +13,7 @@
 #include <memalign.h>
 #include <u-boot/zlib.h>
 #include <div64.h>
+#include <linux/sizes.h>
 
 #define HEADER0			'\x1f'
 #define HEADER1			'\x8b'
@@ -79,6 +80,100 @@ int gunzip(void *dst, int dstlen, unsigned char *src, unsigned long *lenp)
 	return zunzip(dst, dstlen, src, lenp, 1, offset);
 }
 
+/*
+ * Limits on the buffer for compressed data in gunzip_stream(). The largest
+ * size which fits in the heap is used.
+ */
+#define GUNZIP_STREAM_BUF_MAX	SZ_64K
+#define GUNZIP_STREAM_BUF_MIN	SZ_4K
+
+/* Bytes read before the header is parsed, enough for any sensible name */
+#define GUNZIP_STREAM_HDR_SIZE	SZ_1K
+
+int gunzip_stream(void *dst, ulong dstlen, ulong *lenp,
+		  int (*read)(void *priv, void *buf, ulong len), void *priv)
+{
+	unsigned char *buf = NULL;
+	z_stream s;
+	int offset, len;
+	ulong size, got;
+	int r, ret;
+
+	for (size = GUNZIP_STREAM_BUF_MAX; size >= GUNZIP_STREAM_BUF_MIN;
+	     size /= 2) {
+		buf = malloc_cache_aligned(size);
+		if (buf)
+			break;
+	}
+	if (!buf)
+		return -ENOMEM;
+
+	/* The header must be in one piece, so read enough of it first */
+	for (got = 0; got < GUNZIP_STREAM_HDR_SIZE; got += len) {
+		len = read(priv, buf + got, size - got);
+		if (len < 0) {
+			ret = len;
+			goto err_free;
+		}
+		if (!len)
+			break;
+	}
+	offset = gzip_parse_header(buf, got);
+	if (offset < 0) {
+		ret = -EINVAL;
+		goto err_free;
+	}
+
+	s.zalloc = gzalloc;
+	s.zfree = gzfree;
+	r = inflateInit2(&s, -MAX_WBITS);
+	if (r != Z_OK) {
+		printf("Error: inflateInit2() returned %d\n", r);
+		ret = r == Z_MEM_ERROR ? -ENOMEM : -EINVAL;
+		goto err_free;
+	}
+	s.next_in = buf + offset;
+	s.avail_in = got - offset;
+	s.next_out = dst;
+	s.avail_out = dstlen;
+
+	/* Decompress each piece as it arrives, until the deflate stream ends */
+	do {
+		if (!s.avail_in) {
+			len = read(priv, buf, size);
+			if (len <= 0) {
+				puts("Error: gunzip out of data\n");
+				ret = len ? len : -EINVAL;
+				break;
+			}
+			s.next_in = buf;
+			s.avail_in = len;
+		}
+		r = inflate(&s, Z_SYNC_FLUSH);
+		if (r == Z_STREAM_END) {
+			ret = 0;
+		} else if (r == Z_BUF_ERROR && !s.avail_out) {
+			ret = -ENOSPC;
+		} else if (r == Z_MEM_ERROR) {
+			/* the window is allocated on first use */
+			ret = -ENOMEM;
+		} else if (r != Z_OK && r != Z_BUF_ERROR) {
+			printf("Error: inflate() returned %d\n", r);
+			ret = -EINVAL;
+		} else {
+			ret = -EAGAIN;
+		}
+		WATCHDOG_RESET();
+	} while (ret == -EAGAIN);
+	*lenp = s.next_out - (unsigned char *)dst;
+	inflateEnd(&s);
+
+err_free:
+	free(buf);
+
+	return ret;
+}
+
 #ifdef CONFIG_CMD_UNZIP
 __weak
 void gzwrite_progress_init(u64 expectedsize)
@@ -43,6 +43,9 @@
 #define USED_FREE 0
 #define USED_DELETED -1
 
+/* Size of the chunks key and data strings are carved from */
+#define HTAB_ARENA_SIZE 4096
+
 #include <env_callback.h>
 #include <env_flags.h>
 #include <search.h>
@@ -61,13 +64,87 @@
 
 typedef struct _ENTRY {
 	int used;
+	struct htab_arena *key_arena;
+	struct htab_arena *data_arena;
 	ENTRY entry;
 } _ENTRY;
 
+/*
+ * Keys and values are not strdup()ed one by one but packed into arenas
+ * shared by many entries. Each arena counts the strings living in it and
+ * is freed when the last of them goes away; the arena currently being
+ * filled holds an extra reference from the hash table itself.
+ */
+struct htab_arena {
+	unsigned int refs;
+	unsigned int size;
+	unsigned int used;
+	char buf[];
+};
+
 
 static void _hdelete(const char *key, struct hsearch_data *htab, ENTRY *ep,
 	int idx);
 
+/*
+ * String arenas
+ */
+
+static struct htab_arena *htab_arena_new(size_t size)
+{
+	struct htab_arena *arena;
+
+	arena = malloc(sizeof(*arena) + size);
+	if (!arena)
+		return NULL;
+
+	arena->refs = 0;
+	arena->size = size;
+	arena->used = 0;
+
+	return arena;
+}
+
+static void htab_arena_put(struct htab_arena *arena)
+{
+	if (arena && !--arena->refs)
+		free(arena);
+}
+
+/*
+ * Copy a string into the current arena of the table, starting a new one
+ * when it is full. Strings too large to share an arena sensibly get one
+ * of their own so their memory is returned as soon as they are dropped.
+ */
+static char *htab_strdup(struct hsearch_data *htab, const char *s,
+			 struct htab_arena **arenap)
+{
+	struct htab_arena *arena = htab->arena;
+	size_t len = strlen(s) + 1;
+	char *p;
+
+	if (len > HTAB_ARENA_SIZE / 4) {
+		arena = htab_arena_new(len);
+		if (!arena)
+			return NULL;
+	} else if (!arena || arena->size - arena->used < len) {
+		arena = htab_arena_new(HTAB_ARENA_SIZE);
+		if (!arena)
+			return NULL;
+		htab_arena_put(htab->arena);
+		arena->refs = 1;
+		htab->arena = arena;
+	}
+
+	p = arena->buf + arena->used;
+	memcpy(p, s, len);
+	arena->used += len;
+	arena->refs++;
+	*arenap = arena;
+
+	return p;
+}
+
 /*
  * hcreate()
  */
@@ -118,6 +195,7 @@ int hcreate_r(size_t nel, struct hsearch_data *htab)
 
 	htab->size = nel;
 	htab->filled = 0;
+	htab->deleted = 0;
 
 	/* allocate memory and zero out */
 	htab->table = (_ENTRY *) calloc(htab->size + 1, sizeof(_ENTRY));
@@ -151,18 +229,129 @@ void hdestroy_r(struct hsearch_data *htab)
 	/* free used memory */
 	for (i = 1; i <= htab->size; ++i) {
 		if (htab->table[i].used > 0) {
-			ENTRY *ep = &htab->table[i].entry;
-
-			free((void *)ep->key);
-			free(ep->data);
+			htab_arena_put(htab->table[i].key_arena);
+			htab_arena_put(htab->table[i].data_arena);
 		}
 	}
 	free(htab->table);
+	htab_arena_put(htab->arena);
+	htab->arena = NULL;
 
 	/* the sign for an existing table is an value != NULL in htable */
 	htab->table = NULL;
 }
 
+/*
+ * First hash function: compute a value for the given string and simply
+ * take the modulus, but prevent zero. Perhaps use a better method.
+ */
+static unsigned int htab_hash(const char *key, unsigned int size)
+{
+	unsigned int len = strlen(key);
+	unsigned int hval = len;
+
+	while (len-- > 0) {
+		hval <<= 4;
+		hval += key[len];
+	}
+
+	hval %= size;
+	if (hval == 0)
+		++hval;
+
+	return hval;
+}
+
+/*
+ * Second hash function, as suggested in [Knuth]: step backwards through
+ * the table by a key dependent increment. Because SIZE is prime this
+ * guarantees to step through all available indices.
+ */
+static inline unsigned int htab_probe(unsigned int idx, unsigned int hval,
+				      unsigned int size)
+{
+	unsigned int hval2 = 1 + hval % (size - 2);
+
+	if (idx <= hval2)
+		return size + idx - hval2;
+
+	return idx - hval2;
+}
+
+/*
+ * Move all entries over into a new table of (at least) "nel" elements,
+ * which also drops all deleted slots. Entries keep their strings, only
+ * their position in the table changes.
+ */
+static int htab_resize(struct hsearch_data *htab, size_t nel)
+{
+	struct hsearch_data new = { .table = NULL };
+	unsigned int hval, idx;
+	int i;
+
+	if (hcreate_r(nel, &new) == 0)
+		return 0;
+
+	debug("Resize Hash Table: %p N=%d -> %d (%d used, %d deleted)\n",
+	      htab, htab->size, new.size, htab->filled, htab->deleted);
+
+	for (i = 1; i <= htab->size; ++i) {
+		if (htab->table[i].used <= 0)
+			continue;
+
+		hval = htab_hash(htab->table[i].entry.key, new.size);
+		idx = hval;
+		while (new.table[idx].used)
+			idx = htab_probe(idx, hval, new.size);
+
+		new.table[idx] = htab->table[i];
+		new.table[idx].used = hval;
+	}
+
+	free(htab->table);
+	htab->table = new.table;
+	htab->size = new.size;
+	htab->deleted = 0;
+
+	return 1;
+}
+
+/*
+ * The table is grown (or, if mostly deleted slots fill it up, rebuilt at
+ * its current size) once more than three quarters of it are in use, so
+ * probe chains stay short and ENTER does not run out of room.
+ */
+static int htab_need_resize(struct hsearch_data *htab)
+{
+	return (htab->filled + htab->deleted + 1) * 4 > htab->size * 3;
+}
+
+static int htab_grow(struct hsearch_data *htab)
+{
+	size_t nel = htab->filled * 2;
+
+	if (nel < htab->size)
+		nel = htab->size;
+
+	return htab_resize(htab, nel);
+}
+
+/*
+ * A callback run from hsearch_r() or hdelete_r() may itself add variables
+ * and thereby resize the table. Look the entry up again if that happened.
+ */
+static int htab_reindex(const char *key, struct hsearch_data *htab,
+			struct _ENTRY *table, int idx)
+{
+	ENTRY e, *ep;
+
+	if (htab->table == table)
+		return idx;
+
+	e.key = key;
+	return hsearch_r(e, FIND, &ep, htab, 0);
+}
+
 /*
  * hsearch()
  */
@@ -190,7 +379,11 @@ void hdestroy_r(struct hsearch_data *htab)
  *   works with NUL terminated strings only.
  * - Instead of storing just pointers to the original objects, we
  *   create local copies so the caller does not need to care about the
- *   data any more.
+ *   data any more. The copies are packed into shared string arenas.
+ *   A value overwritten by one that is not longer is updated in place.
+ * - The table grows automatically as entries are added, so ENTER only
+ *   fails when memory is exhausted. Pointers to entries returned by an
+ *   earlier call are invalidated when a new entry is created.
  * - The standard implementation does not provide a way to update an
  *   existing entry.  This version will create a new entry or update an
  *   existing one when both "action == ENTER" and "item.data != NULL".
@@ -232,6 +425,11 @@ static inline int _compare_and_overwrite_entry(ENTRY item, ACTION action,
 	    && strcmp(item.key, htab->table[idx].entry.key) == 0) {
 		/* Overwrite existing value? */
 		if ((action == ENTER) && (item.data != NULL)) {
+			struct _ENTRY *table = htab->table;
+			struct htab_arena *arena;
+			size_t len;
+			char *data;
+
 			/* check for permission */
 			if (htab->change_ok != NULL && htab->change_ok(
 			    &htab->table[idx].entry, item.data,
@@ -253,13 +451,22 @@ static inline int _compare_and_overwrite_entry(ENTRY item, ACTION action,
 				*retval = NULL;
 				return 0;
 			}
-
-			free(htab->table[idx].entry.data);
-			htab->table[idx].entry.data = strdup(item.data);
-			if (!htab->table[idx].entry.data) {
-				__set_errno(ENOMEM);
-				*retval = NULL;
-				return 0;
+			idx = htab_reindex(item.key, htab, table, idx);
+
+			data = htab->table[idx].entry.data;
+			len = strlen(item.data);
+			if (len <= strlen(data)) {
+				memmove(data, item.data, len + 1);
+			} else {
+				data = htab_strdup(htab, item.data, &arena);
+				if (!data) {
+					__set_errno(ENOMEM);
+					*retval = NULL;
+					return 0;
+				}
+				htab_arena_put(htab->table[idx].data_arena);
+				htab->table[idx].data_arena = arena;
+				htab->table[idx].entry.data = data;
 			}
 		}
 		/* return found entry */
@@ -273,28 +480,17 @@ static inline int _compare_and_overwrite_entry(ENTRY item, ACTION action,
 int hsearch_r(ENTRY item, ACTION action, ENTRY ** retval,
 	      struct hsearch_data *htab, int flag)
 {
+	struct htab_arena *key_arena, *data_arena;
+	struct _ENTRY *table;
 	unsigned int hval;
-	unsigned int count;
-	unsigned int len = strlen(item.key);
 	unsigned int idx;
-	unsigned int first_deleted = 0;
+	unsigned int first_deleted;
+	char *key, *data;
 	int ret;
 
-	/* Compute an value for the given string. Perhaps use a better method. */
-	hval = len;
-	count = len;
-	while (count-- > 0) {
-		hval <<= 4;
-		hval += item.key[count];
-	}
-
-	/*
-	 * First hash function:
-	 * simply take the modul but prevent zero.
-	 */
-	hval %= htab->size;
-	if (hval == 0)
-		++hval;
+retry:
+	first_deleted = 0;
+	hval = htab_hash(item.key, htab->size);
 
 	/* The first index tried. */
 	idx = hval;
@@ -304,8 +500,6 @@ int hsearch_r(ENTRY item, ACTION action, ENTRY ** retval,
 		 * Further action might be required according to the
 		 * action value.
 		 */
-		unsigned hval2;
-
 		if (htab->table[idx].used == USED_DELETED
 		    && !first_deleted)
 			first_deleted = idx;
@@ -315,21 +509,8 @@ int hsearch_r(ENTRY item, ACTION action, ENTRY ** retval,
 		if (ret != -1)
 			return ret;
 
-		/*
-		 * Second hash function:
-		 * as suggested in [Knuth]
-		 */
-		hval2 = 1 + hval % (htab->size - 2);
-
 		do {
-			/*
-			 * Because SIZE is prime this guarantees to
-			 * step through all available indices.
-			 */
-			if (idx <= hval2)
-				idx = htab->size + idx - hval2;
-			else
-				idx -= hval2;
+			idx = htab_probe(idx, hval, htab->size);
 
 			/*
 			 * If we visited all entries leave the loop
@@ -354,9 +535,14 @@ int hsearch_r(ENTRY item, ACTION action, ENTRY ** retval,
 	/* An empty bucket has been found. */
 	if (action == ENTER) {
 		/*
-		 * If table is full and another entry should be
-		 * entered return with error.
+		 * Make room before the table gets crowded. Should that fail
+		 * we carry on as long as there is a free slot left, and if
+		 * the table is full and another entry should be entered
+		 * return with error.
 		 */
+		if (htab_need_resize(htab) && htab_grow(htab))
+			goto retry;
+
 		if (htab->filled == htab->size) {
 			__set_errno(ENOMEM);
 			*retval = NULL;
@@ -367,19 +553,31 @@ int hsearch_r(ENTRY item, ACTION action, ENTRY ** retval,
 		 * Create new entry;
 		 * create copies of item.key and item.data
 		 */
-		if (first_deleted)
-			idx = first_deleted;
-
-		htab->table[idx].used = hval;
-		htab->table[idx].entry.key = strdup(item.key);
-		htab->table[idx].entry.data = strdup(item.data);
-		if (!htab->table[idx].entry.key ||
-		    !htab->table[idx].entry.data) {
+		key = htab_strdup(htab, item.key, &key_arena);
+		if (!key) {
+			__set_errno(ENOMEM);
+			*retval = NULL;
+			return 0;
+		}
+		data = htab_strdup(htab, item.data, &data_arena);
+		if (!data) {
+			htab_arena_put(key_arena);
 			__set_errno(ENOMEM);
 			*retval = NULL;
 			return 0;
 		}
 
+		if (first_deleted) {
+			idx = first_deleted;
+			--htab->deleted;
+		}
+
+		htab->table[idx].used = hval;
+		htab->table[idx].key_arena = key_arena;
+		htab->table[idx].data_arena = data_arena;
+		htab->table[idx].entry.key = key;
+		htab->table[idx].entry.data = data;
+
 		++htab->filled;
 
 		/* This is a new entry, so look up a possible callback */
@@ -388,27 +586,33 @@ int hsearch_r(ENTRY item, ACTION action, ENTRY ** retval,
 		env_flags_init(&htab->table[idx].entry);
 
 		/* check for permission */
+		table = htab->table;
 		if (htab->change_ok != NULL && htab->change_ok(
 		    &htab->table[idx].entry, item.data, env_op_create, flag)) {
 			debug("change_ok() rejected setting variable "
 				"%s, skipping it!\n", item.key);
+			idx = htab_reindex(item.key, htab, table, idx);
 			_hdelete(item.key, htab, &htab->table[idx].entry, idx);
 			__set_errno(EPERM);
 			*retval = NULL;
 			return 0;
 		}
+		idx = htab_reindex(item.key, htab, table, idx);
 
 		/* If there is a callback, call it */
+		table = htab->table;
 		if (htab->table[idx].entry.callback &&
 		    htab->table[idx].entry.callback(item.key, item.data,
 		    env_op_create, flag)) {
 			debug("callback() rejected setting variable "
 				"%s, skipping it!\n", item.key);
+			idx = htab_reindex(item.key, htab, table, idx);
 			_hdelete(item.key, htab, &htab->table[idx].entry, idx);
 			__set_errno(EINVAL);
 			*retval = NULL;
 			return 0;
 		}
+		idx = htab_reindex(item.key, htab, table, idx);
 
 		/* return new entry */
 		*retval = &htab->table[idx].entry;
@@ -436,17 +640,23 @@ static void _hdelete(const char *key, struct hsearch_data *htab, ENTRY *ep,
 {
 	/* free used ENTRY */
 	debug("hdelete: DELETING key \"%s\"\n", key);
-	free((void *)ep->key);
-	free(ep->data);
+	htab_arena_put(htab->table[idx].key_arena);
+	htab_arena_put(htab->table[idx].data_arena);
+	htab->table[idx].key_arena = NULL;
+	htab->table[idx].data_arena = NULL;
+	ep->key = NULL;
+	ep->data = NULL;
 	ep->callback = NULL;
 	ep->flags = 0;
 	htab->table[idx].used = USED_DELETED;
 
 	--htab->filled;
+	++htab->deleted;
 }
 
 int hdelete_r(const char *key, struct hsearch_data *htab, int flag)
 {
+	struct _ENTRY *table;
 	ENTRY e, *ep;
 	int idx;
 
@@ -470,6 +680,7 @@ int hdelete_r(const char *key, struct hsearch_data *htab, int flag)
 	}
 
 	/* If there is a callback, call it */
+	table = htab->table;
 	if (htab->table[idx].entry.callback &&
 	    htab->table[idx].entry.callback(key, NULL, env_op_delete, flag)) {
 		debug("callback() rejected deleting variable "
@@ -477,8 +688,9 @@ int hdelete_r(const char *key, struct hsearch_data *htab, int flag)
 		__set_errno(EINVAL);
 		return 0;
 	}
+	idx = htab_reindex(key, htab, table, idx);
 
-	_hdelete(key, htab, ep, idx);
+	_hdelete(key, htab, &htab->table[idx].entry, idx);
 
 	return 1;
 }
@@ -596,7 +808,7 @@ ssize_t hexport_r(struct hsearch_data *htab, const char sep, int flag,
 		 char **resp, size_t size,
 		 int argc, char * const argv[])
 {
-	ENTRY *list[htab->size];
+	ENTRY **list;
 	char *res, *p;
 	size_t totlen;
 	int i, n;
@@ -609,6 +821,14 @@ ssize_t hexport_r(struct hsearch_data *htab, const char sep, int flag,
 
 	debug("EXPORT  table = %p, htab.size = %d, htab.filled = %d, size = %lu\n",
 	      htab, htab->size, htab->filled, (ulong)size);
+
+	/* the table may be large, so keep the list of entries off the stack */
+	list = malloc((htab->filled + 1) * sizeof(ENTRY *));
+	if (!list) {
+		__set_errno(ENOMEM);
+		return (-1);
+	}
+
 	/*
 	 * Pass 1:
 	 * search used entries,
@@ -664,6 +884,7 @@ ssize_t hexport_r(struct hsearch_data *htab, const char sep, int flag,
 		if (size < totlen + 1) {	/* provided buffer too small */
 			printf("Env export buffer too small: %lu, but need %lu\n",
 			       (ulong)size, (ulong)totlen + 1);
+			free(list);
 			__set_errno(ENOMEM);
 			return (-1);
 		}
@@ -680,6 +901,7 @@ ssize_t hexport_r(struct hsearch_data *htab, const char sep, int flag,
 		/* no, allocate and clear one */
 		*resp = res = calloc(1, size);
 		if (res == NULL) {
+			free(list);
 			__set_errno(ENOMEM);
 			return (-1);
 		}
@@ -706,6 +928,7 @@ ssize_t hexport_r(struct hsearch_data *htab, const char sep, int flag,
 		*p++ = sep;
 	}
 	*p = '\0';		/* terminate result */
+	free(list);
 
 	return size;
 }
@@ -819,8 +1042,8 @@ int himport_r(struct hsearch_data *htab,
 	}
 
 	/*
-	 * Create new hash table (if needed).  The computation of the hash
-	 * table size is based on heuristics: in a sample of some 70+
+	 * Create new hash table (if needed).  The computation of the initial
+	 * hash table size is based on heuristics: in a sample of some 70+
 	 * existing systems we found an average size of 39+ bytes per entry
 	 * in the environment (for the whole key=value pair). Assuming a
 	 * size of 8 per entry (= safety factor of ~5) should provide enough
@@ -833,7 +1056,9 @@ int himport_r(struct hsearch_data *htab,
 	 * environment size), so we clip it to a reasonable value.
 	 * On the other hand we need to add some more entries for free
 	 * space when importing very small buffers. Both boundaries can
-	 * be overwritten in the board config file if needed.
+	 * be overwritten in the board config file if needed. They only
+	 * avoid resizing in the common case: the table grows on demand
+	 * when more variables are entered.
 	 */
 
 	if (!htab->table) {
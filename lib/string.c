@@ -20,6 +20,7 @@
 #include <linux/string.h>
 #include <linux/ctype.h>
 #include <malloc.h>
+#include <asm/byteorder.h>
 
 
 /**
@@ -473,14 +474,31 @@ void * memset(void * s,int c,size_t count)
 	char *s8;
 
 #if !CONFIG_IS_ENABLED(TINY_MEMSET)
-	unsigned long cl = 0;
-	int i;
+	unsigned long cl;
 
 	/* do it one word at a time (32 bits or 64 bits) while possible */
-	if ( ((ulong)s & (sizeof(*sl) - 1)) == 0) {
-		for (i = 0; i < sizeof(*sl); i++) {
-			cl <<= 8;
-			cl |= c & 0xff;
+	if (count >= 2 * sizeof(*sl)) {
+		/* fill up to the first word boundary */
+		s8 = (char *)s;
+		while ((ulong)s8 & (sizeof(*sl) - 1)) {
+			*s8++ = c;
+			count--;
+		}
+		sl = (unsigned long *)s8;
+
+		cl = (unsigned char)c;
+		cl |= cl << 8;
+		cl |= cl << 16;
+		if (sizeof(cl) > 4)
+			cl |= cl << 16 << 16;
+
+		while (count >= 4 * sizeof(*sl)) {
+			sl[0] = cl;
+			sl[1] = cl;
+			sl[2] = cl;
+			sl[3] = cl;
+			sl += 4;
+			count -= 4 * sizeof(*sl);
 		}
 		while (count >= sizeof(*sl)) {
 			*sl++ = cl;
@@ -496,7 +514,68 @@ void * memset(void * s,int c,size_t count)
 }
 #endif
 
+#if !defined(__HAVE_ARCH_MEMCPY) || !defined(__HAVE_ARCH_MEMMOVE)
+#define WSIZE	sizeof(unsigned long)
+#define WMASK	(WSIZE - 1)
+
+/*
+ * Return the word that starts 'shift' bits into the aligned word 'lo' and
+ * continues into the next aligned word 'hi'
+ */
+static inline unsigned long merge_words(unsigned long lo, unsigned long hi,
+					uint shift)
+{
+#ifdef __LITTLE_ENDIAN
+	return (lo >> shift) | (hi << (8 * WSIZE - shift));
+#else
+	return (lo << shift) | (hi >> (8 * WSIZE - shift));
+#endif
+}
+#endif
+
 #ifndef __HAVE_ARCH_MEMCPY
+/*
+ * Copy 'nwords' words from 'src' to the aligned 'dl' in ascending order.
+ *
+ * If 'src' is misaligned, each destination word is merged from the two
+ * aligned source words it straddles, so that all accesses stay word sized
+ * and aligned. No word is read which does not hold a byte of the source.
+ */
+static void copy_words_fwd(unsigned long *dl, const char *src, size_t nwords)
+{
+	const unsigned long *sl;
+	unsigned long prev, next;
+	uint shift = 8 * ((ulong)src & WMASK);
+
+	if (!shift) {
+		sl = (const unsigned long *)src;
+		while (nwords >= 4) {
+			dl[0] = sl[0];
+			dl[1] = sl[1];
+			dl[2] = sl[2];
+			dl[3] = sl[3];
+			dl += 4;
+			sl += 4;
+			nwords -= 4;
+		}
+		while (nwords--)
+			*dl++ = *sl++;
+		return;
+	}
+
+	sl = (const unsigned long *)((ulong)src & ~WMASK);
+	prev = *sl++;
+	while (nwords >= 2) {
+		next = *sl++;
+		*dl++ = merge_words(prev, next, shift);
+		prev = *sl++;
+		*dl++ = merge_words(next, prev, shift);
+		nwords -= 2;
+	}
+	if (nwords)
+		*dl = merge_words(prev, *sl, shift);
+}
+
 /**
  * memcpy - Copy one area of memory to another
  * @dest: Where to copy to
@@ -508,22 +587,26 @@ void * memset(void * s,int c,size_t count)
  */
 void * memcpy(void *dest, const void *src, size_t count)
 {
-	unsigned long *dl = (unsigned long *)dest, *sl = (unsigned long *)src;
-	char *d8, *s8;
+	char *d8 = (char *)dest, *s8 = (char *)src;
+	size_t n;
 
 	if (src == dest)
 		return dest;
 
-	/* while all data is aligned (common case), copy a word at a time */
-	if ( (((ulong)dest | (ulong)src) & (sizeof(*dl) - 1)) == 0) {
-		while (count >= sizeof(*dl)) {
-			*dl++ = *sl++;
-			count -= sizeof(*dl);
+	/* align the destination, then copy a word at a time */
+	if (count >= 2 * WSIZE) {
+		while ((ulong)d8 & WMASK) {
+			*d8++ = *s8++;
+			count--;
 		}
+		n = count / WSIZE;
+		copy_words_fwd((unsigned long *)d8, s8, n);
+		n *= WSIZE;
+		d8 += n;
+		s8 += n;
+		count -= n;
 	}
-	/* copy the reset one byte at a time */
-	d8 = (char *)dl;
-	s8 = (char *)sl;
+	/* copy the rest one byte at a time */
 	while (count--)
 		*d8++ = *s8++;
 
@@ -532,6 +615,47 @@ void * memcpy(void *dest, const void *src, size_t count)
 #endif
 
 #ifndef __HAVE_ARCH_MEMMOVE
+/*
+ * Copy 'nwords' words ending at 'src_end' to the words ending at the aligned
+ * 'dl_end' in descending order, see copy_words_fwd()
+ */
+static void copy_words_bwd(unsigned long *dl_end, const char *src_end,
+			   size_t nwords)
+{
+	unsigned long *dl = dl_end;
+	const unsigned long *sl;
+	unsigned long prev, next;
+	uint shift = 8 * ((ulong)src_end & WMASK);
+
+	if (!shift) {
+		sl = (const unsigned long *)src_end;
+		while (nwords >= 4) {
+			dl -= 4;
+			sl -= 4;
+			dl[3] = sl[3];
+			dl[2] = sl[2];
+			dl[1] = sl[1];
+			dl[0] = sl[0];
+			nwords -= 4;
+		}
+		while (nwords--)
+			*--dl = *--sl;
+		return;
+	}
+
+	sl = (const unsigned long *)((ulong)src_end & ~WMASK);
+	prev = *sl;
+	while (nwords >= 2) {
+		next = *--sl;
+		*--dl = merge_words(next, prev, shift);
+		prev = *--sl;
+		*--dl = merge_words(prev, next, shift);
+		nwords -= 2;
+	}
+	if (nwords)
+		*--dl = merge_words(*--sl, prev, shift);
+}
+
 /**
  * memmove - Copy one area of memory to another
  * @dest: Where to copy to
@@ -543,12 +667,26 @@ void * memcpy(void *dest, const void *src, size_t count)
 void * memmove(void * dest,const void *src,size_t count)
 {
 	char *tmp, *s;
+	size_t n;
 
 	if (dest <= src) {
 		memcpy(dest, src, count);
 	} else {
 		tmp = (char *) dest + count;
 		s = (char *) src + count;
+		/* align the end of the destination, then copy words */
+		if (count >= 2 * WSIZE) {
+			while ((ulong)tmp & WMASK) {
+				*--tmp = *--s;
+				count--;
+			}
+			n = count / WSIZE;
+			copy_words_bwd((unsigned long *)tmp, s, n);
+			n *= WSIZE;
+			tmp -= n;
+			s -= n;
+			count -= n;
+		}
 		while (count--)
 			*--tmp = *--s;
 		}
@@ -0,0 +1,173 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Zstandard decompression into a buffer, as used for images
+ */
+
+#include <common.h>
+#include <malloc.h>
+#include <memalign.h>
+#include <watchdog.h>
+#include <linux/errno.h>
+#include <linux/sizes.h>
+#include <linux/zstd.h>
+
+/*
+ * Limits on the buffer for compressed data in zstd_decompress_stream(). It
+ * must hold the largest block, plus the padding which keeps reads aligned.
+ * The largest size which fits in the heap is used, leaving room to read
+ * more data behind a block.
+ */
+#define ZSTD_STREAM_BUF_MIN	(ZSTD_BLOCKSIZE_ABSOLUTEMAX + ARCH_DMA_MINALIGN)
+#define ZSTD_STREAM_BUF_MAX	(ZSTD_STREAM_BUF_MIN + ZSTD_BLOCKSIZE_ABSOLUTEMAX)
+#define ZSTD_STREAM_BUF_STEP	(ZSTD_BLOCKSIZE_ABSOLUTEMAX / 4)
+
+int zstd_decompress(const void *src, size_t srcn, void *dst, size_t *dstn)
+{
+	ZSTD_DCtx *dctx;
+	void *workspace;
+	size_t wsize;
+	size_t ret;
+
+	/*
+	 * The whole output buffer is available, so decompress in one go
+	 * rather than streaming, which would need a window buffer and an
+	 * extra copy of everything
+	 */
+	wsize = ZSTD_DCtxWorkspaceBound();
+	workspace = malloc(wsize);
+	if (!workspace) {
+		debug("%s: cannot allocate workspace of size %zu\n", __func__,
+		      wsize);
+		return -ENOMEM;
+	}
+
+	dctx = ZSTD_initDCtx(workspace, wsize);
+	if (!dctx) {
+		free(workspace);
+		return -EINVAL;
+	}
+
+	/* This handles any number of concatenated frames */
+	ret = ZSTD_decompressDCtx(dctx, dst, *dstn, src, srcn);
+	free(workspace);
+
+	if (ZSTD_isError(ret)) {
+		debug("%s: ZSTD_decompressDCtx error %d\n", __func__,
+		      ZSTD_getErrorCode(ret));
+		/* Leave *dstn as is, so the caller can tell it ran out */
+		if (ZSTD_getErrorCode(ret) == ZSTD_error_dstSize_tooSmall)
+			return -ENOSPC;
+		*dstn = 0;
+		return -EINVAL;
+	}
+	*dstn = ret;
+
+	return 0;
+}
+
+int zstd_decompress_stream(void *dst, size_t *dstn,
+			   int (*read)(void *priv, void *buf, ulong len),
+			   void *priv)
+{
+	char *out = dst, *end = dst + *dstn;
+	ZSTD_DCtx *dctx;
+	void *workspace;
+	size_t wsize, need, ret;
+	char *buf = NULL, *pos;
+	ulong size, avail;
+	int len, err, code;
+
+	wsize = ZSTD_DCtxWorkspaceBound();
+	workspace = malloc(wsize);
+	if (!workspace)
+		return -ENOMEM;
+	for (size = ZSTD_STREAM_BUF_MAX; size >= ZSTD_STREAM_BUF_MIN;
+	     size -= ZSTD_STREAM_BUF_STEP) {
+		buf = malloc_cache_aligned(size);
+		if (buf)
+			break;
+	}
+	if (!buf) {
+		err = -ENOMEM;
+		goto out;
+	}
+	dctx = ZSTD_initDCtx(workspace, wsize);
+	if (!dctx) {
+		err = -EINVAL;
+		goto out;
+	}
+
+	/*
+	 * The bufferless API decompresses each block straight into @dst,
+	 * where earlier blocks stay available as the window. It wants exactly
+	 * the number of bytes it asks for, so keep the unused part of the
+	 * data read so far at the front of the buffer. It is placed so that
+	 * it ends on a cache-line boundary, where the next read then starts.
+	 */
+	ZSTD_decompressBegin(dctx);
+	avail = 0;
+	pos = buf;
+	for (;;) {
+		need = ZSTD_nextSrcSizeToDecompress(dctx);
+		if (need + ARCH_DMA_MINALIGN > size) {
+			debug("%s: %zu bytes needed at once\n", __func__, need);
+			err = -EINVAL;
+			goto out;
+		}
+
+		/* The end of a frame, which may be followed by another */
+		if (!need) {
+			if (!avail) {
+				len = read(priv, buf, size);
+				if (len <= 0) {
+					err = len;
+					goto out;
+				}
+				pos = buf;
+				avail = len;
+			}
+			ZSTD_decompressBegin(dctx);
+			continue;
+		}
+
+		if (avail < need) {
+			char *start = buf + (-avail & (ARCH_DMA_MINALIGN - 1));
+
+			memmove(start, pos, avail);
+			pos = start;
+			do {
+				len = read(priv, pos + avail,
+					   buf + size - pos - avail);
+				if (len <= 0) {
+					debug("%s: out of data\n", __func__);
+					err = len ? len : -EINVAL;
+					goto out;
+				}
+				avail += len;
+			} while (avail < need);
+		}
+
+		ret = ZSTD_decompressContinue(dctx, out, end - out, pos, need);
+		if (ZSTD_isError(ret)) {
+			code = ZSTD_getErrorCode(ret);
+			debug("%s: ZSTD_decompressContinue error %d\n",
+			      __func__, code);
+			if (code == ZSTD_error_dstSize_tooSmall)
+				err = -ENOSPC;
+			else
+				err = -EINVAL;
+			goto out;
+		}
+		out += ret;
+		pos += need;
+		avail -= need;
+		WATCHDOG_RESET();
+	}
+
+out:
+	*dstn = out - (char *)dst;
+	free(buf);
+	free(workspace);
+
+	return err;
+}
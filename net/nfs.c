@@ -28,6 +28,7 @@
 
 #include <common.h>
 #include <command.h>
+#include <image.h>
 #include <net.h>
 #include <malloc.h>
 #include <mapmem.h>
@@ -104,6 +105,7 @@ static inline int store_block(uchar *src, unsigned offset, unsigned len)
 		void *ptr = map_sysmem(load_addr + offset, len);
 
 		memcpy(ptr, src, len);
+		fit_hash_load_data(ptr, len);
 		unmap_sysmem(ptr);
 	}
 
@@ -904,6 +906,7 @@ void nfs_start(void)
 
 	nfs_timeout_count = 0;
 	nfs_state = STATE_PRCLOOKUP_PROG_MOUNT_REQ;
+	fit_hash_load_start(map_sysmem(load_addr, 0));
 
 	/*nfs_our_port = 4096 + (get_ticks() % 3072);*/
 	/*FIX ME !!!*/
@@ -9,6 +9,7 @@
 #include <common.h>
 #include <command.h>
 #include <efi_loader.h>
+#include <image.h>
 #include <mapmem.h>
 #include <net.h>
 #include <net/tftp.h>
@@ -140,6 +141,22 @@ static char tftp_filename[MAX_LEN];
 static unsigned short tftp_block_size = TFTP_BLOCK_SIZE;
 static unsigned short tftp_block_size_option = TFTP_MTU_BLOCKSIZE;
 
+/*
+ * RFC 7440 window size: the server sends this many blocks before waiting for
+ * our ACK. Blocks which arrive ahead of the next expected one are stored
+ * straight away and recorded in tftp_window_map, bit n meaning that block
+ * tftp_prev_block + 2 + n has been received.
+ */
+#define TFTP_WINDOWSIZE_MAX	64
+static unsigned short tftp_windowsize = 1;
+static unsigned short tftp_windowsize_option = CONFIG_TFTP_WINDOWSIZE;
+static u64	tftp_window_map;
+/* last block we acknowledged, the server's window starts after it */
+static ulong	tftp_last_ack;
+/* sequence number of the final (short) block, once it has been seen */
+static ulong	tftp_final_block;
+static bool	tftp_final_seen;
+
 static inline int store_block(int block, uchar *src, unsigned int len)
 {
 	ulong offset = block * tftp_block_size + tftp_block_wrap_offset;
@@ -179,6 +196,7 @@ static inline int store_block(int block, uchar *src, unsigned int len)
 #endif
 		ptr = map_sysmem(store_addr, len);
 		memcpy(ptr, src, len);
+		fit_hash_load_data(ptr, len);
 		unmap_sysmem(ptr);
 	}
 
@@ -194,6 +212,10 @@ static void new_transfer(void)
 	tftp_prev_block = 0;
 	tftp_block_wrap = 0;
 	tftp_block_wrap_offset = 0;
+	tftp_window_map = 0;
+	tftp_last_ack = 0;
+	tftp_final_seen = false;
+	fit_hash_load_start(map_sysmem(tftp_load_addr, 0));
 #ifdef CONFIG_CMD_TFTPPUT
 	tftp_put_final_block_sent = 0;
 #endif
@@ -346,6 +368,10 @@ static void tftp_send(void)
 		/* try for more effic. blk size */
 		pkt += sprintf((char *)pkt, "blksize%c%d%c",
 				0, tftp_block_size_option, 0);
+		/* and for more than one block per ACK */
+		if (tftp_state == STATE_SEND_RRQ && tftp_windowsize_option > 1)
+			pkt += sprintf((char *)pkt, "windowsize%c%d%c",
+					0, tftp_windowsize_option, 0);
 		len = pkt - xp;
 		break;
 
@@ -358,6 +384,7 @@ static void tftp_send(void)
 		s[0] = htons(TFTP_ACK);
 		s[1] = htons(tftp_cur_block);
 		pkt = (uchar *)(s + 2);
+		tftp_last_ack = tftp_cur_block;
 #ifdef CONFIG_CMD_TFTPPUT
 		if (tftp_put_active) {
 			int toload = tftp_block_size;
@@ -416,6 +443,7 @@ static void tftp_handler(uchar *pkt, unsigned dest, struct in_addr sip,
 {
 	__be16 proto;
 	__be16 *s;
+	ushort block, ahead;
 	int i;
 
 	if (dest != tftp_our_port) {
@@ -490,6 +518,16 @@ static void tftp_handler(uchar *pkt, unsigned dest, struct in_addr sip,
 				debug("Blocksize ack: %s, %d\n",
 				      (char *)pkt + i + 8, tftp_block_size);
 			}
+			if (strcmp((char *)pkt + i, "windowsize") == 0) {
+				tftp_windowsize = (unsigned short)
+					simple_strtoul((char *)pkt + i + 11,
+						       NULL, 10);
+				if (!tftp_windowsize ||
+				    tftp_windowsize > tftp_windowsize_option)
+					tftp_windowsize = 1;
+				debug("Windowsize ack: %s, %d\n",
+				      (char *)pkt + i + 11, tftp_windowsize);
+			}
 #ifdef CONFIG_TFTP_TSIZE
 			if (strcmp((char *)pkt+i, "tsize") == 0) {
 				tftp_tsize = simple_strtoul((char *)pkt + i + 6,
@@ -512,9 +550,7 @@ static void tftp_handler(uchar *pkt, unsigned dest, struct in_addr sip,
 		if (len < 2)
 			return;
 		len -= 2;
-		tftp_cur_block = ntohs(*(__be16 *)pkt);
-
-		update_block_number();
+		block = ntohs(*(__be16 *)pkt);
 
 		if (tftp_state == STATE_SEND_RRQ)
 			debug("Server did not acknowledge timeout option!\n");
@@ -526,39 +562,79 @@ static void tftp_handler(uchar *pkt, unsigned dest, struct in_addr sip,
 			tftp_remote_port = src;
 			new_transfer();
 
-			if (tftp_cur_block != 1) {	/* Assertion */
+			/* Blocks of the first window may arrive in any order */
+			if ((ushort)(block - 1) >= tftp_windowsize) {
 				puts("\nTFTP error: ");
-				printf("First block is not block 1 (%ld)\n",
-				       tftp_cur_block);
+				printf("First block is not block 1 (%d)\n",
+				       block);
 				puts("Starting again\n\n");
 				net_start_again();
 				break;
 			}
 		}
 
-		if (tftp_cur_block == tftp_prev_block) {
-			/* Same block again; ignore it. */
+		/*
+		 * Number of blocks between the next one we expect and this
+		 * one. Anything outside the window is a repeat of a block we
+		 * already have; ignore it.
+		 */
+		ahead = (ushort)(block - tftp_prev_block - 1);
+		if (ahead >= tftp_windowsize)
+			break;
+		if (ahead && (tftp_window_map & (1ULL << (ahead - 1))))
 			break;
-		}
 
-		tftp_prev_block = tftp_cur_block;
 		timeout_count_max = tftp_timeout_count_max;
 		net_set_timeout_handler(timeout_ms, tftp_timeout_handler);
 
-		if (store_block(tftp_cur_block - 1, pkt + 2, len)) {
+		/* Blocks are stored at their final place, whatever the order */
+		if (store_block(tftp_prev_block + ahead, pkt + 2, len)) {
 			eth_halt();
 			net_set_state(NETLOOP_FAIL);
 			break;
 		}
+		if (len < tftp_block_size) {
+			tftp_final_block = block;
+			tftp_final_seen = true;
+		}
 
-		/*
-		 *	Acknowledge the block just received, which will prompt
-		 *	the remote for the next one.
-		 */
-		tftp_send();
+		if (ahead) {
+			tftp_window_map |= 1ULL << (ahead - 1);
+		} else {
+			/* Move past this block and any received after it */
+			bool next;
+
+			do {
+				tftp_cur_block = (ushort)(tftp_prev_block + 1);
+				update_block_number();
+				tftp_prev_block = tftp_cur_block;
+				next = tftp_window_map & 1;
+				tftp_window_map >>= 1;
+			} while (next);
+		}
 
-		if (len < tftp_block_size)
+		if (tftp_final_seen && tftp_prev_block == tftp_final_block) {
+			tftp_send();
 			tftp_complete();
+			break;
+		}
+
+		/*
+		 * Acknowledge the window once every block up to its end has
+		 * arrived, which prompts the server for the next one. If the
+		 * server has sent its last block of the window (or the final
+		 * block) and some before it are missing, ACK the last block
+		 * received in order instead, so that the server resends from
+		 * the gap (RFC 7440 section 4).
+		 */
+		if (!ahead) {
+			if ((ushort)(tftp_cur_block - tftp_last_ack) >=
+			    tftp_windowsize)
+				tftp_send();
+		} else if (block == (ushort)(tftp_last_ack + tftp_windowsize) ||
+			   len < tftp_block_size) {
+			tftp_send();
+		}
 		break;
 
 	case TFTP_ERROR:
@@ -609,6 +685,7 @@ static int tftp_init_load_addr(void)
 	lmb_init_and_reserve(&lmb, gd->bd, (void *)gd->fdt_blob);
 
 	max_size = lmb_get_free_size(&lmb, load_addr);
+	lmb_release(&lmb);
 	if (!max_size)
 		return -1;
 
@@ -632,6 +709,23 @@ void tftp_start(enum proto_t protocol)
 	if (ep != NULL)
 		tftp_block_size_option = simple_strtol(ep, NULL, 10);
 
+	ep = env_get("tftpwindowsize");
+	if (ep != NULL) {
+		/* clamp before the value is narrowed to an unsigned short */
+		ulong windowsize = simple_strtoul(ep, NULL, 10);
+
+		if (windowsize < 1) {
+			printf("TFTP window size (%lu) too low, set min = 1\n",
+			       windowsize);
+			windowsize = 1;
+		} else if (windowsize > TFTP_WINDOWSIZE_MAX) {
+			printf("TFTP window size (%lu) too high, set max = %d\n",
+			       windowsize, TFTP_WINDOWSIZE_MAX);
+			windowsize = TFTP_WINDOWSIZE_MAX;
+		}
+		tftp_windowsize_option = windowsize;
+	}
+
 	ep = env_get("tftptimeout");
 	if (ep != NULL)
 		timeout_ms = simple_strtol(ep, NULL, 10);
@@ -653,8 +747,8 @@ void tftp_start(enum proto_t protocol)
 	}
 #endif
 
-	debug("TFTP blocksize = %i, timeout = %ld ms\n",
-	      tftp_block_size_option, timeout_ms);
+	debug("TFTP blocksize = %i, windowsize = %i, timeout = %ld ms\n",
+	      tftp_block_size_option, tftp_windowsize_option, timeout_ms);
 
 	tftp_remote_ip = net_server_ip;
 	if (!net_parse_bootfile(&tftp_remote_ip, tftp_filename, MAX_LEN)) {
@@ -753,8 +847,9 @@ void tftp_start(enum proto_t protocol)
 
 	/* zero out server ether in case the server ip has changed */
 	memset(net_server_ethaddr, 0, 6);
-	/* Revert tftp_block_size to dflt */
+	/* Revert tftp_block_size and tftp_windowsize to dflt */
 	tftp_block_size = TFTP_BLOCK_SIZE;
+	tftp_windowsize = 1;
 #ifdef CONFIG_TFTP_TSIZE
 	tftp_tsize = 0;
 	tftp_tsize_num_hash = 0;
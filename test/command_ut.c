@@ -11,9 +11,45 @@ static const char test_cmd[] = "setenv list 1\n setenv list ${list}2; "
 		"setenv list ${list}3\0"
 		"setenv list ${list}4";
 
+/* Check that find_cmd() agrees with a linear search for each abbreviation */
+static void test_find_cmd(void)
+{
+	cmd_tbl_t *start = ll_entry_start(cmd_tbl_t, cmd);
+	const int count = ll_entry_count(cmd_tbl_t, cmd);
+	cmd_tbl_t *cmdtp;
+	char name[32];
+	int len;
+
+	for (cmdtp = start; cmdtp != start + count; cmdtp++) {
+		strlcpy(name, cmdtp->name, sizeof(name));
+		for (len = strlen(name); len > 0; len--) {
+			name[len] = '\0';
+			assert(find_cmd(name) ==
+			       find_cmd_tbl(name, start, count));
+		}
+	}
+
+	assert(find_cmd("ut_cmd"));
+	assert(find_cmd("ut_c") == find_cmd("ut_cmd"));
+	assert(find_cmd("ut_cmd.b") == find_cmd("ut_cmd"));
+#ifdef CONFIG_CMD_HELP
+	/* "?" is out of order in the linker list */
+	assert(find_cmd("?"));
+	assert(find_cmd("?") != find_cmd("help"));
+#endif
+	assert(!find_cmd("non_existent_cmd"));
+	assert(!find_cmd(""));
+#ifdef CONFIG_UNIT_TEST
+	/* "ut" is a full match, even though "ut_cmd" starts with it */
+	assert(!strcmp("ut", find_cmd("ut")->name));
+	assert(!find_cmd("u"));
+#endif
+}
+
 static int do_ut_cmd(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[])
 {
 	printf("%s: Testing commands\n", __func__);
+	test_find_cmd();
 	run_command("env default -f -a", 0);
 
 	/* commands separated by \n */
@@ -5,6 +5,8 @@
 
 #include <common.h>
 #include <dm.h>
+#include <os.h>
+#include <sandboxblockdev.h>
 #include <usb.h>
 #include <asm/state.h>
 #include <dm/test.h>
@@ -162,3 +164,170 @@ static int dm_test_blk_get_from_parent(struct unit_test_state *uts)
 	return 0;
 }
 DM_TEST(dm_test_blk_get_from_parent, DM_TESTF_SCAN_PDATA | DM_TESTF_SCAN_FDT);
+
+#if CONFIG_IS_ENABLED(BLOCK_CACHE)
+/* Test the block cache with the sandbox host device */
+static int dm_test_blk_cache(struct unit_test_state *uts)
+{
+	const int blocks = 256;
+	struct block_cache_stats stats;
+	struct blk_desc *desc;
+	u8 *src, *dst;
+	int i;
+
+	src = malloc(blocks * 512);
+	dst = malloc(blocks * 512);
+	ut_assertnonnull(src);
+	ut_assertnonnull(dst);
+	for (i = 0; i < blocks * 512; i++)
+		src[i] = i ^ (i >> 9);
+	ut_assertok(os_write_file("blkcache.img", src, blocks * 512));
+	ut_assertok(host_dev_bind(0, "blkcache.img"));
+	ut_assertok(blk_get_device_by_str("host", "0", &desc));
+
+	/* Start with an empty cache of 32 pages of 8 blocks */
+	blkcache_configure(8, 32);
+	blkcache_set_readahead(32);
+
+	/* A miss reads the whole page, so the next block is a hit */
+	ut_asserteq(1, blk_dread(desc, 3, 1, dst));
+	ut_assertok(memcmp(src + 3 * 512, dst, 512));
+	ut_asserteq(1, blk_dread(desc, 4, 1, dst));
+	ut_assertok(memcmp(src + 4 * 512, dst, 512));
+	blkcache_stats(&stats);
+	ut_asserteq(1, stats.hits);
+	ut_asserteq(1, stats.misses);
+	ut_asserteq(0, stats.readahead_blocks);
+
+	/* Sequential reads trigger read-ahead of the following page */
+	ut_asserteq(3, blk_dread(desc, 5, 3, dst));
+	ut_asserteq(8, blk_dread(desc, 8, 8, dst));
+	ut_assertok(memcmp(src + 8 * 512, dst, 8 * 512));
+	ut_asserteq(8, blk_dread(desc, 16, 8, dst));
+	ut_assertok(memcmp(src + 16 * 512, dst, 8 * 512));
+	blkcache_stats(&stats);
+	ut_asserteq(2, stats.hits);
+	ut_asserteq(1, stats.misses);
+	ut_asserteq(8, stats.readahead_blocks);
+	ut_asserteq(8, stats.readahead_hits);
+	ut_asserteq(3, stats.entries);
+
+	/* Writes are visible to later reads, whether cached or not */
+	for (i = 0; i < 2 * 512; i++)
+		src[6 * 512 + i] = ~src[6 * 512 + i];
+	ut_asserteq(2, blk_dwrite(desc, 6, 2, src + 6 * 512));
+	ut_asserteq(16, blk_dread(desc, 0, 16, dst));
+	ut_assertok(memcmp(src, dst, 16 * 512));
+	ut_assertok(blkcache_flush(desc->if_type, desc->devnum));
+
+	/* Large reads bypass the cache */
+	ut_asserteq(blocks, blk_dread(desc, 0, blocks, dst));
+	ut_assertok(memcmp(src, dst, blocks * 512));
+	blkcache_stats(&stats);
+	ut_asserteq(0, stats.dirty);
+
+	ut_assertok(host_dev_bind(0, NULL));
+	blkcache_stats(&stats);
+	ut_asserteq(0, stats.entries);
+	blkcache_configure(8, CONFIG_BLOCK_CACHE_ENTRIES);
+	blkcache_set_readahead(CONFIG_BLOCK_CACHE_READAHEAD);
+	os_unlink("blkcache.img");
+	free(dst);
+	free(src);
+
+	return 0;
+}
+DM_TEST(dm_test_blk_cache, DM_TESTF_SCAN_PDATA | DM_TESTF_SCAN_FDT);
+#endif
+
+/* Test asynchronous requests with the sandbox host device */
+static int dm_test_blk_async(struct unit_test_state *uts)
+{
+	const int nreqs = HOST_BLK_QUEUE_DEPTH + 2;
+	const int blocks = 8;
+	struct blk_req req[nreqs];
+	struct blk_desc *desc;
+	struct udevice *dev;
+	u8 *src, *dst;
+	int i;
+
+	src = malloc(nreqs * blocks * 512);
+	dst = malloc(nreqs * blocks * 512);
+	ut_assertnonnull(src);
+	ut_assertnonnull(dst);
+	for (i = 0; i < nreqs * blocks * 512; i++)
+		src[i] = i ^ (i >> 9);
+	ut_assertok(os_write_file("blkasync.img", src, nreqs * blocks * 512));
+	ut_assertok(host_dev_bind(0, "blkasync.img"));
+	ut_assertok(blk_get_device(IF_TYPE_HOST, 0, &dev));
+	desc = dev_get_uclass_platdata(dev);
+
+	/* More requests than the device takes at once are queued */
+	memset(dst, '\0', nreqs * blocks * 512);
+	for (i = 0; i < nreqs; i++) {
+		req[i].op = BLK_REQ_READ;
+		req[i].start = i * blocks;
+		req[i].blkcnt = blocks;
+		req[i].buffer = dst + i * blocks * 512;
+		ut_assertok(blk_submit(dev, &req[i]));
+		ut_asserteq(-EINPROGRESS, req[i].status);
+	}
+
+	/* Each poll completes the oldest and starts the next queued one */
+	ut_asserteq(nreqs - 1, blk_poll(dev));
+	ut_assertok(req[0].status);
+	ut_assertok(memcmp(src, dst, blocks * 512));
+	ut_asserteq(-EINPROGRESS, req[1].status);
+
+	/* Waiting for the last one completes the others on the way */
+	ut_assertok(blk_wait(dev, &req[nreqs - 1]));
+	for (i = 0; i < nreqs; i++)
+		ut_assertok(req[i].status);
+	ut_asserteq(0, blk_poll(dev));
+	ut_assertok(memcmp(src, dst, nreqs * blocks * 512));
+
+	/* Writes reach the device */
+	for (i = 0; i < blocks * 512; i++)
+		src[blocks * 512 + i] = ~src[blocks * 512 + i];
+	req[0].op = BLK_REQ_WRITE;
+	req[0].start = blocks;
+	req[0].blkcnt = blocks;
+	req[0].buffer = src + blocks * 512;
+	ut_assertok(blk_submit(dev, &req[0]));
+	ut_assertok(blk_wait(dev, &req[0]));
+	ut_asserteq(blocks, blk_dread(desc, blocks, blocks, dst));
+	ut_assertok(memcmp(src + blocks * 512, dst, blocks * 512));
+
+	/* A synchronous read sees writes which are still in progress */
+	for (i = 0; i < nreqs * blocks * 512; i++)
+		src[i] = ~src[i];
+	for (i = 0; i < nreqs; i++) {
+		req[i].op = BLK_REQ_WRITE;
+		req[i].start = i * blocks;
+		req[i].blkcnt = blocks;
+		req[i].buffer = src + i * blocks * 512;
+		ut_assertok(blk_submit(dev, &req[i]));
+		ut_asserteq(-EINPROGRESS, req[i].status);
+	}
+	ut_asserteq(nreqs * blocks,
+		    blk_dread(desc, 0, nreqs * blocks, dst));
+	ut_assertok(memcmp(src, dst, nreqs * blocks * 512));
+	for (i = 0; i < nreqs; i++)
+		ut_assertok(req[i].status);
+	ut_asserteq(0, blk_poll(dev));
+
+	/* Reading beyond the end of the device fails */
+	req[0].op = BLK_REQ_READ;
+	req[0].start = nreqs * blocks;
+	req[0].buffer = dst;
+	ut_assertok(blk_submit(dev, &req[0]));
+	ut_asserteq(-EIO, blk_wait(dev, &req[0]));
+
+	ut_assertok(host_dev_bind(0, NULL));
+	os_unlink("blkasync.img");
+	free(dst);
+	free(src);
+
+	return 0;
+}
+DM_TEST(dm_test_blk_async, DM_TESTF_SCAN_PDATA | DM_TESTF_SCAN_FDT);
@@ -11,6 +11,7 @@
 #include <fdtdec.h>
 #include <malloc.h>
 #include <dm/device-internal.h>
+#include <dm/lists.h>
 #include <dm/root.h>
 #include <dm/util.h>
 #include <dm/test.h>
@@ -905,3 +906,37 @@ static int dm_test_inactive_child(struct unit_test_state *uts)
 	return 0;
 }
 DM_TEST(dm_test_inactive_child, DM_TESTF_SCAN_PDATA);
+
+#if CONFIG_IS_ENABLED(DM_COMPAT_INDEX)
+/* Check that the compatible index finds the same drivers as a full search */
+static int dm_test_compat_index(struct unit_test_state *uts)
+{
+	struct driver *driver = ll_entry_start(struct driver, driver);
+	const int n_ents = ll_entry_count(struct driver, driver);
+	const struct udevice_id *of_match, *id, *id_linear;
+	struct dm_compat_index *index = gd->dm_compat;
+	struct driver *drv, *entry, *linear;
+
+	ut_assertnonnull(index);
+	for (drv = driver; drv != driver + n_ents; drv++) {
+		for (of_match = drv->of_match;
+		     of_match && of_match->compatible; of_match++) {
+			const char *compat = of_match->compatible;
+
+			gd->dm_compat = NULL;
+			linear = lists_driver_lookup_compatible(compat,
+								&id_linear);
+			gd->dm_compat = index;
+			entry = lists_driver_lookup_compatible(compat, &id);
+			ut_assertnonnull(entry);
+			ut_asserteq_ptr(linear, entry);
+			ut_asserteq_ptr(id_linear, id);
+		}
+	}
+	ut_assertnull(lists_driver_lookup_compatible("denx,u-boot-nomatch",
+						     &id));
+
+	return 0;
+}
+DM_TEST(dm_test_compat_index, 0);
+#endif
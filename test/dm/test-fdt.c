@@ -728,6 +728,13 @@ static int dm_test_fdt_phandle(struct unit_test_state *uts)
 	ut_assertok(uclass_get_device_by_phandle(UCLASS_REGULATOR, back,
 						 "power-supply", &dev2));
 	ut_asserteq_ptr(dev, dev2);
+	ut_assertok(uclass_get_device_by_phandle_id(UCLASS_REGULATOR,
+						    dev_read_phandle(dev),
+						    &dev2));
+	ut_asserteq_ptr(dev, dev2);
+	ut_asserteq(-ENODEV, uclass_get_device_by_phandle_id(UCLASS_REGULATOR,
+							     0x12345678,
+							     &dev2));
 
 	return 0;
 }
@@ -794,3 +801,104 @@ static int dm_test_read_int(struct unit_test_state *uts)
 	return 0;
 }
 DM_TEST(dm_test_read_int, DM_TESTF_SCAN_PDATA | DM_TESTF_SCAN_FDT);
+
+/* Number of nodes in the tree for the phandle test, 2 in 3 with a phandle */
+#define PHANDLE_TEST_NODES	3000
+#define PHANDLE_TEST_SIZE	0x40000
+
+/* Scattered phandle of node @i, unique since 7919 and 65521 are prime */
+static u32 phandle_test_value(int i)
+{
+	return i * 7919 % 65521 + 1;
+}
+
+static int phandle_test_check(struct unit_test_state *uts, const void *blob)
+{
+	int i, offset;
+	u32 phandle;
+
+	for (i = 0; i < PHANDLE_TEST_NODES; i++) {
+		if (!(i % 3))
+			continue;
+		phandle = phandle_test_value(i);
+		offset = fdtdec_node_offset_by_phandle(blob, phandle);
+		ut_assert(offset > 0);
+		ut_asserteq(fdt_node_offset_by_phandle(blob, phandle), offset);
+		ut_asserteq(i, fdtdec_get_int(blob, offset, "reg", -1));
+	}
+
+	return 0;
+}
+
+/* Test looking up phandles in a large flat tree, and how long it takes */
+static int dm_test_fdt_phandle_cache(struct unit_test_state *uts)
+{
+	ulong start, scan_us, cache_us;
+	char name[20];
+	int i, offset;
+	u32 phandle;
+	void *blob;
+
+	blob = malloc(PHANDLE_TEST_SIZE);
+	ut_assertnonnull(blob);
+	ut_assertok(fdt_create(blob, PHANDLE_TEST_SIZE));
+	ut_assertok(fdt_finish_reservemap(blob));
+	ut_assertok(fdt_begin_node(blob, ""));
+	for (i = 0; i < PHANDLE_TEST_NODES; i++) {
+		snprintf(name, sizeof(name), "node@%x", i);
+		ut_assertok(fdt_begin_node(blob, name));
+		ut_assertok(fdt_property_u32(blob, "reg", i));
+		if (i % 3)
+			ut_assertok(fdt_property_u32(blob, "phandle",
+						     phandle_test_value(i)));
+		ut_assertok(fdt_end_node(blob));
+	}
+	ut_assertok(fdt_end_node(blob));
+	ut_assertok(fdt_finish(blob));
+	ut_assertok(fdt_open_into(blob, blob, PHANDLE_TEST_SIZE));
+
+	start = timer_get_us();
+	for (i = 1; i < PHANDLE_TEST_NODES; i += 3) {
+		phandle = phandle_test_value(i);
+		ut_assert(fdt_node_offset_by_phandle(blob, phandle) > 0);
+	}
+	scan_us = timer_get_us() - start;
+
+	start = timer_get_us();
+	for (i = 1; i < PHANDLE_TEST_NODES; i += 3) {
+		phandle = phandle_test_value(i);
+		ut_assert(fdtdec_node_offset_by_phandle(blob, phandle) > 0);
+	}
+	cache_us = timer_get_us() - start;
+	printf("%d phandle lookups: scanning %lu us, cached %lu us\n",
+	       PHANDLE_TEST_NODES / 3, scan_us, cache_us);
+
+	ut_assertok(phandle_test_check(uts, blob));
+	ut_asserteq(-FDT_ERR_NOTFOUND,
+		    fdtdec_node_offset_by_phandle(blob, 0x12345678));
+	ut_asserteq(-FDT_ERR_BADPHANDLE,
+		    fdtdec_node_offset_by_phandle(blob, 0));
+
+	/* Adding a node moves all the others */
+	offset = fdt_add_subnode(blob, 0, "first");
+	ut_assert(offset > 0);
+	ut_assertok(fdt_setprop_u32(blob, offset, "reg", -1));
+	ut_assertok(fdtdec_set_phandle(blob, offset, 0x12345678));
+	ut_asserteq(offset, fdtdec_node_offset_by_phandle(blob, 0x12345678));
+	ut_assertok(phandle_test_check(uts, blob));
+
+	/* Changing a phandle in place leaves the size of the tree as it is */
+	offset = fdtdec_node_offset_by_phandle(blob, 0x12345678);
+	ut_assertok(fdt_setprop_inplace_u32(blob, offset, "phandle",
+					    0x12345679));
+	ut_asserteq(-FDT_ERR_NOTFOUND,
+		    fdtdec_node_offset_by_phandle(blob, 0x12345678));
+	ut_asserteq(offset, fdtdec_node_offset_by_phandle(blob, 0x12345679));
+	ut_assertok(phandle_test_check(uts, blob));
+
+	fdtdec_phandle_cache_invalidate(blob);
+	free(blob);
+
+	return 0;
+}
+DM_TEST(dm_test_fdt_phandle_cache, 0);
@@ -49,6 +49,9 @@ DM_TEST(dm_test_video_base, DM_TESTF_SCAN_PDATA | DM_TESTF_SCAN_FDT);
  * size of the compressed data. This provides a pretty good level of
  * certainty and the resulting tests need only check a single value.
  *
+ * If the device draws into a shadow frame buffer, this also checks that the
+ * hardware frame buffer matches it after a sync.
+ *
  * @dev:	Video device
  * @return compressed size of the frame buffer, or -ve on error
  */
@@ -59,6 +62,12 @@ static int compress_frame_buffer(struct udevice *dev)
 	void *dest;
 	int ret;
 
+	if (priv->copy_fb) {
+		video_sync(dev, true);
+		if (memcmp(priv->fb, priv->copy_fb, priv->fb_size))
+			return -EIO;
+	}
+
 	destlen = priv->fb_size;
 	dest = malloc(priv->fb_size);
 	if (!dest)
@@ -374,3 +383,27 @@ static int dm_test_video_truetype_bs(struct unit_test_state *uts)
 	return 0;
 }
 DM_TEST(dm_test_video_truetype_bs, DM_TESTF_SCAN_PDATA | DM_TESTF_SCAN_FDT);
+
+/* Scroll the text console a long way and report how long it took */
+static int dm_test_video_scroll_speed(struct unit_test_state *uts)
+{
+	const char *line = "The quick brown fox jumps over the lazy dog\n";
+	struct udevice *dev, *con;
+	ulong start;
+	int i;
+
+	ut_assertok(select_vidconsole(uts, "vidconsole0"));
+	ut_assertok(uclass_get_device(UCLASS_VIDEO, 0, &dev));
+	ut_assertok(uclass_get_device(UCLASS_VIDEO_CONSOLE, 0, &con));
+
+	start = get_timer(0);
+	for (i = 0; i < 1000; i++)
+		vidconsole_put_string(con, line);
+	printf("Scrolling 1000 lines took %lu ms\n", get_timer(start));
+
+	/* Any difference between the shadow and the hardware shows up here */
+	ut_assert(compress_frame_buffer(dev) > 0);
+
+	return 0;
+}
+DM_TEST(dm_test_video_scroll_speed, DM_TESTF_SCAN_PDATA | DM_TESTF_SCAN_FDT);
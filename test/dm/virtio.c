@@ -4,6 +4,7 @@
  */
 
 #include <common.h>
+#include <blk.h>
 #include <dm.h>
 #include <virtio_types.h>
 #include <virtio.h>
@@ -13,6 +14,7 @@
 #include <dm/root.h>
 #include <dm/test.h>
 #include <test/ut.h>
+#include "../../drivers/virtio/virtio_blk.h"
 
 /* Basic test of the virtio uclass */
 static int dm_test_virtio_base(struct unit_test_state *uts)
@@ -71,7 +73,10 @@ static int dm_test_virtio_all_ops(struct unit_test_state *uts)
 	ut_assertok(virtio_get_status(dev, &status));
 	ut_asserteq(0, status);
 	ut_assertok(virtio_get_features(dev, &features));
-	ut_asserteq(VIRTIO_F_VERSION_1, features);
+	ut_assert(features == ((1ULL << VIRTIO_F_VERSION_1) |
+			       (1ULL << VIRTIO_RING_F_INDIRECT_DESC) |
+			       (1ULL << VIRTIO_BLK_F_SIZE_MAX) |
+			       (1ULL << VIRTIO_BLK_F_SEG_MAX)));
 	ut_assertok(virtio_set_features(dev));
 	ut_assertok(virtio_find_vqs(dev, nvqs, vqs));
 	ut_assertok(virtio_del_vqs(dev));
@@ -120,3 +125,71 @@ static int dm_test_virtio_remove(struct unit_test_state *uts)
 	return 0;
 }
 DM_TEST(dm_test_virtio_remove, DM_TESTF_SCAN_PDATA | DM_TESTF_SCAN_FDT);
+
+/* Test reads and writes through the sandbox virtio block device */
+static int dm_test_virtio_blk(struct unit_test_state *uts)
+{
+	const int blocks = 128;
+	struct virtio_dev_priv *uc_priv;
+	struct udevice *bus, *dev;
+	struct blk_desc *desc;
+	struct virtqueue *vq;
+	struct blk_req req;
+	u8 *src, *dst;
+	int i;
+
+	ut_assertok(uclass_first_device(UCLASS_VIRTIO, &bus));
+	ut_assertok(device_find_first_child(bus, &dev));
+	ut_assertok(device_probe(dev));
+	desc = dev_get_uclass_platdata(dev);
+	ut_asserteq(2048, desc->lba);
+
+	/* The ring has room for four descriptors */
+	uc_priv = dev_get_uclass_priv(bus);
+	vq = list_first_entry(&uc_priv->vqs, struct virtqueue, list);
+	ut_asserteq(4, virtqueue_get_vring_size(vq));
+	ut_assert(virtio_has_feature(dev, VIRTIO_RING_F_INDIRECT_DESC));
+
+	src = malloc(blocks * 512);
+	dst = malloc(blocks * 512);
+	ut_assertnonnull(src);
+	ut_assertnonnull(dst);
+	for (i = 0; i < blocks * 512; i++)
+		src[i] = i ^ (i >> 9);
+
+	/* Transfers much larger than one request go through */
+	ut_asserteq(blocks, blk_dwrite(desc, 100, blocks, src));
+	memset(dst, '\0', blocks * 512);
+	ut_asserteq(blocks, blk_dread(desc, 100, blocks, dst));
+	ut_assertok(memcmp(src, dst, blocks * 512));
+
+	/*
+	 * The device takes 16KiB in a request. With indirect descriptors, all
+	 * four requests of a 64KiB read are on the ring together.
+	 */
+	memset(dst, '\0', blocks * 512);
+	req.op = BLK_REQ_READ;
+	req.start = 100;
+	req.blkcnt = blocks;
+	req.buffer = dst;
+	ut_assertok(blk_submit(dev, &req));
+	ut_asserteq(0, vq->num_free);
+	ut_asserteq(4, virtio16_to_cpu(dev, vq->vring.used->idx) -
+		    vq->last_used_idx);
+	ut_assertok(blk_wait(dev, &req));
+	ut_asserteq(4, vq->num_free);
+	ut_assertok(memcmp(src, dst, blocks * 512));
+
+	/* Reading beyond the end of the device fails */
+	ut_assert(blk_dread(desc, desc->lba - 1, 2, dst) != 2);
+	req.start = desc->lba - 1;
+	req.blkcnt = 2;
+	ut_assertok(blk_submit(dev, &req));
+	ut_asserteq(-EIO, blk_wait(dev, &req));
+
+	free(dst);
+	free(src);
+
+	return 0;
+}
+DM_TEST(dm_test_virtio_blk, DM_TESTF_SCAN_PDATA | DM_TESTF_SCAN_FDT);
@@ -13,6 +13,7 @@
 
 #define SIZE 32
 #define ITERATIONS 10000
+#define HTAB_LONG_VALUE 2048
 
 static int htab_fill(struct unit_test_state *uts,
 		     struct hsearch_data *htab, size_t size)
@@ -123,3 +124,124 @@ static int env_test_htab_deletes(struct unit_test_state *uts)
 }
 
 ENV_TEST(env_test_htab_deletes, 0);
+
+/* Fill a small table well beyond its initial size, so that it has to grow */
+static int env_test_htab_grow(struct unit_test_state *uts)
+{
+	struct hsearch_data htab;
+
+	memset(&htab, 0, sizeof(htab));
+	ut_asserteq(1, hcreate_r(SIZE, &htab));
+
+	ut_assertok(htab_fill(uts, &htab, SIZE * 100));
+	ut_assertok(htab_check_fill(uts, &htab, SIZE * 100));
+	ut_asserteq(SIZE * 100, htab.filled);
+	ut_assert(htab.size > SIZE * 100);
+
+	hdestroy_r(&htab);
+	return 0;
+}
+
+ENV_TEST(env_test_htab_grow, 0);
+
+/* Overwrite values with shorter and longer ones */
+static int env_test_htab_overwrite(struct unit_test_state *uts)
+{
+	struct hsearch_data htab;
+	char value[HTAB_LONG_VALUE];
+	ENTRY item;
+	ENTRY *ritem;
+
+	memset(&htab, 0, sizeof(htab));
+	ut_asserteq(1, hcreate_r(SIZE, &htab));
+	ut_assertok(htab_fill(uts, &htab, SIZE));
+
+	item.callback = NULL;
+	item.flags = 0;
+	item.key = "3";
+	item.data = "a much longer value";
+	ut_assert(hsearch_r(item, ENTER, &ritem, &htab, 0) > 0);
+	ut_asserteq_str("a much longer value", ritem->data);
+
+	item.data = "short";
+	ut_assert(hsearch_r(item, ENTER, &ritem, &htab, 0) > 0);
+	ut_asserteq_str("short", ritem->data);
+
+	memset(value, 'x', sizeof(value) - 1);
+	value[sizeof(value) - 1] = '\0';
+	item.data = value;
+	ut_assert(hsearch_r(item, ENTER, &ritem, &htab, 0) > 0);
+	ut_asserteq_str(value, ritem->data);
+
+	item.data = NULL;
+	hsearch_r(item, FIND, &ritem, &htab, 0);
+	ut_assert(ritem);
+	ut_asserteq_str(value, ritem->data);
+	ut_asserteq(SIZE, htab.filled);
+
+	hdestroy_r(&htab);
+	return 0;
+}
+
+ENV_TEST(env_test_htab_overwrite, 0);
+
+static int htab_bench(struct unit_test_state *uts, int count)
+{
+	struct hsearch_data htab;
+	ulong start, imp, exp, find;
+	char *env, *res = NULL;
+	ENTRY item;
+	ENTRY *ritem;
+	char key[20];
+	size_t len;
+	int i;
+
+	/* build an exported environment of "varN=valueN" pairs */
+	env = malloc(count * 32 + 1);
+	ut_assertnonnull(env);
+	for (i = 0, len = 0; i < count; i++)
+		len += sprintf(env + len, "var%d=value%d", i, i) + 1;
+	env[len++] = '\0';
+
+	memset(&htab, 0, sizeof(htab));
+	start = timer_get_us();
+	ut_asserteq(1, himport_r(&htab, env, len, '\0', 0, 0, 0, NULL));
+	imp = timer_get_us() - start;
+	ut_asserteq(count, htab.filled);
+
+	start = timer_get_us();
+	ut_asserteq(len, hexport_r(&htab, '\0', 0, &res, 0, 0, NULL));
+	exp = timer_get_us() - start;
+
+	item.callback = NULL;
+	item.flags = 0;
+	item.data = NULL;
+	item.key = key;
+	start = timer_get_us();
+	for (i = 0; i < count; i++) {
+		sprintf(key, "var%d", i);
+		hsearch_r(item, FIND, &ritem, &htab, 0);
+		ut_assert(ritem);
+	}
+	find = timer_get_us() - start;
+
+	printf("%6d vars: import %7lu us, export %7lu us, search %7lu us\n",
+	       count, imp, exp, find);
+
+	free(res);
+	free(env);
+	hdestroy_r(&htab);
+	return 0;
+}
+
+/* Measure himport_r(), hexport_r() and hsearch_r() on growing tables */
+static int env_test_htab_bench(struct unit_test_state *uts)
+{
+	ut_assertok(htab_bench(uts, 100));
+	ut_assertok(htab_bench(uts, 1000));
+	ut_assertok(htab_bench(uts, 10000));
+
+	return 0;
+}
+
+ENV_TEST(env_test_htab_bench, 0);
@@ -5,6 +5,8 @@
 
 # Invoke this test script from U-Boot base directory as ./test/fs/fs-test.sh
 # It currently tests the fs/sb and native commands for ext4 and fat partitions
+# Invoke it as ./test/fs/fs-test.sh perf to report the load throughput of
+# each file system instead of running the tests.
 # Expected results are as follows:
 # EXT4 tests:
 # fs-test.sb.ext4	Summary: PASS: 24 FAIL: 0
@@ -44,6 +46,9 @@ SMALL_FILE="1MB.file"
 # $BIG_FILE is the name of the 2.5GB file in the file system image
 BIG_FILE="2.5GB.file"
 
+# $PERF_LENGTH is the number of bytes read from the big file in perf mode
+PERF_LENGTH=$((64 * 1024 * 1024))
+
 # $MD5_FILE will have the expected md5s when we do the test
 # They shall have a suffix which represents their file system (ext4/fat16/...)
 MD5_FILE="${OUT_DIR}/md5s.list"
@@ -538,6 +543,41 @@ function check_results() {
 	echo "** End $1"
 }
 
+# 1st parameter is image file
+# 2nd parameter is file system type - fat16/ext4/...
+# 3rd parameter is name of big file
+# Loads $PERF_LENGTH bytes of the big file with the generic load command,
+# from its start and from across the 2GB boundary, to an aligned and to a
+# misaligned address, and prints the throughput of each load.
+function perf_image() {
+	case "$2" in
+		fat*)
+		FPATH=""
+		;;
+		*)
+		FPATH="/"
+		;;
+	esac
+	length=`printf "0x%x" $PERF_LENGTH`
+
+	for offset in 0x0 0x7ff00000; do
+		for addr in 0x01000000 0x01000008; do
+			cmd="host bind 0 $1; load host 0:0 $addr ${FPATH}$3"
+			out=`$UBOOT -c "$cmd $length $offset" | \
+				grep "bytes read in"`
+			bytes=`echo "$out" | sed -e 's/ bytes read in .*//'`
+			ms=`echo "$out" | sed -e 's/.* in \([0-9]*\) ms.*/\1/'`
+			if [ "$bytes" != "$PERF_LENGTH" ]; then
+				echo "$2: load at $addr from $offset FAILED"
+				continue
+			fi
+			[ "$ms" -eq 0 ] && ms=1
+			echo "$2: load at $addr from $offset:" \
+				"$((bytes * 1000 / ms / 1048576)) MB/s"
+		done
+	done
+}
+
 # Takes in one parameter which is "fs" or "nonfs", which then dictates
 # if a fs test (size/load/save) or a nonfs test (fatread/extread) needs to
 # be performed.
@@ -587,6 +627,12 @@ for fs in ext4 fat16 fat32; do
 	echo "Creating files in $fs image if not already present."
 	create_files $IMAGE $MD5_FILE_FS
 
+	if [ "$1" = "perf" ]; then
+		perf_image $IMAGE $fs $BIG_FILE
+		echo "--------------------------------------------"
+		continue
+	fi
+
 	# Lets mount the image and test host hostfs commands
 	mkdir -p "$MOUNT_DIR"
 	case "$fs" in
@@ -616,6 +662,10 @@ for fs in ext4 fat16 fat32; do
 	test_fs_nonfs fs
 done
 
+if [ "$1" = "perf" ]; then
+	exit 0
+fi
+
 echo "Total Summary: TOTAL PASS: $TOTAL_PASS TOTAL FAIL: $TOTAL_FAIL"
 echo "--------------------------------------------"
 if [ $TOTAL_FAIL -eq 0 ]; then
@@ -0,0 +1,146 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Unit tests for crc32()
+ *
+ * crc32() may be table driven, slice-by-8 or use CPU instructions, all of
+ * which handle the head, body and tail of a buffer differently depending on
+ * its alignment and length. They are all checked against a bit at a time
+ * reference implementation.
+ */
+
+#include <common.h>
+#include <malloc.h>
+#include <linux/sizes.h>
+#include <u-boot/crc.h>
+#include <test/lib.h>
+#include <test/test.h>
+#include <test/ut.h>
+
+/* Number of different alignment values */
+#define SWEEP 8
+/* Longest buffer checked with each alignment */
+#define MAXLEN 80
+/* Bytes hashed per measurement by lib_crc32_bench() */
+#define BENCH_TOTAL SZ_64M
+
+/**
+ * crc32_ref() - bit at a time crc32()
+ *
+ * @crc:	initial value
+ * @p:		data
+ * @len:	length of the data
+ * Return:	crc32 of the data
+ */
+static u32 crc32_ref(u32 crc, const u8 *p, uint len)
+{
+	int k;
+
+	crc = ~crc;
+	while (len--) {
+		crc ^= *p++;
+		for (k = 0; k < 8; k++)
+			crc = crc & 1 ? (crc >> 1) ^ 0xedb88320 : crc >> 1;
+	}
+
+	return ~crc;
+}
+
+/**
+ * init_buffer() - fill a buffer with pseudo random bytes
+ *
+ * @buf:	buffer
+ * @len:	length of the buffer
+ */
+static void init_buffer(u8 *buf, uint len)
+{
+	u32 x = 0x12345678;
+
+	while (len--) {
+		x = x * 1103515245 + 12345;
+		*buf++ = x >> 24;
+	}
+}
+
+/**
+ * lib_crc32() - unit test for crc32() and crc32_no_comp()
+ *
+ * @uts:	unit test state
+ * Return:	0 = success, 1 = failure
+ */
+static int lib_crc32(struct unit_test_state *uts)
+{
+	u8 buf[SWEEP + MAXLEN];
+	u32 crc;
+	int off, len, split;
+
+	init_buffer(buf, sizeof(buf));
+
+	/* check value of the CRC-32 catalogue */
+	ut_asserteq(0xcbf43926, crc32(0, (u8 *)"123456789", 9));
+	ut_asserteq(0, crc32(0, buf, 0));
+
+	for (off = 0; off < SWEEP; off++) {
+		for (len = 0; len <= MAXLEN; len++) {
+			crc = crc32_ref(0, buf + off, len);
+			ut_asserteq(crc, crc32(0, buf + off, len));
+
+			/* the crc must not depend on how the data is split */
+			split = len / 3;
+			ut_asserteq(crc, crc32(crc32(0, buf + off, split),
+					       buf + off + split, len - split));
+
+			ut_asserteq(crc32_ref(~0x5a5a5a5a, buf + off, len) ^
+				    0xffffffff,
+				    crc32_no_comp(0x5a5a5a5a, buf + off, len));
+		}
+	}
+
+	return 0;
+}
+
+LIB_TEST(lib_crc32, 0);
+
+#ifdef CONFIG_UT_LIB_BENCH
+/**
+ * lib_crc32_bench() - report crc32() throughput
+ *
+ * MiB/s are approximated as bytes per microsecond.
+ *
+ * @uts:	unit test state
+ * Return:	0 = success, 1 = failure
+ */
+static int lib_crc32_bench(struct unit_test_state *uts)
+{
+	static const uint lens[] = { 64, SZ_4K, SZ_1M };
+	ulong start, time;
+	u32 crc;
+	int i, j, loops;
+	u8 *buf;
+
+	buf = malloc(SZ_1M);
+	ut_assertnonnull(buf);
+	init_buffer(buf, SZ_1M);
+
+	start = timer_get_us();
+	crc = crc32_ref(0, buf, SZ_1M);
+	time = timer_get_us() - start;
+	printf("%8u bytes: reference %5lu MiB/s\n", SZ_1M,
+	       SZ_1M / max(time, 1UL));
+	ut_asserteq(crc, crc32(0, buf, SZ_1M));
+
+	for (i = 0; i < ARRAY_SIZE(lens); i++) {
+		loops = BENCH_TOTAL / lens[i];
+		start = timer_get_us();
+		for (j = 0; j < loops; j++)
+			crc = crc32(crc, buf, lens[i]);
+		time = timer_get_us() - start;
+		printf("%8u bytes: crc32 %5lu MiB/s\n", lens[i],
+		       BENCH_TOTAL / max(time, 1UL));
+	}
+
+	free(buf);
+	return 0;
+}
+
+LIB_TEST(lib_crc32_bench, 0);
+#endif
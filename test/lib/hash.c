@@ -0,0 +1,469 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Unit tests for the hash algorithms in common/hash.c
+ *
+ * The SHA family may hash several blocks at a time, possibly using CPU
+ * instructions, so it is checked against the FIPS 180 examples and with
+ * updates that start and end anywhere in a block. Algorithms which are not
+ * enabled are skipped. The digests calculated while a FIT is being loaded
+ * are checked against the ones calculated afterwards.
+ */
+
+#include <common.h>
+#include <hash.h>
+#include <hexdump.h>
+#include <image.h>
+#include <malloc.h>
+#include <mapmem.h>
+#include <linux/sizes.h>
+#include <test/lib.h>
+#include <test/test.h>
+#include <test/ut.h>
+#include <u-boot/sha256.h>
+
+/* Longest buffer checked with split progressive updates */
+#define MAXLEN 400
+/* Bytes hashed per measurement by lib_hash_bench() */
+#define BENCH_TOTAL SZ_32M
+/* Size of the FIT header and the image in lib_hash_fit_load() */
+#define FIT_HDR_SIZE SZ_4K
+#define FIT_DATA_SIZE 100000
+/* Size of each piece of the FIT that is stored, as in a TFTP packet */
+#define FIT_PIECE_SIZE 1468
+
+struct hash_kat {
+	const char *algo;
+	const char *msg;
+	/* message is repeated this often, 0 means once */
+	uint repeat;
+	u8 digest[64];
+};
+
+static const struct hash_kat hash_kats[] = {
+	{ "sha1", "abc", 0,
+	  { 0xa9, 0x99, 0x3e, 0x36, 0x47, 0x06, 0x81, 0x6a, 0xba, 0x3e,
+	    0x25, 0x71, 0x78, 0x50, 0xc2, 0x6c, 0x9c, 0xd0, 0xd8, 0x9d } },
+	{ "sha1", "abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq", 0,
+	  { 0x84, 0x98, 0x3e, 0x44, 0x1c, 0x3b, 0xd2, 0x6e, 0xba, 0xae,
+	    0x4a, 0xa1, 0xf9, 0x51, 0x29, 0xe5, 0xe5, 0x46, 0x70, 0xf1 } },
+	{ "sha1", "a", 1000000,
+	  { 0x34, 0xaa, 0x97, 0x3c, 0xd4, 0xc4, 0xda, 0xa4, 0xf6, 0x1e,
+	    0xeb, 0x2b, 0xdb, 0xad, 0x27, 0x31, 0x65, 0x34, 0x01, 0x6f } },
+	{ "sha256", "abc", 0,
+	  { 0xba, 0x78, 0x16, 0xbf, 0x8f, 0x01, 0xcf, 0xea, 0x41, 0x41,
+	    0x40, 0xde, 0x5d, 0xae, 0x22, 0x23, 0xb0, 0x03, 0x61, 0xa3,
+	    0x96, 0x17, 0x7a, 0x9c, 0xb4, 0x10, 0xff, 0x61, 0xf2, 0x00,
+	    0x15, 0xad } },
+	{ "sha256", "abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq",
+	  0,
+	  { 0x24, 0x8d, 0x6a, 0x61, 0xd2, 0x06, 0x38, 0xb8, 0xe5, 0xc0,
+	    0x26, 0x93, 0x0c, 0x3e, 0x60, 0x39, 0xa3, 0x3c, 0xe4, 0x59,
+	    0x64, 0xff, 0x21, 0x67, 0xf6, 0xec, 0xed, 0xd4, 0x19, 0xdb,
+	    0x06, 0xc1 } },
+	{ "sha256", "a", 1000000,
+	  { 0xcd, 0xc7, 0x6e, 0x5c, 0x99, 0x14, 0xfb, 0x92, 0x81, 0xa1,
+	    0xc7, 0xe2, 0x84, 0xd7, 0x3e, 0x67, 0xf1, 0x80, 0x9a, 0x48,
+	    0xa4, 0x97, 0x20, 0x0e, 0x04, 0x6d, 0x39, 0xcc, 0xc7, 0x11,
+	    0x2c, 0xd0 } },
+	{ "sha384", "abc", 0,
+	  { 0xcb, 0x00, 0x75, 0x3f, 0x45, 0xa3, 0x5e, 0x8b, 0xb5, 0xa0,
+	    0x3d, 0x69, 0x9a, 0xc6, 0x50, 0x07, 0x27, 0x2c, 0x32, 0xab,
+	    0x0e, 0xde, 0xd1, 0x63, 0x1a, 0x8b, 0x60, 0x5a, 0x43, 0xff,
+	    0x5b, 0xed, 0x80, 0x86, 0x07, 0x2b, 0xa1, 0xe7, 0xcc, 0x23,
+	    0x58, 0xba, 0xec, 0xa1, 0x34, 0xc8, 0x25, 0xa7 } },
+	{ "sha384", "abcdefghbcdefghicdefghijdefghijkefghijklfghijklmghijklmn"
+	  "hijklmnoijklmnopjklmnopqklmnopqrlmnopqrsmnopqrstnopqrstu", 0,
+	  { 0x09, 0x33, 0x0c, 0x33, 0xf7, 0x11, 0x47, 0xe8, 0x3d, 0x19,
+	    0x2f, 0xc7, 0x82, 0xcd, 0x1b, 0x47, 0x53, 0x11, 0x1b, 0x17,
+	    0x3b, 0x3b, 0x05, 0xd2, 0x2f, 0xa0, 0x80, 0x86, 0xe3, 0xb0,
+	    0xf7, 0x12, 0xfc, 0xc7, 0xc7, 0x1a, 0x55, 0x7e, 0x2d, 0xb9,
+	    0x66, 0xc3, 0xe9, 0xfa, 0x91, 0x74, 0x60, 0x39 } },
+	{ "sha512", "abc", 0,
+	  { 0xdd, 0xaf, 0x35, 0xa1, 0x93, 0x61, 0x7a, 0xba, 0xcc, 0x41,
+	    0x73, 0x49, 0xae, 0x20, 0x41, 0x31, 0x12, 0xe6, 0xfa, 0x4e,
+	    0x89, 0xa9, 0x7e, 0xa2, 0x0a, 0x9e, 0xee, 0xe6, 0x4b, 0x55,
+	    0xd3, 0x9a, 0x21, 0x92, 0x99, 0x2a, 0x27, 0x4f, 0xc1, 0xa8,
+	    0x36, 0xba, 0x3c, 0x23, 0xa3, 0xfe, 0xeb, 0xbd, 0x45, 0x4d,
+	    0x44, 0x23, 0x64, 0x3c, 0xe8, 0x0e, 0x2a, 0x9a, 0xc9, 0x4f,
+	    0xa5, 0x4c, 0xa4, 0x9f } },
+	{ "sha512", "abcdefghbcdefghicdefghijdefghijkefghijklfghijklmghijklmn"
+	  "hijklmnoijklmnopjklmnopqklmnopqrlmnopqrsmnopqrstnopqrstu", 0,
+	  { 0x8e, 0x95, 0x9b, 0x75, 0xda, 0xe3, 0x13, 0xda, 0x8c, 0xf4,
+	    0xf7, 0x28, 0x14, 0xfc, 0x14, 0x3f, 0x8f, 0x77, 0x79, 0xc6,
+	    0xeb, 0x9f, 0x7f, 0xa1, 0x72, 0x99, 0xae, 0xad, 0xb6, 0x88,
+	    0x90, 0x18, 0x50, 0x1d, 0x28, 0x9e, 0x49, 0x00, 0xf7, 0xe4,
+	    0x33, 0x1b, 0x99, 0xde, 0xc4, 0xb5, 0x43, 0x3a, 0xc7, 0xd3,
+	    0x29, 0xee, 0xb6, 0xdd, 0x26, 0x54, 0x5e, 0x96, 0xe5, 0x5b,
+	    0x87, 0x4b, 0xe9, 0x09 } },
+	{ "sha512", "a", 1000000,
+	  { 0xe7, 0x18, 0x48, 0x3d, 0x0c, 0xe7, 0x69, 0x64, 0x4e, 0x2e,
+	    0x42, 0xc7, 0xbc, 0x15, 0xb4, 0x63, 0x8e, 0x1f, 0x98, 0xb1,
+	    0x3b, 0x20, 0x44, 0x28, 0x56, 0x32, 0xa8, 0x03, 0xaf, 0xa9,
+	    0x73, 0xeb, 0xde, 0x0f, 0xf2, 0x44, 0x87, 0x7e, 0xa6, 0x0a,
+	    0x4c, 0xb0, 0x43, 0x2c, 0xe5, 0x77, 0xc3, 0x1b, 0xeb, 0x00,
+	    0x9c, 0x5c, 0x2c, 0x49, 0xaa, 0x2e, 0x4e, 0xad, 0xb2, 0x17,
+	    0xad, 0x8c, 0xc0, 0x9b } },
+};
+
+/**
+ * init_buffer() - fill a buffer with pseudo random bytes
+ *
+ * @buf:	buffer
+ * @len:	length of the buffer
+ */
+static void init_buffer(u8 *buf, uint len)
+{
+	u32 x = 0x87654321;
+
+	while (len--) {
+		x = x * 1103515245 + 12345;
+		*buf++ = x >> 24;
+	}
+}
+
+/**
+ * hash_split() - hash a buffer progressively in three updates
+ *
+ * @uts:	unit test state
+ * @name:	algorithm name
+ * @buf:	data
+ * @len:	length of the data
+ * @split1:	length of the first update
+ * @split2:	length of the second update
+ * @digest:	hash result
+ * Return:	0 = success, 1 = failure
+ */
+static int hash_split(struct unit_test_state *uts, const char *name,
+		      const u8 *buf, uint len, uint split1, uint split2,
+		      u8 *digest)
+{
+	struct hash_algo *algo;
+	void *ctx;
+
+	ut_assertok(hash_progressive_lookup_algo(name, &algo));
+	ut_assertok(algo->hash_init(algo, &ctx));
+	ut_assertok(algo->hash_update(algo, ctx, buf, split1, 0));
+	ut_assertok(algo->hash_update(algo, ctx, buf + split1, split2, 0));
+	ut_assertok(algo->hash_update(algo, ctx, buf + split1 + split2,
+				      len - split1 - split2, 1));
+	ut_assertok(algo->hash_finish(algo, ctx, digest, algo->digest_size));
+
+	return 0;
+}
+
+/**
+ * lib_hash_sha() - unit test for SHA-1, SHA-256, SHA-384 and SHA-512
+ *
+ * Progressive CRC32 is checked against hash_block() as well.
+ *
+ * @uts:	unit test state
+ * Return:	0 = success, 1 = failure
+ */
+static int lib_hash_sha(struct unit_test_state *uts)
+{
+	static const char * const names[] = {
+		"sha1", "sha256", "sha384", "sha512", "crc32"
+	};
+	const struct hash_kat *kat;
+	struct hash_algo *algo;
+	u8 expect[64], digest[64];
+	uint len, size, i;
+	u8 *buf;
+	int j;
+
+	buf = malloc(1000000);
+	ut_assertnonnull(buf);
+
+	for (i = 0; i < ARRAY_SIZE(hash_kats); i++) {
+		kat = &hash_kats[i];
+		if (hash_lookup_algo(kat->algo, &algo))
+			continue;
+		len = strlen(kat->msg);
+		if (kat->repeat) {
+			memset(buf, kat->msg[0], kat->repeat);
+			len = kat->repeat;
+		} else {
+			memcpy(buf, kat->msg, len);
+		}
+		size = sizeof(digest);
+		ut_assertok(hash_block(kat->algo, buf, len, digest,
+				       (int *)&size));
+		ut_asserteq_mem(kat->digest, digest, size);
+
+		/* unaligned updates straddling many blocks */
+		ut_assertok(hash_split(uts, kat->algo, buf, len, len / 3 + 1,
+				       len / 3, digest));
+		ut_asserteq_mem(kat->digest, digest, size);
+	}
+
+	init_buffer(buf, MAXLEN);
+	for (j = 0; j < ARRAY_SIZE(names); j++) {
+		if (hash_lookup_algo(names[j], &algo))
+			continue;
+		for (len = 0; len <= MAXLEN; len++) {
+			size = sizeof(expect);
+			ut_assertok(hash_block(names[j], buf, len, expect,
+					       (int *)&size));
+			ut_assertok(hash_split(uts, names[j], buf, len,
+					       len / 5, len / 2, digest));
+			ut_asserteq_mem(expect, digest, size);
+			ut_assertok(hash_split(uts, names[j], buf, len, 0,
+					       len & ~127, digest));
+			ut_asserteq_mem(expect, digest, size);
+		}
+	}
+
+	free(buf);
+	return 0;
+}
+
+LIB_TEST(lib_hash_sha, 0);
+
+#ifdef CONFIG_UT_LIB_BENCH
+/**
+ * lib_hash_bench() - report the throughput of each hash algorithm
+ *
+ * MiB/s are approximated as bytes per microsecond.
+ *
+ * @uts:	unit test state
+ * Return:	0 = success, 1 = failure
+ */
+static int lib_hash_bench(struct unit_test_state *uts)
+{
+	static const char * const names[] = {
+		"sha1", "sha256", "sha384", "sha512", "crc32", "crc16-ccitt"
+	};
+	struct hash_algo *algo;
+	ulong start, time;
+	u8 digest[64];
+	int i, j;
+	u8 *buf;
+
+	buf = malloc(SZ_1M);
+	ut_assertnonnull(buf);
+	init_buffer(buf, SZ_1M);
+
+	for (i = 0; i < ARRAY_SIZE(names); i++) {
+		if (hash_lookup_algo(names[i], &algo))
+			continue;
+		start = timer_get_us();
+		for (j = 0; j < BENCH_TOTAL / SZ_1M; j++)
+			algo->hash_func_ws(buf, SZ_1M, digest,
+					   algo->chunk_size);
+		time = timer_get_us() - start;
+		printf("%12s: %5lu MiB/s\n", names[i],
+		       BENCH_TOTAL / max(time, 1UL));
+	}
+
+	free(buf);
+	return 0;
+}
+
+LIB_TEST(lib_hash_bench, 0);
+#endif
+
+#if CONFIG_IS_ENABLED(FIT_HASH_ON_LOAD)
+/**
+ * add_hash_node() - add a hash node with the digest of some data to a FIT
+ *
+ * @uts:	unit test state
+ * @fit:	FIT header
+ * @image:	offset of the image node
+ * @name:	name of the hash node
+ * @algo:	hash algorithm
+ * @data:	image data
+ * @size:	size of the image data
+ * Return:	0 = success, 1 = failure
+ */
+static int add_hash_node(struct unit_test_state *uts, void *fit, int image,
+			 const char *name, const char *algo, const void *data,
+			 uint size)
+{
+	u8 value[FIT_MAX_HASH_LEN];
+	int node, len;
+
+	len = sizeof(value);
+	ut_assertok(hash_block(algo, data, size, value, &len));
+	node = fdt_add_subnode(fit, image, name);
+	ut_assert(node >= 0);
+	ut_assertok(fdt_setprop_string(fit, node, FIT_ALGO_PROP, algo));
+	ut_assertok(fdt_setprop(fit, node, FIT_VALUE_PROP, value, len));
+
+	return 0;
+}
+
+/**
+ * store_pieces() - report a FIT as stored, swapping each pair of pieces
+ *
+ * @fit:	FIT
+ * @size:	size of the FIT, including external data
+ */
+static void store_pieces(const char *fit, uint size)
+{
+	uint pos, len;
+
+	for (pos = 0; pos < size; pos += 2 * FIT_PIECE_SIZE) {
+		if (pos + FIT_PIECE_SIZE < size) {
+			len = min(size - pos - FIT_PIECE_SIZE,
+				  (uint)FIT_PIECE_SIZE);
+			fit_hash_load_data(fit + pos + FIT_PIECE_SIZE, len);
+		}
+		len = min(size - pos, (uint)FIT_PIECE_SIZE);
+		fit_hash_load_data(fit + pos, len);
+	}
+}
+
+/**
+ * lib_hash_fit_load() - unit test for hashing a FIT while it is loaded
+ *
+ * @uts:	unit test state
+ * Return:	0 = success, 1 = failure
+ */
+static int lib_hash_fit_load(struct unit_test_state *uts)
+{
+	u8 expect[FIT_MAX_HASH_LEN], value[FIT_MAX_HASH_LEN];
+	const uint size = FIT_HDR_SIZE + FIT_DATA_SIZE;
+	int images, image, len;
+	char *fit, *data;
+
+	fit = malloc(size);
+	ut_assertnonnull(fit);
+	data = fit + FIT_HDR_SIZE;
+	init_buffer((u8 *)data, FIT_DATA_SIZE);
+
+	ut_assertok(fdt_create_empty_tree(fit, FIT_HDR_SIZE));
+	ut_assertok(fdt_setprop_string(fit, 0, FIT_DESC_PROP, "test"));
+	ut_assertok(fdt_setprop_u32(fit, 0, FIT_TIMESTAMP_PROP, 0));
+	images = fdt_add_subnode(fit, 0, "images");
+	ut_assert(images >= 0);
+	image = fdt_add_subnode(fit, images, "kernel");
+	ut_assert(image >= 0);
+	ut_assertok(fdt_setprop_u32(fit, image, FIT_DATA_OFFSET_PROP, 0));
+	ut_assertok(fdt_setprop_u32(fit, image, FIT_DATA_SIZE_PROP,
+				    FIT_DATA_SIZE));
+	ut_assertok(add_hash_node(uts, fit, image, "hash-1", "sha256", data,
+				  FIT_DATA_SIZE));
+	ut_assertok(add_hash_node(uts, fit, image, "hash-2", "crc32", data,
+				  FIT_DATA_SIZE));
+
+	/* Pieces arriving out of order are hashed once the gap is filled */
+	fit_hash_load_start(fit);
+	store_pieces(fit, size);
+	len = sizeof(expect);
+	ut_assertok(hash_block("sha256", data, FIT_DATA_SIZE, expect, &len));
+
+	/* Digests are only handed out once claimed, as by bootm */
+	ut_asserteq(-ENOENT, fit_hash_load_lookup("sha256", data,
+						  FIT_DATA_SIZE, value, &len));
+	fit_hash_load_command();
+	fit_hash_load_claim();
+	ut_asserteq(-ENOENT, fit_hash_load_lookup("sha256", data,
+						  FIT_DATA_SIZE - 1, value,
+						  &len));
+	ut_assertok(fit_hash_load_lookup("sha256", data, FIT_DATA_SIZE, value,
+					 &len));
+	ut_asserteq(SHA256_SUM_LEN, len);
+	ut_asserteq_mem(expect, value, len);
+	ut_assertok(fit_hash_load_lookup("crc32", data, FIT_DATA_SIZE, value,
+					 &len));
+	ut_asserteq(4, len);
+	ut_asserteq(-ENOENT, fit_hash_load_lookup("sha1", data, FIT_DATA_SIZE,
+						  value, &len));
+
+	/* and only once */
+	ut_asserteq(-ENOENT, fit_hash_load_lookup("sha256", data,
+						  FIT_DATA_SIZE, value, &len));
+	ut_assert(fit_image_verify(fit, image));
+
+	/* Storing data a second time drops the digests */
+	fit_hash_load_start(fit);
+	store_pieces(fit, size);
+	fit_hash_load_data(data, FIT_PIECE_SIZE);
+	fit_hash_load_command();
+	fit_hash_load_claim();
+	ut_asserteq(-ENOENT, fit_hash_load_lookup("sha256", data,
+						  FIT_DATA_SIZE, value, &len));
+
+	/* A second command after the load drops them too */
+	fit_hash_load_start(fit);
+	store_pieces(fit, size);
+	fit_hash_load_command();
+	fit_hash_load_command();
+	fit_hash_load_claim();
+	ut_asserteq(-ENOENT, fit_hash_load_lookup("sha256", data,
+						  FIT_DATA_SIZE, value, &len));
+
+	/* A load which stops short has no digests */
+	fit_hash_load_start(fit);
+	fit_hash_load_data(fit, size - 1);
+	fit_hash_load_command();
+	fit_hash_load_claim();
+	ut_asserteq(-ENOENT, fit_hash_load_lookup("sha256", data,
+						  FIT_DATA_SIZE, value, &len));
+
+	/* Without digests the image is still hashed when it is verified */
+	ut_assert(fit_image_verify(fit, image));
+	data[0] ^= 1;
+	ut_assert(!fit_image_verify(fit, image));
+
+	fit_hash_load_start(NULL);
+	free(fit);
+	return 0;
+}
+
+LIB_TEST(lib_hash_fit_load, 0);
+
+/**
+ * lib_hash_fit_load_mw() - unit test for changing a FIT after it is loaded
+ *
+ * Overwriting the image with 'mw' is not reported to the load hashing, so
+ * verifying the image afterwards must not use the digests from the load.
+ *
+ * @uts:	unit test state
+ * Return:	0 = success, 1 = failure
+ */
+static int lib_hash_fit_load_mw(struct unit_test_state *uts)
+{
+	const uint size = FIT_HDR_SIZE + FIT_DATA_SIZE;
+	int images, image;
+	char *fit, *data;
+	char cmd[40];
+	ulong addr;
+
+	fit = malloc(size);
+	ut_assertnonnull(fit);
+	data = fit + FIT_HDR_SIZE;
+	init_buffer((u8 *)data, FIT_DATA_SIZE);
+	addr = map_to_sysmem(fit);
+
+	ut_assertok(fdt_create_empty_tree(fit, FIT_HDR_SIZE));
+	ut_assertok(fdt_setprop_string(fit, 0, FIT_DESC_PROP, "test"));
+	ut_assertok(fdt_setprop_u32(fit, 0, FIT_TIMESTAMP_PROP, 0));
+	images = fdt_add_subnode(fit, 0, "images");
+	ut_assert(images >= 0);
+	image = fdt_add_subnode(fit, images, "kernel");
+	ut_assert(image >= 0);
+	ut_assertok(fdt_setprop_u32(fit, image, FIT_DATA_OFFSET_PROP, 0));
+	ut_assertok(fdt_setprop_u32(fit, image, FIT_DATA_SIZE_PROP,
+				    FIT_DATA_SIZE));
+	ut_assertok(add_hash_node(uts, fit, image, "hash-1", "sha256", data,
+				  FIT_DATA_SIZE));
+
+	/* Load the FIT as tftp would, then change a byte of the image */
+	fit_hash_load_start(fit);
+	store_pieces(fit, size);
+	snprintf(cmd, sizeof(cmd), "mw.b %lx %x 1", addr + FIT_HDR_SIZE,
+		 (u8)~data[0]);
+	ut_assertok(run_command(cmd, 0));
+
+	snprintf(cmd, sizeof(cmd), "iminfo %lx", addr);
+	ut_assert(run_command(cmd, 0));
+	ut_assert(!fit_image_verify(fit, image));
+
+	fit_hash_load_start(NULL);
+	free(fit);
+	return 0;
+}
+
+LIB_TEST(lib_hash_fit_load_mw, 0);
+#endif
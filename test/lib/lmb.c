@@ -655,3 +655,147 @@ static int lib_test_lmb_get_free_size(struct unit_test_state *uts)
 
 DM_TEST(lib_test_lmb_get_free_size,
 	DM_TESTF_SCAN_PDATA | DM_TESTF_SCAN_FDT);
+
+/* Check that reserved regions keep their flags and do not merge with others */
+static int lib_test_lmb_flags(struct unit_test_state *uts)
+{
+	const phys_addr_t ram = 0x40000000;
+	const phys_size_t ram_size = 0x20000000;
+	struct lmb lmb;
+	long ret;
+
+	lmb_init(&lmb);
+
+	ret = lmb_add(&lmb, ram, ram_size);
+	ut_asserteq(ret, 0);
+
+	/* reserve a no-map region */
+	ret = lmb_reserve_flags(&lmb, 0x40010000, 0x10000, LMB_NOMAP);
+	ut_asserteq(ret, 0);
+	ASSERT_LMB(&lmb, ram, ram_size, 1, 0x40010000, 0x10000,
+		   0, 0, 0, 0);
+	ut_asserteq(1, lmb_is_reserved_flags(&lmb, 0x40010000, LMB_NOMAP));
+	ut_asserteq(0, lmb_is_reserved_flags(&lmb, 0x40020000, LMB_NOMAP));
+
+	/* an adjacent region without the flag is not merged with it */
+	ret = lmb_reserve(&lmb, 0x40020000, 0x10000);
+	ut_asserteq(ret, 0);
+	ASSERT_LMB(&lmb, ram, ram_size, 2, 0x40010000, 0x10000,
+		   0x40020000, 0x10000, 0, 0);
+	ut_asserteq(0, lmb_is_reserved_flags(&lmb, 0x40020000, LMB_NOMAP));
+	ut_asserteq(1, lmb_is_reserved(&lmb, 0x40020000));
+
+	/* no-map memory cannot be handed out again */
+	ut_asserteq(0, lmb_alloc_addr(&lmb, 0x40010000, 0x10000));
+	ut_asserteq(0x40020000, lmb_alloc_addr(&lmb, 0x40020000, 0x10000));
+
+	/* nor can a range which starts below it and runs into it */
+	ut_asserteq(0, lmb_alloc_addr(&lmb, 0x4000f000, 0x2000));
+	ut_asserteq(0, lmb_alloc_addr(&lmb, 0x40000000, 0x30000));
+	ASSERT_LMB(&lmb, ram, ram_size, 2, 0x40010000, 0x10000,
+		   0x40020000, 0x10000, 0, 0);
+
+	/* a no-overwrite region can only be reserved once */
+	ret = lmb_reserve_flags(&lmb, 0x40040000, 0x10000, LMB_NOOVERWRITE);
+	ut_asserteq(ret, 0);
+	ut_asserteq(0, lmb_alloc_addr(&lmb, 0x40040000, 0x10000));
+	ret = lmb_reserve_flags(&lmb, 0x40040000, 0x10000, LMB_NOOVERWRITE);
+	ut_asserteq(ret, -1);
+	ASSERT_LMB(&lmb, ram, ram_size, 3, 0x40010000, 0x10000,
+		   0x40020000, 0x10000, 0x40040000, 0x10000);
+
+	/* freeing part of a region keeps the flags of both halves */
+	ret = lmb_free(&lmb, 0x40014000, 0x4000);
+	ut_asserteq(ret, 0);
+	ASSERT_LMB(&lmb, ram, ram_size, 4, 0x40010000, 0x4000,
+		   0x40018000, 0x8000, 0x40020000, 0x10000);
+	ut_asserteq(1, lmb_is_reserved_flags(&lmb, 0x40018000, LMB_NOMAP));
+	ut_asserteq(0, lmb_is_reserved(&lmb, 0x40014000));
+
+	lmb_release(&lmb);
+
+	return 0;
+}
+
+DM_TEST(lib_test_lmb_flags, DM_TESTF_SCAN_PDATA | DM_TESTF_SCAN_FDT);
+
+/* Number of regions reserved by the stress test, coprime with the stride */
+#define LMB_STRESS_COUNT	512
+#define LMB_STRESS_STRIDE	97
+
+/*
+ * Reserve many more regions than fit into struct lmb, in a scattered order,
+ * and allocate around them
+ */
+static int lib_test_lmb_many(struct unit_test_state *uts)
+{
+	const phys_size_t gap = 0x10000;
+	const phys_addr_t ram = 0x40000000;
+	const phys_size_t ram_size = LMB_STRESS_COUNT * gap;
+	ulong start, reserve_us, alloc_us, free_us;
+	phys_addr_t base, a;
+	struct lmb lmb;
+	long ret;
+	int i;
+
+	lmb_init(&lmb);
+
+	ret = lmb_add(&lmb, ram, ram_size);
+	ut_asserteq(ret, 0);
+
+	/* reserve 4 KiB at the start of each 64 KiB block of RAM */
+	start = timer_get_us();
+	for (i = 0; i < LMB_STRESS_COUNT; i++) {
+		base = ram + (i * LMB_STRESS_STRIDE % LMB_STRESS_COUNT) * gap;
+		ret = lmb_reserve(&lmb, base, 0x1000);
+		ut_asserteq(ret, 0);
+	}
+	reserve_us = timer_get_us() - start;
+
+	ut_asserteq(LMB_STRESS_COUNT, lmb.reserved.cnt);
+	for (i = 0; i < LMB_STRESS_COUNT; i++) {
+		ut_asserteq(ram + i * gap, lmb.reserved.region[i].base);
+		ut_asserteq(0x1000, lmb.reserved.region[i].size);
+	}
+	ut_asserteq(1, lmb_is_reserved(&lmb, ram + 100 * gap + 0xfff));
+	ut_asserteq(0, lmb_is_reserved(&lmb, ram + 100 * gap + 0x1000));
+	ut_asserteq(gap - 0x1000, lmb_get_free_size(&lmb, ram + 0x1000));
+
+	/* fill the rest of each block from the top of RAM downwards */
+	start = timer_get_us();
+	for (i = LMB_STRESS_COUNT - 1; i >= 0; i--) {
+		a = lmb_alloc(&lmb, gap - 0x1000, 0x1000);
+		ut_asserteq(ram + i * gap + 0x1000, a);
+	}
+	alloc_us = timer_get_us() - start;
+
+	/* each allocation merged with the block below it */
+	ut_asserteq(1, lmb.reserved.cnt);
+	ASSERT_LMB(&lmb, ram, ram_size, 1, ram, ram_size, 0, 0, 0, 0);
+	/* This should fail, printing an error */
+	ut_asserteq(0, lmb_alloc(&lmb, 0x1000, 1));
+
+	/* punch the holes again and free the whole range */
+	start = timer_get_us();
+	for (i = 0; i < LMB_STRESS_COUNT; i++) {
+		base = ram + (i * LMB_STRESS_STRIDE % LMB_STRESS_COUNT) * gap;
+		ret = lmb_free(&lmb, base + 0x1000, gap - 0x1000);
+		ut_asserteq(ret, 0);
+	}
+	ut_asserteq(LMB_STRESS_COUNT, lmb.reserved.cnt);
+	for (i = 0; i < LMB_STRESS_COUNT; i++) {
+		ret = lmb_free(&lmb, ram + i * gap, 0x1000);
+		ut_asserteq(ret, 0);
+	}
+	free_us = timer_get_us() - start;
+	ASSERT_LMB(&lmb, ram, ram_size, 0, 0, 0, 0, 0, 0, 0);
+
+	printf("%d regions: reserve %lu us, alloc %lu us, free %lu us\n",
+	       LMB_STRESS_COUNT, reserve_us, alloc_us, free_us);
+
+	lmb_release(&lmb);
+
+	return 0;
+}
+
+DM_TEST(lib_test_lmb_many, DM_TESTF_SCAN_PDATA | DM_TESTF_SCAN_FDT);
@@ -11,6 +11,8 @@
 
 #include <common.h>
 #include <command.h>
+#include <malloc.h>
+#include <linux/sizes.h>
 #include <test/lib.h>
 #include <test/test.h>
 #include <test/ut.h>
@@ -19,8 +21,8 @@
 #define MASK 0xA5
 /* Number of different alignment values */
 #define SWEEP 16
-/* Allow for copying up to 32 bytes */
-#define BUFLEN (SWEEP + 33)
+/* Allow for copying up to 80 bytes, enough for the unrolled word loops */
+#define BUFLEN (SWEEP + 81)
 
 /**
  * init_buffer() - initialize buffer
@@ -192,3 +194,85 @@ static int lib_memmove(struct unit_test_state *uts)
 }
 
 LIB_TEST(lib_memmove, 0);
+
+#ifdef CONFIG_UT_LIB_BENCH
+/* Largest region copied or set by lib_memcpy_bench() */
+#define BENCH_MAX	SZ_1M
+/* Bytes moved per measurement, so that each one takes a while */
+#define BENCH_TOTAL	SZ_64M
+
+/**
+ * mem_bench() - measure memcpy(), memmove() and memset() on one region
+ *
+ * @uts:	unit test state
+ * @buf:	buffer of at least 2 * (BENCH_MAX + SWEEP) bytes
+ * @len:	length of the region
+ * @doff:	misalignment of the destination
+ * @soff:	misalignment of the source
+ * Return:	0 = success, 1 = failure
+ */
+static int mem_bench(struct unit_test_state *uts, u8 *buf, size_t len,
+		     int doff, int soff)
+{
+	u8 *src = buf + soff;
+	u8 *dst = buf + BENCH_MAX + SWEEP + doff;
+	ulong start, cpy, mov, set;
+	int i, loops = BENCH_TOTAL / len;
+
+	start = timer_get_us();
+	for (i = 0; i < loops; i++)
+		memcpy(dst, src, len);
+	cpy = timer_get_us() - start;
+	ut_assertok(memcmp(dst, src, len));
+
+	/* overlapping backward move */
+	start = timer_get_us();
+	for (i = 0; i < loops; i++)
+		memmove(src + SWEEP / 2, src, len);
+	mov = timer_get_us() - start;
+
+	start = timer_get_us();
+	for (i = 0; i < loops; i++)
+		memset(dst, i, len);
+	set = timer_get_us() - start;
+
+	printf("%8zu bytes, dst+%d src+%d: ", len, doff, soff);
+	printf("memcpy %5lu, memmove %5lu, memset %5lu MiB/s\n",
+	       BENCH_TOTAL / max(cpy, 1UL), BENCH_TOTAL / max(mov, 1UL),
+	       BENCH_TOTAL / max(set, 1UL));
+
+	return 0;
+}
+
+/**
+ * lib_memcpy_bench() - report memcpy(), memmove() and memset() throughput
+ *
+ * The throughput is given for a range of sizes and alignments, with MiB/s
+ * approximated as bytes per microsecond.
+ *
+ * @uts:	unit test state
+ * Return:	0 = success, 1 = failure
+ */
+static int lib_memcpy_bench(struct unit_test_state *uts)
+{
+	static const int offs[][2] = { {0, 0}, {0, 3}, {5, 0}, {1, 6} };
+	static const size_t lens[] = { 64, SZ_1K, SZ_64K, BENCH_MAX };
+	u8 *buf;
+	int i, j;
+
+	buf = malloc(2 * (BENCH_MAX + SWEEP));
+	ut_assertnonnull(buf);
+	for (i = 0; i < BENCH_MAX + SWEEP; i++)
+		buf[i] = i ^ MASK;
+
+	for (i = 0; i < ARRAY_SIZE(lens); i++)
+		for (j = 0; j < ARRAY_SIZE(offs); j++)
+			ut_assertok(mem_bench(uts, buf, lens[i], offs[j][0],
+					      offs[j][1]));
+
+	free(buf);
+	return 0;
+}
+
+LIB_TEST(lib_memcpy_bench, 0);
+#endif
@@ -0,0 +1,119 @@
+# SPDX-License-Identifier:      GPL-2.0+
+#
+# U-Boot File System: ext4 read benchmark
+
+"""
+This test compares ext4load throughput for a file stored in a few large
+extents with the same file scattered over hundreds of small extents, which
+needs a two-level extent tree. Both reads must return the same data.
+"""
+
+import os
+import pytest
+import re
+from subprocess import call, check_call, CalledProcessError
+from fstest_defs import *
+from conftest import tool_is_in_path
+
+FILE_SIZE = 32 * 1024 * 1024
+
+def mk_ext4(config, name, src_dir, size):
+    """Create an ext4 image with 1KiB blocks populated from a directory.
+
+    Args:
+        config: U-Boot configuration.
+        name: Prefix string of the image's file name.
+        src_dir: Directory to copy into the file system.
+        size: Size of the file system in MiB.
+
+    Return:
+        Path of the image.
+    """
+    fs_img = '%s/%s.ext4.img' % (config.persistent_data_dir, name)
+    check_call('rm -f %s' % fs_img, shell=True)
+    check_call('mkfs.ext4 -q -b 1024 -N 4096 -O ^metadata_csum -d %s %s %dM'
+        % (src_dir, fs_img, size), shell=True)
+    return fs_img
+
+@pytest.fixture(scope='module')
+def ext4_read_images(u_boot_config):
+    """Set up a contiguous and a fragmented ext4 image.
+
+    The fragmented image is first filled with small files, every other of
+    which is then deleted, so the big file has to be written into the holes.
+
+    Return:
+        Tuple of the two image paths and the MD5 of the big file.
+    """
+    if not u_boot_config.buildconfig.get('config_cmd_ext4', None):
+        pytest.skip('.config feature "CMD_EXT4" not enabled')
+    for tool in ['mkfs.ext4', 'debugfs']:
+        if not tool_is_in_path(tool):
+            pytest.skip('%s not found' % tool)
+
+    data_dir = u_boot_config.persistent_data_dir + '/ext4_read'
+    big_file = data_dir + '/' + MEDIUM_FILE
+    try:
+        check_call('rm -rf %s; mkdir -p %s/contig %s/frag'
+            % (data_dir, data_dir, data_dir), shell=True)
+        check_call('dd if=/dev/urandom of=%s bs=1M count=%d'
+            % (big_file, FILE_SIZE / 1048576), shell=True)
+        check_call('cp %s %s/contig/' % (big_file, data_dir), shell=True)
+        contig_img = mk_ext4(u_boot_config, 'contig', data_dir + '/contig',
+            2 * FILE_SIZE / 1048576)
+
+        for i in range(2400):
+            check_call('dd if=/dev/urandom of=%s/frag/s%d bs=40k count=1'
+                ' 2>/dev/null' % (data_dir, i), shell=True)
+        frag_img = mk_ext4(u_boot_config, 'frag', data_dir + '/frag', 120)
+        with open(data_dir + '/cmds', 'w') as cmds:
+            for i in range(0, 2400, 2):
+                cmds.write('rm s%d\n' % i)
+            cmds.write('write %s %s\n' % (big_file, MEDIUM_FILE))
+        check_call('debugfs -w -f %s/cmds %s >/dev/null 2>&1'
+            % (data_dir, frag_img), shell=True)
+
+        out = os.popen('md5sum ' + big_file).read()
+        md5val = out.split()[0]
+    except CalledProcessError as err:
+        pytest.skip('Setup failed for ext4 read images: %s' % err)
+        return
+    finally:
+        call('rm -rf %s/contig %s/frag' % (data_dir, data_dir), shell=True)
+
+    yield contig_img, frag_img, md5val
+
+    call('rm -rf %s %s %s' % (data_dir, contig_img, frag_img), shell=True)
+
+def ext4_load_rate(u_boot_console, fs_img, md5val):
+    """Load the big file from an image and check its contents.
+
+    Return:
+        Read throughput in MiB/s, or None if the load was too fast to time.
+    """
+    output = u_boot_console.run_command_list([
+        'host bind 0 %s' % fs_img,
+        'ext4load host 0:0 %x /%s' % (ADDR, MEDIUM_FILE),
+        'md5sum %x $filesize' % ADDR,
+        'setenv filesize'])
+    assert('%d bytes read' % FILE_SIZE in ''.join(output))
+    assert(md5val in ''.join(output))
+
+    m = re.search('bytes read in (\d+) ms', ''.join(output))
+    ms = int(m.group(1))
+    if not ms:
+        return None
+    return FILE_SIZE * 1000 / ms / 1048576
+
+@pytest.mark.boardspec('sandbox')
+@pytest.mark.slow
+def test_ext4_read_fragmented(u_boot_console, ext4_read_images):
+    """Read the same file from a contiguous and a fragmented ext4 image."""
+    contig_img, frag_img, md5val = ext4_read_images
+
+    with u_boot_console.log.section('Contiguous'):
+        rate = ext4_load_rate(u_boot_console, contig_img, md5val)
+        u_boot_console.log.info('contiguous: %s MiB/s' % rate)
+    with u_boot_console.log.section('Fragmented'):
+        rate = ext4_load_rate(u_boot_console, frag_img, md5val)
+        u_boot_console.log.info('fragmented: %s MiB/s' % rate)
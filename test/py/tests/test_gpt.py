@@ -118,6 +118,23 @@ def test_gpt_save_guid(state_disk_image, u_boot_console):
     output = u_boot_console.run_command('printenv newguid')
     assert '375a56f7-d6c9-4e81-b5f0-09d41ca89efe' in output
 
+@pytest.mark.boardspec('sandbox')
+@pytest.mark.buildconfigspec('cmd_gpt')
+@pytest.mark.buildconfigspec('cmd_part')
+@pytest.mark.buildconfigspec('partition_cache')
+@pytest.mark.requiredtool('sgdisk')
+def test_gpt_part_cache(state_disk_image, u_boot_console):
+    """Test that the GPT is only read once for several lookups."""
+
+    u_boot_console.run_command('host bind 0 ' + state_disk_image.path)
+    output = u_boot_console.run_command('part start host 0 part2')
+    assert '1000' in output
+    u_boot_console.run_command('part list host 0 -bootable bootparts')
+    u_boot_console.run_command('part size host 0 part1 size')
+    u_boot_console.run_command('part uuid host 0:1')
+    output = u_boot_console.run_command('part stats host 0')
+    assert 'read 1 times, cached' in output
+
 @pytest.mark.boardspec('sandbox')
 @pytest.mark.buildconfigspec('cmd_gpt')
 @pytest.mark.buildconfigspec('cmd_gpt_rename')
@@ -0,0 +1,40 @@
+# SPDX-License-Identifier: GPL-2.0+
+#
+# Time a boot-script style loop run by the hush shell. Each iteration runs
+# a few commands, so the time is mostly spent parsing the script and looking
+# up the commands.
+
+import pytest
+import time
+
+pytestmark = pytest.mark.buildconfigspec('hush_parser')
+
+DIGITS = '0 1 2 3 4 5 6 7 8 9'
+# Commands run in each iteration of the loop: setenv, test and true
+COMMANDS_PER_LOOP = 3
+LOOPS = 10000
+
+def test_hush_speed(u_boot_console):
+    """Run commands in nested loops and log how many run per second."""
+
+    script = ('setenv count; '
+              'for h in %s; do for i in %s; do '
+              'for j in %s; do for k in %s; do '
+              'setenv n ${h}${i}${j}${k}; '
+              'if test ${n} = 9999; then setenv count ${n}; fi; '
+              'true; '
+              'done; done; done; done' % ((DIGITS,) * 4))
+    u_boot_console.run_command('setenv speed_script \'%s\'' % script)
+
+    tstart = time.time()
+    u_boot_console.run_command('run speed_script')
+    tend = time.time()
+
+    response = u_boot_console.run_command('echo ${count}')
+    assert response.strip() == '9999'
+    u_boot_console.run_command('setenv speed_script; setenv count; setenv n')
+
+    elapsed = tend - tstart
+    u_boot_console.log.info('Running %d commands took %f seconds, '
+                            '%.0f commands/s' % (LOOPS * COMMANDS_PER_LOOP,
+                            elapsed, LOOPS * COMMANDS_PER_LOOP / elapsed))
@@ -4,8 +4,14 @@
 # Test various network-related functionality, such as the dhcp, ping, and
 # tftpboot commands.
 
+import os
 import pytest
+import re
+import socket
+import struct
+import threading
 import u_boot_utils
+import zlib
 
 """
 Note: This test relies on boardenv_* containing configuration values to define
@@ -47,6 +53,20 @@ env__net_tftp_readable_file = {
     'crc32': 'c2244b26',
 }
 
+# Details of a TFTP server stand-in run by the test itself, used to compare
+# the throughput of RFC 7440 windowed transfers against lock-step ones. 'host'
+# must be an address of the machine running the test which U-Boot can reach;
+# 'serverip' is pointed at it for the duration of the test. A port other
+# than 69 requires CONFIG_TFTP_PORT. This variable may be omitted or set to
+# None to skip these tests.
+env__net_tftp_local_server = {
+    'host': '10.0.0.1',
+    'port': 6969,
+    'addr': 0x10000000,
+    'size': 4194304,
+    'windowsize': 16,
+}
+
 # Details regarding a file that may be read from a NFS server. This variable
 # may be omitted or set to None if NFS testing is not possible or desired.
 env__net_nfs_readable_file = {
@@ -167,6 +187,194 @@ def test_net_tftpboot(u_boot_console):
     output = u_boot_console.run_command('crc32 $fileaddr $filesize')
     assert expected_crc in output
 
+class TftpStandIn(threading.Thread):
+    """A minimal TFTP server which serves a fixed buffer for any file name.
+
+    It supports the blksize, tsize and windowsize (RFC 7440) options and can
+    swap each pair of data packets it sends, to check that the client copes
+    with blocks arriving out of order. It can also leave out the second block
+    the first time it is sent, to check that the client asks for it again.
+    """
+
+    def __init__(self, host, port, data, reorder=False, drop=False):
+        super(TftpStandIn, self).__init__()
+        self.daemon = True
+        self.data = data
+        self.reorder = reorder
+        self.drop = drop
+        self.windowsize = None
+        self.sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+        self.sock.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEADDR, 1)
+        self.sock.bind((host, port))
+        self.sock.settimeout(30)
+        self.host = host
+
+    def run(self):
+        try:
+            self.serve()
+        except socket.timeout:
+            pass
+        finally:
+            self.sock.close()
+
+    def serve(self):
+        pkt, client = self.sock.recvfrom(1500)
+        if struct.unpack('!H', pkt[:2])[0] != 1:
+            return
+        fields = pkt[2:].split(b'\0')
+        opts = dict(zip(fields[2::2], fields[3::2]))
+
+        blksize = 512
+        windowsize = 1
+        oack = b''
+        if b'blksize' in opts:
+            blksize = min(int(opts[b'blksize']), 1468)
+            oack += b'blksize\0%d\0' % blksize
+        if b'windowsize' in opts:
+            windowsize = int(opts[b'windowsize'])
+            oack += b'windowsize\0%d\0' % windowsize
+        if b'tsize' in opts:
+            oack += b'tsize\0%d\0' % len(self.data)
+        self.windowsize = windowsize
+
+        # Reply from a new port, as the transfer ID
+        tid = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+        tid.bind((self.host, 0))
+        tid.settimeout(1)
+        try:
+            self.transfer(tid, client, oack, blksize, windowsize)
+        finally:
+            tid.close()
+
+    def transfer(self, tid, client, oack, blksize, windowsize):
+        nblocks = len(self.data) // blksize + 1
+        acked = 0
+        retries = 0
+        if oack:
+            tid.sendto(struct.pack('!H', 6) + oack, client)
+            if self.wait_ack(tid) != 0:
+                return
+        while acked < nblocks:
+            pkts = []
+            for blk in range(acked + 1, min(acked + windowsize, nblocks) + 1):
+                chunk = self.data[(blk - 1) * blksize:blk * blksize]
+                pkts.append(struct.pack('!HH', 3, blk & 0xffff) + chunk)
+            if self.reorder:
+                for i in range(0, len(pkts) - 1, 2):
+                    pkts[i], pkts[i + 1] = pkts[i + 1], pkts[i]
+            for pkt in pkts:
+                if self.drop and struct.unpack('!H', pkt[2:4])[0] == 2:
+                    self.drop = False
+                    continue
+                tid.sendto(pkt, client)
+            ack = self.wait_ack(tid)
+            if ack is None:
+                retries += 1
+                if retries > 10:
+                    return
+                continue
+            retries = 0
+            # The ACK carries a 16-bit block number; ignore stale ones
+            delta = (ack - acked) & 0xffff
+            if delta <= windowsize:
+                acked += delta
+
+    def wait_ack(self, tid):
+        try:
+            pkt = tid.recv(1500)
+        except socket.timeout:
+            return None
+        op, blk = struct.unpack('!HH', pkt[:4])
+        return blk if op == 4 else None
+
+def tftp_local_transfer(u_boot_console, windowsize, reorder=False,
+                        drop=False):
+    """Download a file from a TFTP stand-in and check its contents.
+
+    Returns the transfer rate printed by U-Boot.
+    """
+
+    f = u_boot_console.config.env.get('env__net_tftp_local_server', None)
+    if not f:
+        pytest.skip('No local TFTP server stand-in configured')
+
+    port = f.get('port', 69)
+    addr = f.get('addr', None)
+    if not addr:
+        addr = u_boot_utils.find_ram_base(u_boot_console)
+    data = os.urandom(f.get('size', 4194304))
+    server = TftpStandIn(f['host'], port, data, reorder, drop)
+    server.start()
+
+    u_boot_console.run_command('setenv tftpwindowsize %d' % windowsize)
+    if port != 69:
+        u_boot_console.run_command('setenv tftpdstp %d' % port)
+    output = u_boot_console.run_command('tftpboot %x %s:ubtest-window.bin' %
+                                        (addr, f['host']))
+    u_boot_console.run_command('setenv tftpwindowsize; setenv tftpdstp')
+    server.join()
+
+    assert 'Bytes transferred = %d' % len(data) in output
+    assert server.windowsize == windowsize
+    output_crc = u_boot_console.run_command('crc32 %x $filesize' % addr)
+    assert '%08x' % (zlib.crc32(data) & 0xffffffff) in output_crc
+
+    rate = re.search(r'([0-9.]+ [KMG]?i?B/s)', output)
+    return rate.group(1) if rate else 'unknown'
+
+@pytest.mark.buildconfigspec('cmd_net')
+@pytest.mark.buildconfigspec('cmd_crc32')
+@pytest.mark.buildconfigspec('net_tftp_vars')
+def test_net_tftpboot_windowsize(u_boot_console):
+    """Test RFC 7440 windowed TFTP transfers against a local stand-in server.
+
+    The same file is downloaded lock-step and with the configured window size
+    and the transfer rates are logged for comparison.
+    """
+
+    if not net_set_up:
+        pytest.skip('Network not initialized')
+
+    f = u_boot_console.config.env.get('env__net_tftp_local_server', None)
+    if not f:
+        pytest.skip('No local TFTP server stand-in configured')
+
+    windowsize = f.get('windowsize', 16)
+    rate_1 = tftp_local_transfer(u_boot_console, 1)
+    rate_n = tftp_local_transfer(u_boot_console, windowsize)
+    u_boot_console.log.info('TFTP windowsize 1: %s, windowsize %d: %s' %
+                            (rate_1, windowsize, rate_n))
+
+@pytest.mark.buildconfigspec('cmd_net')
+@pytest.mark.buildconfigspec('cmd_crc32')
+@pytest.mark.buildconfigspec('net_tftp_vars')
+def test_net_tftpboot_windowsize_reorder(u_boot_console):
+    """Test that a windowed TFTP transfer copes with reordered blocks."""
+
+    if not net_set_up:
+        pytest.skip('Network not initialized')
+
+    f = u_boot_console.config.env.get('env__net_tftp_local_server', None)
+    if not f:
+        pytest.skip('No local TFTP server stand-in configured')
+
+    tftp_local_transfer(u_boot_console, f.get('windowsize', 16), True)
+
+@pytest.mark.buildconfigspec('cmd_net')
+@pytest.mark.buildconfigspec('cmd_crc32')
+@pytest.mark.buildconfigspec('net_tftp_vars')
+def test_net_tftpboot_windowsize_lost(u_boot_console):
+    """Test that a windowed TFTP transfer recovers from a lost block."""
+
+    if not net_set_up:
+        pytest.skip('Network not initialized')
+
+    f = u_boot_console.config.env.get('env__net_tftp_local_server', None)
+    if not f:
+        pytest.skip('No local TFTP server stand-in configured')
+
+    tftp_local_transfer(u_boot_console, f.get('windowsize', 16), drop=True)
+
 @pytest.mark.buildconfigspec('cmd_nfs')
 def test_net_nfs(u_boot_console):
     """Test the nfs command.
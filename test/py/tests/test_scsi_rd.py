@@ -0,0 +1,95 @@
+# SPDX-License-Identifier: GPL-2.0+
+#
+# Test U-Boot's "scsi read" command and report its throughput. The test reads
+# a region of a SCSI or SATA disk, checks that no errors occurred and that the
+# expected data was read if the test configuration contains a CRC of it.
+
+import pytest
+import time
+import u_boot_utils
+
+"""
+This test relies on boardenv_* containing configuration values to define
+which disk regions should be read. With AHCI it exercises the queued (NCQ)
+read path, for example under qemu-x86 or qemu-x86_64 given a disk on QEMU's
+emulated AHCI controller:
+
+    qemu-img create -f raw sata.img 256M
+    qemu-system-x86_64 ... -device ahci,id=ahci \
+        -drive file=sata.img,if=none,id=disk,format=raw \
+        -device ide-hd,drive=disk,bus=ahci.0
+
+For example:
+
+# Configuration data for test_scsi_rd; defines regions of disks which can be
+# read.
+env__scsi_rd_configs = (
+    {
+        'fixture_id': 'qemu-ahci',
+        'devid': 0,
+        'sector': 0,
+        'count': 0x40000,
+        # Optional, block size of the disk, 512 by default
+        'blksz': 512,
+        # Optional, CRC32 of the data which is read
+        'crc32': '...',
+        # Optional, lowest acceptable throughput in MiB/s
+        'rate_min': 50,
+    },
+)
+"""
+
+@pytest.mark.buildconfigspec('cmd_scsi')
+def test_scsi_rd(u_boot_console, env__scsi_rd_config):
+    """Test the "scsi read" command and log its throughput.
+
+    Args:
+        u_boot_console: A U-Boot console connection.
+        env__scsi_rd_config: The single disk region on which to run the
+            test. See the file-level comment above for details of the
+            format.
+
+    Returns:
+        Nothing.
+    """
+
+    devid = env__scsi_rd_config.get('devid', 0)
+    sector = env__scsi_rd_config.get('sector', 0)
+    count_sectors = env__scsi_rd_config.get('count', 1)
+    expected_crc32 = env__scsi_rd_config.get('crc32', None)
+    rate_min = env__scsi_rd_config.get('rate_min', 0)
+    count_bytes = count_sectors * env__scsi_rd_config.get('blksz', 512)
+
+    bcfg = u_boot_console.config.buildconfig
+    has_cmd_crc32 = bcfg.get('config_cmd_crc32', 'n') == 'y'
+    ram_base = u_boot_utils.find_ram_base(u_boot_console)
+    addr = '0x%08x' % ram_base
+
+    u_boot_console.run_command('scsi scan')
+    response = u_boot_console.run_command('scsi dev %d' % devid)
+    assert 'is now current device' in response
+
+    # Read data
+    cmd = 'scsi read %s %x %x' % (addr, sector, count_sectors)
+    tstart = time.time()
+    response = u_boot_console.run_command(cmd)
+    tend = time.time()
+    good_response = '%d blocks read: OK' % count_sectors
+    assert good_response in response
+
+    elapsed = tend - tstart
+    rate = count_bytes / elapsed / 1048576
+    u_boot_console.log.info('Reading %d bytes took %f seconds, %.1f MiB/s' %
+                            (count_bytes, elapsed, rate))
+
+    # Check target RAM
+    if expected_crc32:
+        if has_cmd_crc32:
+            cmd = 'crc32 %s 0x%x' % (addr, count_bytes)
+            response = u_boot_console.run_command(cmd)
+            assert expected_crc32 in response
+        else:
+            u_boot_console.log.warning('CONFIG_CMD_CRC32 != y: Skipping check')
+
+    if rate_min:
+        assert rate >= rate_min
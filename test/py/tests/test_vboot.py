@@ -21,7 +21,8 @@ For configuration verification:
 - Corrupt the signature
 - Check that image verification no-longer works
 
-Tests run with both SHA1 and SHA256 hashing.
+Tests run with SHA1 and SHA256 hashing, and with SHA384 and SHA512 if they
+are enabled.
 """
 
 import pytest
@@ -66,8 +67,8 @@ def test_vboot(u_boot_console):
         Args:
             test_type: A string identifying the test type.
             expect_string: A string which is expected in the output.
-            sha_algo: Either 'sha1' or 'sha256', to select the algorithm to
-                    use.
+            sha_algo: One of 'sha1', 'sha256', 'sha384' or 'sha512', to
+                    select the algorithm to use.
             boots: A boolean that is True if Linux should boot and False if
                     we are expected to not boot
         """
@@ -99,8 +100,8 @@ def test_vboot(u_boot_console):
         public key into the dtb.
 
         Args:
-            sha_algo: Either 'sha1' or 'sha256', to select the algorithm to
-                    use.
+            sha_algo: One of 'sha1', 'sha256', 'sha384' or 'sha512', to
+                    select the algorithm to use.
         """
         cons.log.action('%s: Sign images' % sha_algo)
         util.run_and_log(cons, [mkimage, '-F', '-k', tmpdir, '-K', dtb,
@@ -133,8 +134,8 @@ def test_vboot(u_boot_console):
         for both hashing algorithms.
 
         Args:
-            sha_algo: Either 'sha1' or 'sha256', to select the algorithm to
-                    use.
+            sha_algo: One of 'sha1', 'sha256', 'sha384' or 'sha512', to
+                    select the algorithm to use.
         """
         # Compile our device tree files for kernel and U-Boot. These are
         # regenerated here since mkimage will modify them (by adding a
@@ -230,6 +231,11 @@ def test_vboot(u_boot_console):
         test_with_algo('sha1','-pss')
         test_with_algo('sha256','')
         test_with_algo('sha256','-pss')
+        for sha_algo in ['sha384', 'sha512']:
+            if cons.config.buildconfig.get(
+                    'config_fit_enable_%s_support' % sha_algo):
+                test_with_algo(sha_algo, '')
+                test_with_algo(sha_algo, '-pss')
     finally:
         # Go back to the original U-Boot with the correct dtb.
         cons.config.dtb = old_dtb
@@ -0,0 +1,53 @@
+# SPDX-License-Identifier: GPL-2.0+
+#
+# Read throughput of the virtio block driver, using the disk which the
+# sandbox virtio transport emulates. Its requests are limited to a few small
+# segments, so a large read is split into many requests which are added to
+# the ring together.
+
+import pytest
+import time
+import u_boot_utils
+
+# The sandbox device's disk, 2048 blocks of 512 bytes
+COUNT_SECTORS = 0x800
+COUNT_BYTES = COUNT_SECTORS * 512
+LOOPS = 16
+
+@pytest.mark.boardspec('sandbox')
+@pytest.mark.buildconfigspec('cmd_virtio')
+@pytest.mark.buildconfigspec('cmd_crc32')
+def test_virtio_blk_rd(u_boot_console):
+    """Write the emulated disk, then read it back and log the throughput."""
+
+    ram_base = u_boot_utils.find_ram_base(u_boot_console)
+    addr = '0x%08x' % ram_base
+
+    u_boot_console.run_command('virtio scan')
+    response = u_boot_console.run_command('virtio dev 0')
+    assert 'is now current device' in response
+
+    u_boot_console.run_command('mw.b %s a5 0x%x' % (addr, COUNT_BYTES))
+    response = u_boot_console.run_command('crc32 %s 0x%x' %
+                                          (addr, COUNT_BYTES))
+    expected_crc32 = response.split('==> ')[1].strip()
+    response = u_boot_console.run_command('virtio write %s 0 %x' %
+                                          (addr, COUNT_SECTORS))
+    assert '%d blocks written: OK' % COUNT_SECTORS in response
+    u_boot_console.run_command('mw.b %s 0 0x%x' % (addr, COUNT_BYTES))
+
+    cmd = 'virtio read %s 0 %x' % (addr, COUNT_SECTORS)
+    tstart = time.time()
+    for i in range(LOOPS):
+        response = u_boot_console.run_command(cmd)
+        assert '%d blocks read: OK' % COUNT_SECTORS in response
+    tend = time.time()
+
+    elapsed = tend - tstart
+    u_boot_console.log.info('Reading %d bytes %d times took %f seconds, '
+                            '%.1f MiB/s' % (COUNT_BYTES, LOOPS, elapsed,
+                            COUNT_BYTES * LOOPS / elapsed / 1048576))
+
+    response = u_boot_console.run_command('crc32 %s 0x%x' %
+                                          (addr, COUNT_BYTES))
+    assert expected_crc32 in response